@@ -1,4 +1,5 @@
 #include "MM.h"
+#include "inputlog.h"
 
 #include <MIDI.h>
 
@@ -8,6 +9,70 @@ namespace {
 
   SerialMIDI theSerialInstance(Serial1);
   MidiInterface HWMIDI(theSerialInstance);
+
+  uint32_t firstSend = 0;
+  uint32_t firstReceive = 0;
+
+  // the real-time lane, see MM::sendRealTime()
+  const int laneSize = 4;
+  volatile uint8_t sending = 0;   // loop() is writing to the ports, nests
+  volatile uint8_t lane[laneSize][2];
+  volatile uint8_t laneHead = 0;
+  volatile uint8_t laneCount = 0;
+  void (*realTimeSent)(uint8_t status, uint32_t micros) = nullptr;
+
+  void sendRealTimeNow(uint8_t status, uint8_t data) {
+    uint32_t now = micros();
+    if (!firstSend) firstSend = now;
+    if (status == 0xF1) {
+      usbMIDI.sendTimeCodeQuarterFrame(data);
+      usbMIDI.send_now();
+      HWMIDI.sendTimeCodeQuarterFrame(data);
+    } else {
+      usbMIDI.sendRealTime(status);
+      usbMIDI.send_now();
+      HWMIDI.sendRealTime((midi::MidiType)status);
+    }
+    if (realTimeSent) realTimeSent(status, now);
+  }
+
+  // real-time messages from the timers wait in the lane until endSend()
+  inline void holdRealTime() {
+    sending++;
+  }
+  inline void startSend() {
+    holdRealTime();
+    if (!firstSend) firstSend = micros();
+  }
+  // anything the lane held back goes now, before the loop sends again. A send
+  // from a read's handler leaves the lane to the read's endSend()
+  void endSend() {
+    for (;;) {
+      __disable_irq();
+      if (sending > 1 || laneCount == 0) {
+        sending--;
+        __enable_irq();
+        return;
+      }
+      uint8_t status = lane[laneHead][0];
+      uint8_t data = lane[laneHead][1];
+      laneHead = (laneHead + 1) % laneSize;
+      laneCount--;
+      __enable_irq();
+      sendRealTimeNow(status, data);
+    }
+  }
+  inline bool received(bool got) {
+    if (got && !firstReceive) firstReceive = micros();
+    return got;
+  }
+  inline void logReceived(uint8_t type, uint8_t channel, uint8_t data1, uint8_t data2) {
+#if INPUT_RECORD
+    if (type == 0xF0) return;   // SysEx isn't logged
+    uint8_t status = type < 0xF0 ? type | ((channel - 1) & 0x0F) : type;
+    INPUT_EVENT(INPUT_MIDI, status, data1, data2);
+#endif
+  }
 }
 
 namespace MM {
@@ -16,44 +81,105 @@ namespace MM {
 
 	}
 	void sendNoteOn(int note, int velocity, int channel) {
+		startSend();
 		usbMIDI.sendNoteOn(note, velocity, channel);
-		HWMIDI.sendNoteOn(note, velocity, channel);	
-
+		HWMIDI.sendNoteOn(note, velocity, channel);
+		endSend();
 	}
 	void sendNoteOff(int note, int velocity, int channel) {
+		startSend();
 		usbMIDI.sendNoteOff(note, velocity, channel);
 		HWMIDI.sendNoteOff(note, velocity, channel);
-
+		endSend();
 	}
 	void sendControlChange(int control, int value, int channel) {
+		startSend();
 		usbMIDI.sendControlChange(control, value, channel);
 		HWMIDI.sendControlChange(control, value, channel);
+		endSend();
+	}
+	void sendSysEx(int length, const uint8_t* data) {
+		startSend();
+		usbMIDI.sendSysEx(length, data, true);
+		endSend();
 	}
 	
 	void sendClock() {
+		startSend();
 		usbMIDI.sendRealTime(usbMIDI.Clock);
 		HWMIDI.sendClock();
+		endSend();
 	}
 	
 	void startClock(){
+		startSend();
 		usbMIDI.sendRealTime(usbMIDI.Start);
 		HWMIDI.sendStart();
+		endSend();
 	}
 	void continueClock(){
+		startSend();
 		usbMIDI.sendRealTime(usbMIDI.Continue);
 		HWMIDI.sendContinue();
+		endSend();
 	}
 	void stopClock(){
+		startSend();
 		usbMIDI.sendRealTime(usbMIDI.Stop);
 		HWMIDI.sendStop();
+		endSend();
+	}
+
+	void sendRealTime(uint8_t status, uint8_t data){
+		// from a timer interrupt - if it cut into the loop sending, the loop sends it once it's done
+		if (sending) {
+			if (laneCount < laneSize) {
+				int at = (laneHead + laneCount) % laneSize;
+				lane[at][0] = status;
+				lane[at][1] = data;
+				laneCount++;
+			}
+			return;
+		}
+		sending = 1;
+		sendRealTimeNow(status, data);
+		sending = 0;
+	}
+	void setHandleRealTimeSent(void (*handler)(uint8_t status, uint32_t micros)){
+		realTimeSent = handler;
 	}
 
 	// NEED SOMETHING FOR usbMIDI.read() / MIDI.read()
 	
 	bool usbMidiRead(){
-		return usbMIDI.read();
+		if (!received(usbMIDI.read())) return false;
+		logReceived(usbMIDI.getType(), usbMIDI.getChannel(), usbMIDI.getData1(), usbMIDI.getData2());
+		return true;
 	}
 	bool midiRead(){
-		return HWMIDI.read();
+		// the library's soft thru writes what came in back out on Serial1, so a
+		// timer mustn't send on it meanwhile. usbMIDI.read() never writes
+		holdRealTime();
+		bool got = HWMIDI.read();
+		endSend();
+		if (!received(got)) return false;
+		logReceived(HWMIDI.getType(), HWMIDI.getChannel(), HWMIDI.getData1(), HWMIDI.getData2());
+		return true;
+	}
+	void setHandleSysEx(void (*handler)(const uint8_t* data, uint16_t length, bool complete)){
+		// called from usbMidiRead(), possibly several times for one long message
+		usbMIDI.setHandleSystemExclusive(handler);
+	}
+	void setHandleTimeCodeQuarterFrame(void (*handler)(uint8_t data)){
+		// called from usbMidiRead() / midiRead()
+		usbMIDI.setHandleTimeCodeQuarterFrame(handler);
+		HWMIDI.setHandleTimeCodeQuarterFrame(handler);
+	}
+
+	uint32_t firstSendMicros(){
+		return firstSend;
+	}
+	uint32_t firstReceiveMicros(){
+		return firstReceive;
 	}
 }
@@ -1,3 +1,5 @@
+#include <stdint.h>
+
 namespace MM {
 
 	void begin();
@@ -5,6 +7,7 @@ namespace MM {
 	void sendNoteOn(int note, int velocity, int channel);
 	void sendNoteOff(int note, int velocity, int channel);
 	void sendControlChange(int control, int value, int channel);
+	void sendSysEx(int length, const uint8_t* data);	// USB only, data includes F0 / F7
 	
 	
 	void sendClock();
@@ -12,6 +15,21 @@ namespace MM {
 	void continueClock();
 	void stopClock();
 
+	// the real-time lane, for timer interrupts: a clock, or an MTC quarter frame
+	// (0xF1 and its data byte), goes out on its own and at once, flushed rather
+	// than left for the next USB frame, or if loop() is partway through sending a
+	// message or through midiRead() (the DIN soft thru sends), straight after it.
+	// Timers sending on it share a priority. The handler gets micros() as each
+	// one went.
+	void sendRealTime(uint8_t status, uint8_t data = 0);
+	void setHandleRealTimeSent(void (*handler)(uint8_t status, uint32_t micros));
+
 	bool usbMidiRead();
 	bool midiRead();
+	void setHandleSysEx(void (*handler)(const uint8_t* data, uint16_t length, bool complete));
+	void setHandleTimeCodeQuarterFrame(void (*handler)(uint8_t data));
+
+	// micros() when the first message went out / came in, 0 until then
+	uint32_t firstSendMicros();
+	uint32_t firstReceiveMicros();
 }
@@ -22,8 +22,26 @@
 #include "colors.h"
 #include "MM.h"
 #include "ClearUI.h"
+#include "rng.h"
 #include "sequencer.h"
 #include "noteoffs.h"
+#include "journal.h"
+#include "banks.h"
+#include "patterncodec.h"
+#include "sysex.h"
+#include "song.h"
+#include "cclanes.h"
+#include "superstep.h"
+#include "arp.h"
+#include "echo.h"
+#include "ratchet.h"
+#include "groove.h"
+#include "tempo.h"
+#include "clockout.h"
+#include "mtc.h"
+#include "profiler.h"
+#include "trace.h"
+#include "inputlog.h"
 
 
 U8G2_FOR_ADAFRUIT_GFX u8g2_display;
@@ -45,7 +63,18 @@ elapsedMillis pots_msec = 0;
 elapsedMillis dialogTimeout = 0;
 elapsedMillis dirtyDisplayTimer = 0;
 unsigned long displayRefreshRate = 60;
-elapsedMicros clksTimer = 0;		// is this still in use?
+
+#if BOOT_TIMING
+// Boot timing - setup() returns with MIDI live, the splash screen runs from loop()
+Micros setupDoneMicros = 0;
+bool bootTimingReported = false;
+#endif
+
+#if PROFILE_LOOP
+bool profilerPage = false;			// hidden stats page (see dispProfilerPage)
+int profilerSection = PROF_LOOP;
+elapsedMillis profilerRefresh = 0;
+#endif
 
 //unsigned long clksDelay;
 elapsedMillis keyPressTime[27] = {0};
@@ -81,12 +110,21 @@ int patmode = 0;
 int nsmode = 4;
 int nsmode2 = 4;
 int nsmode3 = 4;
+int nsmode4 = 4;
+int nsmode5 = 4;
 int ppmode = 4;
 int ppmode2 = 4;
 int ppmode3 = 4;
+int ppmode4 = 4;
+int ppmode5 = 4;
 int mimode = 4;
+int mipage = 0;
+int arpmode = 4;
+int echomode = 4;
 int sqmode = 4;
 int sqmode2 = 4;
+int sqmode3 = 4;
+int sqmode4 = 4;
 int srmode = 4;
 int srmode2 = 4;
 int modehilight = 4;
@@ -114,13 +152,21 @@ bool pastedFlag = false;
 bool clearedFlag = false;
 
 bool enc_edit = false;
+bool ccRecord = false;		// pot moves while playing go to the pattern's CC lanes, F1 + F2 + AUX
 bool midiAUX = false;
 
 int defaultVelocity = 100;
+
+// ARPEGGIATOR (see arp.h)
+bool arpOn = false;
+int arpRate = 2;			// index into multValues, 1/16
+int arpGate = 50;			// note length, percent of the arp step
+Micros nextArpTime = 0;
 int octave = 0;			// default C4 is 0 - range is -4 to +5
 int newoctave = octave;
 int transpose = 0;
 int rotationAmt = 0;
+int songSlot = 0;		// slot on the song page, 1 - Song::maxSlots, 0 = song mode off
 int hline = 8;
 int pitchCV;
 uint8_t RES;
@@ -159,15 +205,44 @@ Adafruit_NeoPixel strip(LED_COUNT, LED_PIN, NEO_GRB + NEO_KHZ800);
 
 // ####### CLOCK/TIMING #######
 
-void advanceClock(Micros advance) {
-	static Micros timeToNextClock = 0;
-	while (advance >= timeToNextClock) {
-		advance -= timeToNextClock;		
+// tempo changes the clock has taken on but the loop hasn't reached, see setTempo()
+struct PendingTempo {
+	Micros from;
+	Micros interval;		// ppqInterval from then on
+};
+const int maxPendingTempos = 4;
+PendingTempo pendingTempos[maxPendingTempos];
+int pendingTempoCount = 0;
+
+// MIDI time code, see mtc.h and chaseMtc()
+int mtcMode = MTC_MODE_OFF;
+bool chasing = false;			// playing because time code is coming in
+uint64_t chasePosition;			// where the time code was when the patterns were put in place
+Micros chaseAt;
+
+// the ticks the clock's timer has sent since the last pass, see clockout.h
+void advanceClock() {
+	ClockOut::Tick tick;
+	while (clockOut.tick(tick)) {
+		TRACE_EVENT(TRACE_CLOCK, tick.due, tick.sent, TRACE_NO_PATTERN, 0, 0);
+		while (pendingTempoCount > 0 && (int32_t)(tick.due - pendingTempos[0].from) >= 0) {
+			changeTempo(pendingTempos[0].interval, pendingTempos[0].from);
+			pendingTempoCount--;
+			memmove(pendingTempos, pendingTempos + 1, pendingTempoCount * sizeof(PendingTempo));
+		}
+		if (ticks % (24 * 4) == 0) {
+			barStart = true;	// 24 MIDI clocks per quarter, 4/4
+		}
+		ticks++;
+		if (tempoRamp.active()) {
+			setTempo(tempoRamp.tick());		// a step of the ramp on every tick
+		}
 
-		MM::sendClock();
-		timeToNextClock = ppqInterval * (PPQ / 24);
+		// the next tick that starts a bar, once song mode has had this one (see doStep())
+		if (!song.playing() || nextBarTime > tick.due) {
+			nextBarTime = tick.due + ((24 * 4 - ticks % (24 * 4)) % (24 * 4) + 1) * ppqInterval * (PPQ / 24);
+		}
 	}
-	timeToNextClock -= advance;
 }
 
 void advanceSteps(Micros advance) {
@@ -179,25 +254,85 @@ void advanceSteps(Micros advance) {
 
 		// turn off any expiring notes
 		pendingNoteOffs.play(micros());
+
+		// CC lane values, ahead of the notes they go with
+		pendingControlChanges.play(micros());
 				
 		// turn on any pending notes
 		pendingNoteOns.play(micros());
+
+		// and echoes of earlier ones
+		echo.play(micros());
 	}
 	timeToNextStep -= advance;
 }
 
 void resetClocks(){
 	// BPM tempo to step_delay calculation
-	ppqInterval = 60000000/(PPQ * clockbpm); 		// ppq interval is in microseconds
+	setPpqInterval(60000000/(PPQ * clockbpm)); 		// ppq interval is in microseconds
+}
+
+void setPpqInterval(Micros interval){
+	ppqInterval = interval;
 	step_micros = ppqInterval * (PPQ/4); 			// 16th note step in microseconds (quarter of quarter note)
 	
 	// 16th note step length in milliseconds
 	step_delay = step_micros * 0.001; 	// ppqInterval * 0.006; // 60000 / clockbpm / 4; 
+
+	for (int p=0; p<NUM_PATTERNS; p++){
+		updatePlanTiming(p);
+	}
+}
+
+// a new tempo from a MIDI clock tick on, see tempo.h. The clock's timer can't
+// cut short the tick it's counting down, so while playing that's the tick
+// after next - the loop changes over when the clock gets there.
+void setTempo(float bpm){
+	clockbpm = bpm;
+	Micros interval = 60000000/(PPQ * clockbpm);
+	if (!playing) {
+		changeTempo(interval, micros());
+		return;
+	}
+	Micros from = clockOut.change(interval * (PPQ / 24));
+	if (pendingTempoCount > 0 && pendingTempos[pendingTempoCount - 1].from == from) {
+		pendingTempos[pendingTempoCount - 1].interval = interval;		// before the clock's had the last one
+	} else {
+		if (pendingTempoCount == maxPendingTempos) {
+			// the loop's that far behind the clock, catch up with the oldest now
+			changeTempo(pendingTempos[0].interval, pendingTempos[0].from);
+			pendingTempoCount--;
+			memmove(pendingTempos, pendingTempos + 1, pendingTempoCount * sizeof(PendingTempo));
+		}
+		pendingTempos[pendingTempoCount++] = { from, interval };
+	}
+	dirtyDisplay = true;
+}
+
+// a new PPQ interval from tickTime on, what's scheduled after it keeps its place in the beat
+void changeTempo(Micros interval, Micros tickTime){
+	TempoChange change = { (uint32_t)tickTime, (uint32_t)ppqInterval, (uint32_t)interval };
+	setPpqInterval(interval);
+	if (change.newTick == change.oldTick) {
+		return;
+	}
+	for (int p = 0; p < NUM_PATTERNS; p++){
+		nextStepTimeP[p] = change.map(nextStepTimeP[p]);
+	}
+	nextStepDue = 0;		// the next sweep works it out again
+	nextBarTime = change.map(nextBarTime);
+	nextArpTime = change.map(nextArpTime);
+	pendingNoteOffs.retime(change);
+	pendingControlChanges.retime(change);
+	pendingNoteOns.retime(change);
+	echo.retime(change);
+	dirtyDisplay = true;
 }
 
 void setGlobalSwing(int swng_amt){
 	for(int z=0; z<NUM_PATTERNS; z++) {
 		patternSettings[z].swing = swng_amt;
+		updatePlanTiming(z);
 	}
 }
 
@@ -224,6 +359,7 @@ void readPotentimeters(){
     	analogValues[k] = temp >> 7;
    	
     	if(analog[k]->hasChanged()) {
+			INPUT_EVENT(INPUT_POT, k, analog[k]->getValue() & 0xFF, analog[k]->getValue() >> 8);
        		// do stuff		   	
 			switch(omxMode) { 
 				case MODE_OM:
@@ -243,6 +379,7 @@ void readPotentimeters(){
 						
 						if (k < 4){ // only store p-lock value for first 4 knobs
 							stepNoteP[playingPattern][selectedStep].params[k] = analogValues[k];
+							updatePlanStep(playingPattern, selectedStep);
 							sendPots(k, PatternChannel(playingPattern));
 						}
 						sendPots(k, PatternChannel(playingPattern));					
@@ -259,9 +396,13 @@ void readPotentimeters(){
 						} else if (k == 4){
 							stepNoteP[playingPattern][seqPos[playingPattern]].vel = analogValues[k]; // SET POT 5 to NOTE VELOCITY HERE
 						}
+						updatePlanStep(playingPattern, seqPos[playingPattern]);
 						dirtyDisplay = true;
 					} else if (!noteSelect || !stepRecord){
 						sendPots(k, PatternChannel(playingPattern));
+						if (ccRecord && playing){
+							recordLane(k);
+						}
 					}
 					break;  
 
@@ -278,9 +419,18 @@ void readPotentimeters(){
 
 void setup() {
 	Serial.begin(115200);
+#if INPUT_RECORD
+	inputLog.begin();
+#endif
+
+	// HW MIDI - get MIDI, clock and the sequencer going first, the splash screen
+	// runs from loop() afterwards (see updateBootAnimation)
+	MM::begin();
 
 	dialogTimeout = 0;
-	clksTimer = 0;
+#if PROFILE_LOOP
+	loopProfiler.begin();
+#endif
 	
 	lastProcessTime = micros();
 	resetClocks();
@@ -288,11 +438,15 @@ void setup() {
 	nextStepTime = micros();
 	lastStepTime = micros();
 	for (int x=0; x<NUM_PATTERNS; x++){
-		timePerPattern[x].nextStepTimeP = nextStepTime; // initialize all patterns
-		timePerPattern[x].lastStepTimeP = lastStepTime; // initialize all patterns
+		nextStepTimeP[x] = nextStepTime; // initialize all patterns
+		lastStepTimeP[x] = lastStepTime; // initialize all patterns
 		patternSettings[x].clockDivMultP = 2; // set all DivMult to 2 for now
+		resetAutoreset(x);
 	}
-	randomSeed(analogRead(13));
+	nextStepDue = nextStepTime;
+	int seed = analogRead(13);
+	INPUT_EVENT(INPUT_SEED, 0, seed & 0xFF, seed >> 8);
+	bootSeed = seed;
 	
 	// SET ANALOG READ resolution to teensy's 13 usable bits
 	analogReadResolution(13);
@@ -311,9 +465,6 @@ void setup() {
 		lastMidiValue[i] = 0;
 	}
 
-	// HW MIDI
-	MM::begin();
-		
 	//CV gate pin
 	pinMode(CVGATE_PIN, OUTPUT); 
 
@@ -325,7 +476,17 @@ void setup() {
     analogWrite(CVPITCH_PIN, 0);
 
 	// Load from EEPROM
+	initPatternDefaults();
+#if PATTERNS_IN_EEPROM
+	patternJournal.begin(
+		{ (uint8_t*)stepNoteP, sizeof(StepNote), NUM_PATTERNS * NUM_STEPS, EEPROM_PATTERN_ADDRESS },
+		{ (uint8_t*)patternSettings, sizeof(PatternSettings), NUM_PATTERNS, EEPROM_PATTERN_SETTINGS_ADDRESS },
+		EEPROM_JOURNAL_ADDRESS, EEPROM.length() );
+#endif
 	bool bLoaded = loadFromEEPROM();
+#if PROFILE_LOOP && PATTERNS_IN_EEPROM
+	loopProfiler.record(PROF_REPLAY, patternJournal.replayMicros() * (F_CPU / 1000000));
+#endif
 	if ( !bLoaded )
 	{
 		// Failed to load due to initialized EEPROM or version mismatch
@@ -340,45 +501,44 @@ void setup() {
 		pots[4] = CC5;
 		initPatterns();
 	}
+	patternBanks.begin();
+#if !PATTERNS_IN_EEPROM
+	// too big for EEPROM, the patterns live in the current bank's file
+	if ( bLoaded ) {
+		patternBanks.load( currentBank, bankImage( &bankStepNoteP[0][0], bankPatternSettings ) );
+		while ( patternBanks.loading() ) patternBanks.update();
+		swapBank();
+	}
+#endif
+	seedPatternStreams();
+	updateAllPlans();
+
+	// pattern dump / load over SysEx, loads land in the bank shadow copy
+	patternSysEx.begin( bankImage( &bankStepNoteP[0][0], bankPatternSettings ) );
+	MM::setHandleSysEx( onSysEx );
+	MM::setHandleTimeCodeQuarterFrame( onQuarterFrame );
+
+	// Keypad
+	customKeypad.begin();
 
   	// Init Display
 	initializeDisplay();
 	u8g2_display.begin(display);
-	
-	// Startup screen		
-	display.clearDisplay();
-	testdrawrect();
-	delay(200);
 	display.clearDisplay();
 	u8g2_display.setForegroundColor(WHITE);
 	u8g2_display.setBackgroundColor(BLACK);
-	drawLoading();
-
-	// Keypad
-	customKeypad.begin();
 
 	//LEDs
 	strip.begin();           // INITIALIZE NeoPixel strip object (REQUIRED)
 	strip.show();            // Turn OFF all pixels ASAP
 	strip.setBrightness(LED_BRIGHTNESS); // Set BRIGHTNESS to about 1/5 (max = 255)
-	for(int i=0; i<LED_COUNT; i++) { // For each pixel...
-		strip.setPixelColor(i, HALFWHITE);
-		strip.show();   // Send the updated pixel colors to the hardware.
-		delay(5); // Pause before next pass through loop
-	}
-	rainbow(5); // rainbow startup pattern
-	delay(500);
-	
-	// clear LEDs
-	strip.fill(0, 0, LED_COUNT);
-	strip.show();
 
-	delay(100);
+	// Startup screen and LEDs - non-blocking, see updateBootAnimation()
+	startBootAnimation();
 
-	// Clear display
-	display.display();			
-
-	dirtyDisplay = true;
+#if BOOT_TIMING
+	setupDoneMicros = micros();
+#endif
 }
 
 // ####### END SETUP #######
@@ -419,9 +579,9 @@ void show_current_step(int patternNum) {
 	} else if (noteSelect && blinkState){
 		strip.setPixelColor(0, NOTESEL);
 	} else if (patternParams && blinkState){
-		strip.setPixelColor(0, seqColors[patternNum]);
+		strip.setPixelColor(0, seqColors[patternNum % NUM_PATTERN_KEYS]);
 	} else if (stepRecord && blinkState){
-		strip.setPixelColor(0, seqColors[patternNum]);
+		strip.setPixelColor(0, seqColors[patternNum % NUM_PATTERN_KEYS]);
 	} else {
 		switch(omxMode){
 			case MODE_S1:
@@ -437,18 +597,32 @@ void show_current_step(int patternNum) {
 	}
 
 	if (patternSettings[patternNum].mute) {
-		stepColor = muteColors[patternNum];
+		stepColor = muteColors[patternNum % NUM_PATTERN_KEYS];
 	} else {
-		stepColor = seqColors[patternNum];
-		muteColor = muteColors[patternNum];
+		stepColor = seqColors[patternNum % NUM_PATTERN_KEYS];
+		muteColor = muteColors[patternNum % NUM_PATTERN_KEYS];
+	}
+
+	// the step keys show one page of a long pattern. Step record shows the
+	// record position's page, playback turns the page when the playhead does.
+	static int playheadPage = 0;
+	if (stepRecord) {
+		stepPage = constrain(seqPos[playingPattern] / NUM_STEP_KEYS, 0, NUM_STEP_PAGES - 1);
+	} else if (playing && !noteSelect) {
+		int page = constrain(seqPos[patternNum] / NUM_STEP_KEYS, 0, NUM_STEP_PAGES - 1);
+		if (page != playheadPage) {
+			playheadPage = page;
+			stepPage = page;
+		}
 	}
+	int firstStep = stepPage * NUM_STEP_KEYS;
 
 	if (noteSelect && noteSelection) {
-		for(int j = 1; j < NUM_STEPS+11; j++){
-			if (j < PatternLength(patternNum)+11){
+		for(int j = 1; j < NUM_STEP_KEYS+11; j++){
+			if (j < PatternLength(patternNum)-firstStep+11){
 				if (j == selectedNote){
 					strip.setPixelColor(j, HALFWHITE);
-				} else if (j == selectedStep+11){
+				} else if (j == selectedStep-firstStep+11){
 					strip.setPixelColor(j, SEQSTEP);
 				} else{
 					strip.setPixelColor(j, LEDOFF);
@@ -459,9 +633,9 @@ void show_current_step(int patternNum) {
 		}
 		
 	} else if (stepRecord) {
-		for(int j = 1; j < NUM_STEPS+11; j++){
-			if (j < PatternLength(patternNum)+11){
-				if (j == seqPos[playingPattern]+11){ 
+		for(int j = 1; j < NUM_STEP_KEYS+11; j++){
+			if (j < PatternLength(patternNum)-firstStep+11){
+				if (j == seqPos[playingPattern]-firstStep+11){ 
 					strip.setPixelColor(j, SEQCHASE);
 //				} else if (j == selectedNote){
 //					strip.setPixelColor(j, HALFWHITE);
@@ -485,8 +659,8 @@ void show_current_step(int patternNum) {
 //			}
 //		}	
 	} else {
-		for(int j = 1; j < NUM_STEPS+11; j++){		
-			if (j < PatternLength(patternNum)+11){
+		for(int j = 1; j < NUM_STEP_KEYS+11; j++){		
+			if (j < PatternLength(patternNum)-firstStep+11){
 				if (j == 1) {								
 
 					// NOTE SELECT
@@ -504,7 +678,7 @@ void show_current_step(int patternNum) {
 						strip.setPixelColor(j, FUNKTWO);
 					}
 					
-				} else if (j == patternNum+3){  			// PATTERN SELECT
+				} else if (j == patternNum % NUM_PATTERN_KEYS + 3){  			// PATTERN SELECT
 					strip.setPixelColor(j, stepColor); 
 					if (patternParams && blinkState){
 						strip.setPixelColor(j, LEDOFF);						
@@ -517,75 +691,76 @@ void show_current_step(int patternNum) {
 			}
 		}
 
-		for(int i = 0; i < NUM_STEPS; i++){
+		for(int k = 0; k < NUM_STEP_KEYS; k++){
+			int i = firstStep + k;
 			if (i < PatternLength(patternNum)){
 				if (patternParams){
- 					strip.setPixelColor(i+11, SEQMARKER); 
+ 					strip.setPixelColor(k+11, SEQMARKER); 
  				}
 
 				if(i % 4 == 0){ // mark groups of 4
 					if(i == seqPos[patternNum]){
 						if (playing){
-							strip.setPixelColor(i+11, SEQCHASE); // step chase
+							strip.setPixelColor(k+11, SEQCHASE); // step chase
 						} else if (stepNoteP[patternNum][i].trig == TRIGTYPE_PLAY){
 							if (stepNoteP[patternNum][i].stepType != STEPTYPE_NONE){
 								if (slowBlinkState){
-									strip.setPixelColor(i+11, stepColor); // step event color
+									strip.setPixelColor(k+11, stepColor); // step event color
 								}else{
-									strip.setPixelColor(i+11, muteColor); // step event color
+									strip.setPixelColor(k+11, muteColor); // step event color
 								}
 							} else {
-								strip.setPixelColor(i+11, stepColor); // step on color
+								strip.setPixelColor(k+11, stepColor); // step on color
 							}
 						} else if (stepNoteP[patternNum][i].trig == TRIGTYPE_MUTE){
-							strip.setPixelColor(i+11, SEQMARKER); 
+							strip.setPixelColor(k+11, SEQMARKER); 
 						}
 						
 					} else if (stepNoteP[patternNum][i].trig == TRIGTYPE_PLAY){
 						if (stepNoteP[patternNum][i].stepType != STEPTYPE_NONE){
 							if (slowBlinkState){
-								strip.setPixelColor(i+11, stepColor); // step event color
+								strip.setPixelColor(k+11, stepColor); // step event color
 							}else{
-								strip.setPixelColor(i+11, muteColor); // step event color
+								strip.setPixelColor(k+11, muteColor); // step event color
 							}
 						} else {
-							strip.setPixelColor(i+11, stepColor); // step on color
+							strip.setPixelColor(k+11, stepColor); // step on color
 						}
 					} else if (stepNoteP[patternNum][i].trig == TRIGTYPE_MUTE){
-						strip.setPixelColor(i+11, SEQMARKER); 
+						strip.setPixelColor(k+11, SEQMARKER); 
 					}
 					
 				} else if (i == seqPos[patternNum]){ 	// step chase
 					if (playing){
-						strip.setPixelColor(i+11, SEQCHASE); 
+						strip.setPixelColor(k+11, SEQCHASE); 
 
 					} else if (stepNoteP[patternNum][i].trig == TRIGTYPE_PLAY){
 						if (stepNoteP[patternNum][i].stepType != STEPTYPE_NONE){
 							if (slowBlinkState){
-								strip.setPixelColor(i+11, stepColor); // step event color
+								strip.setPixelColor(k+11, stepColor); // step event color
 							}else{
-								strip.setPixelColor(i+11, muteColor); // step event color
+								strip.setPixelColor(k+11, muteColor); // step event color
 							}
 						} else {
-							strip.setPixelColor(i+11, stepColor); // step on color
+							strip.setPixelColor(k+11, stepColor); // step on color
 						}
 					} else if (stepNoteP[patternNum][i].trig == TRIGTYPE_MUTE){
-						strip.setPixelColor(i+11, LEDOFF);  // DO WE NEED TO MARK PLAYHEAD WHEN STOPPED?
+						strip.setPixelColor(k+11, LEDOFF);  // DO WE NEED TO MARK PLAYHEAD WHEN STOPPED?
 					}
 
 				} else if (stepNoteP[patternNum][i].trig == TRIGTYPE_PLAY){
 					if (stepNoteP[patternNum][i].stepType != STEPTYPE_NONE){
 						if (slowBlinkState){
-							strip.setPixelColor(i+11, stepColor); // step event color
+							strip.setPixelColor(k+11, stepColor); // step event color
 						}else{
-							strip.setPixelColor(i+11, muteColor); // step event color
+							strip.setPixelColor(k+11, muteColor); // step event color
 						}
 					} else {
-						strip.setPixelColor(i+11, stepColor); // step on color
+						strip.setPixelColor(k+11, stepColor); // step on color
 					}
 
 				} else if (!patternParams && stepNoteP[patternNum][i].trig == TRIGTYPE_MUTE){
-					strip.setPixelColor(i+11, LEDOFF); 
+					strip.setPixelColor(k+11, LEDOFF); 
 				}
 
 			}
@@ -641,6 +816,36 @@ void dispGenericMode(int submode, int selected){
 			legendVals[2] = potVal;
 			legendVals[3] = midiLastNote;
 			break;
+		case SUBMODE_ARP:
+			legends[0] = "ARP";
+			legends[1] = "OCT";
+			legends[2] = "RATE";
+			legends[3] = "GATE";
+			legendVals[0] = -127;
+			legendText[0] = arpOn ? Arpeggiator::modeNames[arp.mode] : "OFF";
+			legendVals[1] = arp.octaves;
+			legendVals[2] = -127;
+			legendText[2] = mdivs[arpRate];
+			legendVals[3] = arpGate;
+			break;
+		case SUBMODE_ECHO: {
+			const Echo::Settings& e = echo.settings[omxMode == MODE_MIDI ? Echo::midiSource : playingPattern];
+			legends[0] = "ECHO";
+			legends[1] = "FDBK";
+			legends[2] = "TIME";
+			legends[3] = "PTCH";
+			if (e.repeats == 0) {
+				legendVals[0] = -127;
+				legendText[0] = "OFF";
+			} else {
+				legendVals[0] = e.repeats;
+			}
+			legendVals[1] = e.feedback;
+			legendVals[2] = -127;
+			legendText[2] = mdivs[e.time];
+			legendVals[3] = e.shift;
+			break;
+		}
 		case SUBMODE_SEQ:
 			legends[0] = "PTN";
 			legends[1] = "TRSP";
@@ -669,6 +874,31 @@ void dispGenericMode(int submode, int selected){
 				legendText[3] = "Off"; 
 			}
 			break;
+		case SUBMODE_SEQ3:
+			legends[0] = "GRV";
+			legends[1] = "TO";
+			legends[2] = "BARS";
+			legends[3] = "RAMP";
+			legendVals[0] = -127;
+			legendText[0] = Grooves::table[patternSettings[playingPattern].groove].name;
+			legendVals[1] = tempoRamp.target;
+			legendVals[2] = tempoRamp.bars;
+			legendVals[3] = -127;
+			legendText[3] = tempoRamp.active() ? "On" : "Off";
+			break;
+		case SUBMODE_SEQ4:
+			legends[0] = "MTC";
+			legends[1] = "FPS";
+			legends[2] = "LOCK";
+			legends[3] = "";
+			legendVals[0] = -127;
+			legendText[0] = Mtc::modeNames[mtcMode];
+			legendVals[1] = -127;
+			legendText[1] = Mtc::rateNames[chasing ? mtcIn.rate : mtcOut.rate];		// chasing, the incoming rate
+			legendVals[2] = -127;
+			legendText[2] = chasing ? "On" : "Off";
+			legendVals[3] = -127;
+			break;
 		case SUBMODE_PATTPARAMS:
 			legends[0] = "PTN";
 			legends[1] = "LEN";
@@ -692,16 +922,46 @@ void dispGenericMode(int submode, int selected){
 		case SUBMODE_PATTPARAMS3:
 			legends[0] = "RATE";
 			legends[1] = "SOLO";
-			legends[2] = "---";
-			legends[3] = "---";
+			legends[2] = "BANK";
+			legends[3] = "SEED";
 
 			// RATE FOR CURR PATTERN
 			legendVals[0] = -127;
 			legendText[0] = mdivs[patternSettings[playingPattern].clockDivMultP]; 
 	
 			legendVals[1] = patternSettings[playingPattern].solo; 
-			legendVals[2] = 0; 			// TBD
-			legendVals[3] = 0;			// TBD
+			legendVals[2] = shownBank() + 1;	// bank we're on or switching to
+			if (patternSeed == 0) {
+				legendVals[3] = -127;
+				legendText[3] = "OFF";
+			} else {
+				legendVals[3] = patternSeed;
+			}
+			break;
+		case SUBMODE_PATTPARAMS4:
+			legends[0] = "SONG";
+			legends[1] = "BANK";
+			legends[2] = "PTN";
+			legends[3] = "BARS";
+			if (songSlot == 0) {
+				legendVals[0] = -127;
+				legendText[0] = "OFF";
+				legendVals[1] = -127;
+				legendVals[2] = -127;
+				legendVals[3] = -127;
+				legendText[1] = legendText[2] = legendText[3] = "-";
+			} else {
+				const Song::Slot& slot = song.slot(songSlot - 1);
+				legendVals[0] = songSlot;
+				legendVals[1] = slot.bank + 1;
+				legendVals[2] = slot.pattern + 1;
+				if (slot.bars == 0) {
+					legendVals[3] = -127;
+					legendText[3] = "END";
+				} else {
+					legendVals[3] = slot.bars;
+				}
+			}
 			break;
 		case SUBMODE_STEPREC:
 			legends[0] = "OCT";
@@ -744,7 +1004,7 @@ void dispGenericMode(int submode, int selected){
 			legends[0] = "TYPE";
 			legends[1] = "PROB";
 			legends[2] = "COND";
-			legends[3] = "";
+			legends[3] = "NUDG";
 			legendVals[0] = -127;
 			legendText[0] = stepTypes[stepNoteP[playingPattern][selectedStep].stepType];
 
@@ -755,8 +1015,46 @@ void dispGenericMode(int submode, int selected){
 			legendVals[2] = -127;
 			legendText[2] = trigConditions[stepNoteP[playingPattern][selectedStep].condition]; //ac + bc; // trigConditions
 			
+			legendVals[3] = stepNoteP[playingPattern][selectedStep].nudge;
+			break;
+
+		case SUBMODE_NOTESEL4: {
+			int8_t lfo = stepNoteP[playingPattern][selectedStep].params[4];
+			legends[0] = "LFO";
+			legends[1] = "RATE";
+			legends[2] = "DEST";
+			legends[3] = "";
+			legendVals[0] = legendVals[1] = legendVals[2] = -127;
+			if (lfo < 0) {
+				legendText[0] = "OFF";
+				legendText[1] = legendText[2] = "-";
+			} else {
+				legendText[0] = SuperSteps::waveNames[SuperSteps::wave(lfo)];
+				legendText[1] = SuperSteps::rateNames[SuperSteps::rate(lfo)];
+				legendVals[2] = SuperSteps::dest(lfo) + 1;		// L-1 - L-4
+			}
 			legendVals[3] = 0;
 			break;
+		}
+		case SUBMODE_NOTESEL5: {
+			const StepNote& n = stepNoteP[playingPattern][selectedStep];
+			legends[0] = "RTCH";
+			legends[1] = "VEL";
+			legends[2] = "SPC";
+			legends[3] = "";
+			legendVals[1] = legendVals[2] = -127;
+			if (n.ratchet == 0) {
+				legendVals[0] = -127;
+				legendText[0] = "OFF";
+				legendText[1] = legendText[2] = "-";
+			} else {
+				legendVals[0] = n.ratchet + 1;
+				legendText[1] = Ratchets::velocityNames[n.ratchetVel];
+				legendText[2] = Ratchets::spacingNames[n.ratchetSpace];
+			}
+			legendVals[3] = 0;
+			break;
+		}
 
 		default:
 			break;
@@ -862,37 +1160,61 @@ void dispMode(){
 // ############## MAIN LOOP ##############
 
 void loop() {
+	PROFILE_SCOPE(PROF_LOOP);
+	INPUT_LOOP(micros());
+
+	PROFILE_BEGIN(PROF_KEYPAD);
 	customKeypad.tick();
-	clksTimer = 0;
+	PROFILE_END(PROF_KEYPAD);
+
+	bool booting = updateBootAnimation();
+#if BOOT_TIMING
+	reportBootTiming();
+#endif
 	
 	Micros now = micros();
 	Micros passed = now - lastProcessTime;
 	lastProcessTime = now;
 	
+	PROFILE_BEGIN(PROF_CLOCK);
 	if (passed > 0) {
 		if (playing){
-			advanceClock(passed);
+			advanceClock();
 			advanceSteps(passed);
 		}
 	}
+	PROFILE_END(PROF_CLOCK);
 	doStep();
 	
 	// DISPLAY SETUP
-	display.clearDisplay();
+	if (!booting) {
+		display.clearDisplay();
+	}
 				
 	// ############### POTS ###############
 	//
+	PROFILE_BEGIN(PROF_POTS);
 	readPotentimeters();
+	PROFILE_END(PROF_POTS);
 	
 
 	// ############### ENCODER ###############
 	// 
+	PROFILE_BEGIN(PROF_ENCODER);
 	auto u = myEncoder.update();
 	if (u.active()) {
+		INPUT_EVENT(INPUT_ENCODER, u.dir(), u.accel(1) * u.dir() - 1, 0);
+		endBootAnimation();
     	auto amt = u.accel(5); // where 5 is the acceleration factor if you want it, 0 if you don't)
 //    	Serial.println(u.dir() < 0 ? "ccw " : "cw ");
 //    	Serial.println(amt);
     	
+#if PROFILE_LOOP
+		if (profilerPage) {
+			profilerSection = constrain(profilerSection + u.dir(), 0, NUM_PROF_SECTIONS - 1);
+			dirtyDisplay = true;
+		} else
+#endif
 		// Change Mode
     	if (enc_edit) {
 			// set mode
@@ -916,6 +1238,29 @@ void loop() {
   					dirtyDisplay = true;
 //					break;
 				case MODE_MIDI: // MIDI			
+					if (omxMode == MODE_MIDI && mimode == 4 && arpmode == 4 && echomode == 4) {		// CHANGE PAGE
+						mipage = constrain(mipage + amt, 0, 2);
+					}
+					if (echomode < 4) {					// ECHO, see changeEcho()
+						changeEcho(Echo::midiSource, echomode, amt);
+					}
+					if (arpmode == 0) {					// ARP MODE, OFF BELOW UP
+						int newArp = constrain((arpOn ? (int)arp.mode : -1) + amt, -1, ARP_MODES - 1);
+						if ((newArp >= 0) != arpOn) {
+							arpOn = newArp >= 0;
+							arp.releaseAll();			// keys held from before go on as they were
+						}
+						if (arpOn) {
+							arp.mode = (ArpMode)newArp;
+						}
+					} else if (arpmode == 1) {			// ARP OCTAVE RANGE
+						arp.octaves = constrain(arp.octaves + amt, 1, Arpeggiator::maxOctaves);
+					} else if (arpmode == 2) {			// ARP RATE
+						arpRate = constrain(arpRate + amt, 0, 6);
+					} else if (arpmode == 3) {			// ARP GATE
+						arpGate = constrain(arpGate + amt, 1, 100);
+					}
+
 					if (mimode == 1) { // set length
 						int newchan = constrain(midiChannel + amt, 1, 16);
 						if (newchan != midiChannel){
@@ -934,13 +1279,13 @@ void loop() {
 				case MODE_S1: // SEQ 1
 					// FALL THROUGH
 				case MODE_S2: // SEQ 2
-					if (sqmode == 4 && sqmode2 == 4 ) {  // CHANGE PAGE
-						sqpage = constrain(sqpage + amt, 0, 1);
+					if (sqmode == 4 && sqmode2 == 4 && sqmode3 == 4 && sqmode4 == 4) {  // CHANGE PAGE
+						sqpage = constrain(sqpage + amt, 0, 3);
 					}
 
 					// SEQ MODE PAGE 1
 					if (sqmode == 0){ 
-						playingPattern = constrain(playingPattern + amt, 0, 7);
+						playingPattern = constrain(playingPattern + amt, 0, NUM_PATTERNS - 1);
 						if (patternSettings[playingPattern].solo){
 							setAllLEDS(0,0,0);
 						}
@@ -954,6 +1299,7 @@ void loop() {
 						int newswing = constrain(patternSettings[playingPattern].swing + amt, 0, maxswing-1); // -1 to deal with display values
 						swing = newswing;
 						patternSettings[playingPattern].swing = newswing;
+						updatePlanTiming(playingPattern);
 //						setGlobalSwing(newswing);
 //						Serial.println(patternSettings[playingPattern].swing);			
 					} else if (sqmode == 3){ 
@@ -961,8 +1307,8 @@ void loop() {
 						newtempo = constrain(clockbpm + amt, 40, 300);
 						if (newtempo != clockbpm){
 							// SET TEMPO HERE
-							clockbpm = newtempo;
-							resetClocks();
+							tempoRamp.stop();
+							setTempo(newtempo);
 						}
 					}
 
@@ -977,16 +1323,63 @@ void loop() {
 						}
 					} else if (sqmode2 == 1){ 
 						// SET PATTERN LENGTH
-						SetPatternLength( playingPattern, constrain(PatternLength(playingPattern) + amt, 1, 16) );					
+						SetPatternLength( playingPattern, constrain(PatternLength(playingPattern) + amt, 1, NUM_STEPS) );					
 					} else if (sqmode2 == 2){  
 						// SET CLOCK DIV/MULT
 						patternSettings[playingPattern].clockDivMultP = constrain(patternSettings[playingPattern].clockDivMultP + amt, 0, NUM_MULTDIVS-1); 
+						updatePlanTiming(playingPattern);
 					} else if (sqmode2 == 3){  
 						// SET CV ON/OFF
 						cvPattern[playingPattern] = constrain(cvPattern[playingPattern] + amt, 0, 1);
 					}
 
-					
+					// SEQ MODE PAGE 3
+					if (sqmode3 == 0){ 
+						// SET GROOVE
+						patternSettings[playingPattern].groove = constrain(patternSettings[playingPattern].groove + amt, 0, Grooves::count - 1);
+						updatePlan(playingPattern);		// the groove's velocities are in the steps
+					} else if (sqmode3 == 1){ 
+						// SET RAMP TARGET TEMPO
+						tempoRamp.target = constrain(tempoRamp.target + amt, 40, 300);
+					} else if (sqmode3 == 2){ 
+						// SET RAMP LENGTH IN BARS
+						tempoRamp.bars = constrain(tempoRamp.bars + amt, 1, 16);
+					} else if (sqmode3 == 3){ 
+						// START / STOP THE RAMP, IT GOES A STEP EVERY CLOCK TICK WHILE PLAYING
+						if (amt > 0 && tempoRamp.target != clockbpm){
+							tempoRamp.start(clockbpm);
+						} else if (amt < 0){
+							tempoRamp.stop();
+						}
+					}
+
+					// SEQ MODE PAGE 4
+					if (sqmode4 == 0){ 
+						// MTC OFF / OUT / CHASE
+						int newmode = constrain(mtcMode + amt, 0, MTC_MODES - 1);
+						if (newmode != mtcMode){
+							if (mtcMode == MTC_MODE_OUT){
+								mtcOut.stop(micros());
+							}
+							chasing = false;		// stays playing, it's the unit's again
+							mtcMode = newmode;
+							if (mtcMode == MTC_MODE_OUT && playing){
+								mtcOut.start(micros());
+							}
+						}
+					} else if (sqmode4 == 1){ 
+						// SET MTC OUT FRAME RATE
+						int newrate = constrain(mtcOut.rate + amt, 0, MTC_RATES - 1);
+						if (newrate != mtcOut.rate){
+							bool running = mtcOut.running();
+							mtcOut.stop(micros());
+							mtcOut.rate = newrate;
+							if (running){
+								mtcOut.start(micros());
+							}
+						}
+					}
+
   					dirtyDisplay = true;
 					break;
 				default:
@@ -1003,36 +1396,66 @@ void loop() {
 				case MODE_S2: // SEQ 2						
 					if (patternParams && !enc_edit){ 		// SEQUENCE PATTERN PARAMS MODE
 						//
-						if (ppmode == 4 && ppmode2 == 4 && ppmode3 == 4) {  // change page
-							pppage = constrain(pppage + amt, 0, 2);		// HARDCODED - FIX WITH SIZE OF PAGES?
+						if (ppmode == 4 && ppmode2 == 4 && ppmode3 == 4 && ppmode4 == 4 && ppmode5 == 4) {  // change page
+							pppage = constrain(pppage + amt, 0, 4);		// HARDCODED - FIX WITH SIZE OF PAGES?
 						}
 
 						if (ppmode == 0) { 					// SET PLAYING PATTERN
-							playingPattern = constrain(playingPattern + amt, 0, 7);
+							playingPattern = constrain(playingPattern + amt, 0, NUM_PATTERNS - 1);
 						}	
 						if (ppmode == 1) { 					// SET LENGTH
-							SetPatternLength( playingPattern, constrain(PatternLength(playingPattern) + amt, 1, 16) );
+							SetPatternLength( playingPattern, constrain(PatternLength(playingPattern) + amt, 1, NUM_STEPS) );
 						}	
 						if (ppmode == 2) { 					// SET PATTERN ROTATION	
 							int rotator;
 							(u.dir() < 0 ? rotator = -1 : rotator = 1);					
 //							int rotator = constrain(rotcc, (PatternLength(playingPattern))*-1, PatternLength(playingPattern));
 							rotationAmt = rotationAmt + rotator;
-							if (rotationAmt < 16 && rotationAmt > -16 ){
+							if (rotationAmt < NUM_STEPS && rotationAmt > -NUM_STEPS ){
 								rotatePattern(playingPattern, rotator);
 							}
 							rotationAmt = constrain(rotationAmt, (PatternLength(playingPattern)-1)*-1, PatternLength(playingPattern)-1);
 						}	
 						if (ppmode == 3) { 					// SET PATTERN CHANNEL	
 							patternSettings[playingPattern].channel = constrain(patternSettings[playingPattern].channel + amt, 0, 15);
+							updatePlanTiming(playingPattern);
 						}
 
 						if (ppmode3 == 0) { 					// SET CLOCK-DIV-MULT	
 							patternSettings[playingPattern].clockDivMultP = constrain(patternSettings[playingPattern].clockDivMultP + amt, 0, NUM_MULTDIVS-1); // set clock div/mult
+							updatePlanTiming(playingPattern);
+						}
+						if (ppmode3 == 2) { 					// SWITCH BANK (on the next bar)
+							selectBank( constrain(shownBank() + amt, 0, NUM_BANKS-1) );
 						}
 						if (ppmode3 == 1) { 					// SET MIDI SOLO	
 							patternSettings[playingPattern].solo = constrain(patternSettings[playingPattern].solo + amt, 0, 1); 
 						}
+						if (ppmode3 == 3) { 					// SET RANDOM SEED (all patterns)
+							patternSeed = constrain(patternSeed + amt, 0, 99);
+							seedPatternStreams();
+						}
+
+						// PATTERN PARAMS PAGE 4 - SONG MODE
+						if (ppmode4 == 0) { 					// SONG SLOT, 0 = OFF, one past the end adds a slot
+							int lastSlot = song.length() < Song::maxSlots ? song.length() + 1 : Song::maxSlots;
+							selectSongSlot( constrain(songSlot + amt, 0, lastSlot) );
+						}
+						if (ppmode4 > 0 && ppmode4 < 4 && songSlot > 0) {
+							Song::Slot& slot = song.slot(songSlot - 1);
+							if (ppmode4 == 1) { 				// SLOT BANK
+								slot.bank = constrain(slot.bank + amt, 0, NUM_BANKS-1);
+							} else if (ppmode4 == 2) { 			// SLOT PATTERN
+								slot.pattern = constrain(slot.pattern + amt, 0, NUM_PATTERNS - 1);
+							} else { 							// SLOT BARS, 0 ends the song here
+								slot.bars = constrain(slot.bars + amt, 0, 64);
+							}
+						}
+
+						// PATTERN PARAMS PAGE 5 - ECHO
+						if (ppmode5 < 4) {
+							changeEcho(playingPattern, ppmode5, amt);
+						}
 						
 						// PATTERN PARAMS PAGE 2
 							//TODO: convert to case statement ??
@@ -1086,6 +1509,7 @@ void loop() {
 							int tempCondition = stepNoteP[playingPattern][selectedStep].condition;
 							stepNoteP[playingPattern][selectedStep].condition = constrain(tempCondition + amt, 0, 35); // 0-32
 						}
+						updatePlanStep(playingPattern, selectedStep);
 
 					} else if (noteSelect && noteSelection && !enc_edit){	// NOTE SELECT MODE
 						// {notenum,vel,len,p1,p2,p3,p4,p5}
@@ -1097,8 +1521,8 @@ void loop() {
 								stepNoteP[playingPattern][selectedStep].params[nsmode] = -1;		
 							}
 						}
-						if (nsmode == 4 && nsmode2 == 4 && nsmode3 == 4) { 	// CHANGE PAGE
-							nspage = constrain(nspage + amt, 0, 2);		// HARDCODED - FIX WITH SIZE OF PAGES?
+						if (nsmode == 4 && nsmode2 == 4 && nsmode3 == 4 && nsmode4 == 4 && nsmode5 == 4) { 	// CHANGE PAGE
+							nspage = constrain(nspage + amt, 0, 4);		// HARDCODED - FIX WITH SIZE OF PAGES?
 //							Serial.print("nspage ");
 //							Serial.println(nspage);
 						}	
@@ -1133,14 +1557,34 @@ void loop() {
 							int tempCondition = stepNoteP[playingPattern][selectedStep].condition;
 							stepNoteP[playingPattern][selectedStep].condition = constrain(tempCondition + amt, 0, 35); // 0-32
 						}	
+						if (nsmode3 == 3) { 				// SET STEP NUDGE, IN TICKS
+							int tempNudge = stepNoteP[playingPattern][selectedStep].nudge;
+							stepNoteP[playingPattern][selectedStep].nudge = constrain(tempNudge + amt, -Grooves::maxNudge, Grooves::maxNudge);
+						}	
+						if (nsmode4 >= 0 && nsmode4 < 3) { 	// SET SUPERSTEP WAVE / RATE / DEST
+							changeSuperStep(nsmode4, amt);
+						}
+						if (nsmode5 == 0) { 				// SET RATCHET HITS, 1 = OFF
+							int tempRatchet = stepNoteP[playingPattern][selectedStep].ratchet;
+							stepNoteP[playingPattern][selectedStep].ratchet = constrain(tempRatchet + amt, 0, Ratchets::maxHits - 1);
+						}
+						if (nsmode5 == 1) { 				// SET RATCHET VELOCITY CURVE
+							int tempCurve = stepNoteP[playingPattern][selectedStep].ratchetVel;
+							stepNoteP[playingPattern][selectedStep].ratchetVel = constrain(tempCurve + amt, 0, RATCHET_VELOCITIES - 1);
+						}
+						if (nsmode5 == 2) { 				// SET RATCHET SPACING
+							int tempSpace = stepNoteP[playingPattern][selectedStep].ratchetSpace;
+							stepNoteP[playingPattern][selectedStep].ratchetSpace = constrain(tempSpace + amt, 0, RATCHET_SPACINGS - 1);
+						}
+						updatePlanStep(playingPattern, selectedStep);
 
 
 					} else {
 						newtempo = constrain(clockbpm + amt, 40, 300);
 						if (newtempo != clockbpm){
 							// SET TEMPO HERE
-							clockbpm = newtempo;
-							resetClocks();
+							tempoRamp.stop();
+							setTempo(newtempo);
 						}
 					}
 					dirtyDisplay = true;
@@ -1159,14 +1603,28 @@ void loop() {
 	// ############### ENCODER BUTTON ###############
 	//
 	auto s = encButton.update();
+	if (s != Button::NoChange) {
+		INPUT_EVENT(INPUT_BUTTON, s, 0, 0);
+	}
 	switch (s) {
 		// SHORT PRESS
 		case Button::Down: //Serial.println("Button down"); 
+#if PROFILE_LOOP
+			if (profilerPage) {
+				profilerPage = false;
+				dirtyDisplay = true;
+				break;
+			}
+#endif
 
 			// what page are we on?
 			if (newmode != omxMode && enc_edit) {
 				omxMode = newmode;
 				seqStop();
+				arp.releaseAll();
+				mipage = 0;
+				arpmode = 4;
+				echomode = 4;
 				setAllLEDS(0,0,0);
 				enc_edit = false;
 				dispMode();
@@ -1176,7 +1634,13 @@ void loop() {
 
 			if(omxMode == MODE_MIDI) {
 				// switch midi oct/chan selection
-				mimode = (mimode + 1 ) % 5;
+				if (mipage == 0) {
+					mimode = (mimode + 1 ) % 5;
+				} else if (mipage == 1) {
+					arpmode = (arpmode + 1 ) % 5;
+				} else {
+					echomode = (echomode + 1 ) % 5;
+				}
 //				mimode = !mimode;
 			}
 			if(omxMode == MODE_OM) {
@@ -1191,6 +1655,10 @@ void loop() {
 						nsmode3 = (nsmode3 + 1 ) % 5;
 					}else if (nspage == 2){
 						nsmode = (nsmode + 1 ) % 5;
+					}else if (nspage == 3){
+						nsmode4 = (nsmode4 + 1 ) % 5;
+					}else if (nspage == 4){
+						nsmode5 = (nsmode5 + 1 ) % 5;
 					}
 				} else if (patternParams) {
 
@@ -1201,6 +1669,10 @@ void loop() {
 						ppmode2 = (ppmode2 + 1 ) % 5;
 					}else if (pppage == 2){
 						ppmode3 = (ppmode3 + 1) % 5;
+					}else if (pppage == 3){
+						ppmode4 = (ppmode4 + 1) % 5;
+					}else if (pppage == 4){
+						ppmode5 = (ppmode5 + 1) % 5;
 					}
 				} else if (stepRecord) {
 					if (srpage == 0){
@@ -1214,6 +1686,10 @@ void loop() {
 						sqmode = (sqmode + 1 ) % 5;
 					} else if (sqpage == 1){
 						sqmode2 = (sqmode2 + 1 ) % 5;
+					} else if (sqpage == 2){
+						sqmode3 = (sqmode3 + 1 ) % 5;
+					} else if (sqpage == 3){
+						sqmode4 = (sqmode4 + 1 ) % 5;
 					}			
 				}
 			}
@@ -1225,6 +1701,12 @@ void loop() {
 			if (stepRecord) {
 				resetPatternDefaults(playingPattern);
 				clearedFlag = true;
+#if PROFILE_LOOP
+			} else if (enc_edit) {
+				// hidden loop profiler page
+				enc_edit = false;
+				profilerPage = true;
+#endif
 			} else {
 				enc_edit = true;		
 				newmode = omxMode;
@@ -1244,17 +1726,21 @@ void loop() {
 			break;		
 	}
 	// END ENCODER BUTTON
+	PROFILE_END(PROF_ENCODER);
 				
 
 	// ############### KEY HANDLING ###############
 	
+	PROFILE_BEGIN(PROF_KEYS);
 	while(customKeypad.available()){
 		keypadEvent e = customKeypad.read();
+		INPUT_EVENT(INPUT_KEY, e.bit.KEY, e.bit.EVENT, 0);
 		int thisKey = e.bit.KEY;
-		int keyPos = thisKey - 11;
+		int keyPos = stepPage * NUM_STEP_KEYS + thisKey - 11;	// the step under a step key
 
 		if (e.bit.EVENT == KEY_JUST_PRESSED){
 			keyState[thisKey] = true;
+			endBootAnimation();
 		}
 
 		if (e.bit.EVENT == KEY_JUST_PRESSED && thisKey == 0 && enc_edit) {
@@ -1272,11 +1758,19 @@ void loop() {
 				// ### KEY PRESS EVENTS
 				if (e.bit.EVENT == KEY_JUST_PRESSED && thisKey != 0) {
 					//Serial.println(" pressed");
-					midiNoteOn(thisKey, defaultVelocity, midiChannel);
+					if (arpOn) {
+						arpKeyOn(thisKey);
+					} else {
+						midiNoteOn(thisKey, defaultVelocity, midiChannel);
+					}
 
 				} else if(e.bit.EVENT == KEY_JUST_RELEASED && thisKey != 0) {
 					//Serial.println(" released");
-					midiNoteOff(thisKey, midiChannel);
+					if (arpOn) {
+						arpKeyOff(thisKey);
+					} else {
+						midiNoteOff(thisKey, midiChannel);
+					}
 				}
 				
 				// AUX KEY
@@ -1321,6 +1815,7 @@ void loop() {
 							selectedNote = thisKey;
 							int adjnote = notes[thisKey] + (octave * 12);
 							stepNoteP[playingPattern][selectedStep].note = adjnote;
+							updatePlanStep(playingPattern, selectedStep);
 							if (!playing){
 								seqNoteOn(thisKey, defaultVelocity, playingPattern);
 							}
@@ -1332,7 +1827,7 @@ void loop() {
 						} else if (thisKey == 2) { 
 
 						} else if (thisKey > 2 && thisKey < 11) { // Pattern select keys
-							playingPattern = thisKey-3;
+							playingPattern = patternForKey(thisKey);
 							dirtyDisplay = true;
 
 						} else if ( thisKey > 10 ) {
@@ -1352,7 +1847,7 @@ void loop() {
 
 						} else if (thisKey > 2 && thisKey < 11) { // Pattern select keys
 							
-							playingPattern = thisKey-3;
+							playingPattern = patternForKey(thisKey);
 
 							// COPY / PASTE / CLEAR
 							if (keyState[1] && !keyState[2]) { 	
@@ -1373,7 +1868,7 @@ void loop() {
 							dirtyDisplay = true;
 						} else if ( thisKey > 10 ) {
 							// set pattern length with key
-							SetPatternLength( playingPattern, thisKey - 10);
+							SetPatternLength( playingPattern, stepPage * NUM_STEP_KEYS + thisKey - 10);
 							dirtyDisplay = true;
 						}
 					
@@ -1384,6 +1879,7 @@ void loop() {
 											
 						int adjnote = notes[thisKey] + (octave * 12);
 						stepNoteP[playingPattern][selectedStep].note = adjnote;
+						updatePlanStep(playingPattern, selectedStep);
 
 						if (!playing){
 							seqNoteOn(thisKey, defaultVelocity, playingPattern);
@@ -1413,21 +1909,28 @@ void loop() {
 							if (keyState[1] && !playing) { 		
 //								Serial.print("step record on - pattern: ");
 //								Serial.println(thisKey-3);
-								playingPattern = thisKey-3;
+								playingPattern = patternForKey(thisKey);
 								seqPos[playingPattern] = 0;
 								stepRecord = true;
 								dirtyDisplay = true;
 
 							// If KEY 2 is down + pattern = PATTERN MUTE
 							} else if (keyState[2]) { 		
-								patternSettings[thisKey-3].mute = !patternSettings[thisKey-3].mute;
+								int mutePattern = patternForKey(thisKey);
+								patternSettings[mutePattern].mute = !patternSettings[mutePattern].mute;
 								
 							} else {
-								playingPattern = thisKey-3;
+								playingPattern = patternForKey(thisKey);
 								dirtyDisplay = true;
 							}
 						
 						// SEQUENCE 1-16 STEP KEYS
+						} else if (thisKey > 10 && NUM_STEP_PAGES > 1 && keyState[2]) {
+							// F2 + step key = show that page of a long pattern
+							if (thisKey - 11 < NUM_STEP_PAGES) {
+								stepPage = thisKey - 11;
+								dirtyDisplay = true;
+							}
 						} else if (thisKey > 10) { 
 							// TOGGLE STEP ON/OFF
 //							if ( stepNoteP[playingPattern][keyPos].stepType == STEPTYPE_PLAY || stepNoteP[playingPattern][keyPos].stepType == STEPTYPE_MUTE ) {
@@ -1435,6 +1938,7 @@ void loop() {
 //							}
 							if ( stepNoteP[playingPattern][keyPos].trig == TRIGTYPE_PLAY || stepNoteP[playingPattern][keyPos].trig == TRIGTYPE_MUTE ) {
 								stepNoteP[playingPattern][keyPos].trig = ( stepNoteP[playingPattern][keyPos].trig == TRIGTYPE_PLAY ) ? TRIGTYPE_MUTE : TRIGTYPE_PLAY;
+								updatePlanStep(playingPattern, keyPos);
 							}
 						}
 					}
@@ -1484,7 +1988,16 @@ void loop() {
 
 					} else {
 						if (keyState[1] || keyState[2]) { 				// CHECK keyState[] FOR LONG PRESS OF FUNC KEYS
-							if (keyState[1]) {	
+							if (keyState[1] && keyState[2]) {			// CC AUTOMATION RECORD ON / OFF
+								ccRecord = !ccRecord;
+								if (ccRecord) {
+									infoDialog[CCREC_ON].state = true;
+								} else {
+									ccLanes.endTake();
+									infoDialog[CCREC_OFF].state = true;
+								}
+
+							} else if (keyState[1]) {	
 								seqResetFlag = true;					// RESET ALL SEQUENCES TO FIRST/LAST STEP 
 								infoDialog[RESET].state = true; // reset flag
 
@@ -1554,7 +2067,7 @@ void loop() {
 						
 								} else if (j > 10){
 									if (!stepRecord && !patternParams){ 		// IGNORE LONG PRESSES IN STEP RECORD and Pattern Params
-										selectedStep = j - 11; // set noteSelection to this step
+										selectedStep = stepPage * NUM_STEP_KEYS + j - 11; // set noteSelection to this step
 										noteSelect = true;
 										stepSelect = true;
 										noteSelection = true;
@@ -1565,6 +2078,7 @@ void loop() {
 //										}
 										if ( stepNoteP[playingPattern][selectedStep].trig == TRIGTYPE_PLAY || stepNoteP[playingPattern][selectedStep].trig == TRIGTYPE_MUTE ) {
 											stepNoteP[playingPattern][selectedStep].trig = ( stepNoteP[playingPattern][selectedStep].trig == TRIGTYPE_PLAY ) ? TRIGTYPE_MUTE : TRIGTYPE_PLAY;
+											updatePlanStep(playingPattern, selectedStep);
 										}
 									}
 								}
@@ -1579,11 +2093,13 @@ void loop() {
 			}
 		}
 	}
+	PROFILE_END(PROF_KEYS);
 	
 
 
 	// ############### MODES DISPLAY  ##############
 
+	PROFILE_BEGIN(PROF_MODES);
 	switch(omxMode){
 		case MODE_OM: 						// ############## ORGANELLE MODE
 			// FALL THROUGH
@@ -1592,9 +2108,15 @@ void loop() {
 			//playingPattern = 0; 		// DEFAULT MIDI MODE TO THE FIRST PATTERN SLOT
 			midi_leds();				// SHOW LEDS
 
-			if (dirtyDisplay){			// DISPLAY
+			if (dirtyDisplay && !booting){			// DISPLAY
 				if (!enc_edit){
-					dispGenericMode(SUBMODE_MIDI, mimode);
+					if (mipage == 0) {
+						dispGenericMode(SUBMODE_MIDI, mimode);
+					} else if (mipage == 1) {
+						dispGenericMode(SUBMODE_ARP, arpmode);
+					} else {
+						dispGenericMode(SUBMODE_ECHO, echomode);
+					}
 				}
 			}
 			break;
@@ -1612,13 +2134,17 @@ void loop() {
 				midi_leds();
 			}
 
-			if (dirtyDisplay){			// DISPLAY
+			if (dirtyDisplay && !booting){			// DISPLAY
 				if (!enc_edit){
 					if (!noteSelect and !patternParams and !stepRecord){
 						if (sqpage == 0){
 							dispGenericMode(SUBMODE_SEQ, sqmode);
 						} else if (sqpage == 1){
 							dispGenericMode(SUBMODE_SEQ2, sqmode2);
+						} else if (sqpage == 2){
+							dispGenericMode(SUBMODE_SEQ3, sqmode3);
+						} else if (sqpage == 3){
+							dispGenericMode(SUBMODE_SEQ4, sqmode4);
 						}
 						dispInfoDialog();
 					}				
@@ -1629,6 +2155,10 @@ void loop() {
 							dispGenericMode(SUBMODE_NOTESEL3, nsmode3);
 						} else if (nspage == 2){
 							dispGenericMode(SUBMODE_NOTESEL, nsmode);
+						} else if (nspage == 3){
+							dispGenericMode(SUBMODE_NOTESEL4, nsmode4);
+						} else if (nspage == 4){
+							dispGenericMode(SUBMODE_NOTESEL5, nsmode5);
 						}
 					}
 					if (patternParams) {
@@ -1641,6 +2171,10 @@ void loop() {
 						} else if (pppage == 2){
 							dispGenericMode(SUBMODE_PATTPARAMS3, ppmode3);
 							// dispPatternParams3();
+						} else if (pppage == 3){
+							dispGenericMode(SUBMODE_PATTPARAMS4, ppmode4);
+						} else if (pppage == 4){
+							dispGenericMode(SUBMODE_ECHO, ppmode5);
 						}
 						dispInfoDialog();
 
@@ -1665,38 +2199,90 @@ void loop() {
 	}
 
 
+	PROFILE_END(PROF_MODES);
+
 	// DISPLAY at end of loop
 
-	if (dirtyDisplay){
+#if PROFILE_LOOP
+	updateProfiler();
+#endif
+
+	PROFILE_BEGIN(PROF_DISPLAY);
+	if (dirtyDisplay && !booting){
 		if (dirtyDisplayTimer > displayRefreshRate) {
+#if PROFILE_LOOP
+			if (profilerPage) {
+				dispProfilerPage();
+			}
+#endif
 			display.display();
 			dirtyDisplay = false;
 			dirtyDisplayTimer = 0;
 		}
 	}
+	PROFILE_END(PROF_DISPLAY);
 	
 	
 	// are pixels dirty
-	if (dirtyPixels){
+	PROFILE_BEGIN(PROF_LEDS);
+	if (dirtyPixels && !booting){
 		strip.show();	
 		dirtyPixels = false;
 	}
+	PROFILE_END(PROF_LEDS);
+
+	PROFILE_BEGIN(PROF_STORAGE);
+#if PATTERNS_IN_EEPROM
+	// fold the pattern journal back into EEPROM a bit at a time
+	patternJournal.update();
+#endif
+
+	// read the next bank a pattern at a time, it's swapped in on a bar while playing
+	patternBanks.update();
+	if (patternBanks.ready() && !playing) {
+		swapBank();
+	}
+	PROFILE_END(PROF_STORAGE);
 
+	PROFILE_BEGIN(PROF_MIDI);
 	while (MM::usbMidiRead()) {
-		// ignore incoming messages
+		// ignore incoming messages, SysEx goes to onSysEx()
+	}
+	if (patternSysEx.loadReady() && !playing) {
+		applySysExLoad();
+	}
+	if (patternSysEx.dumpRequested()) {
+		sendSysExDump();
 	}
 	while (MM::midiRead()) {
 		// ignore incoming messages
 	}
+	chaseMtc();
+	PROFILE_END(PROF_MIDI);
+
+#if PROFILE_LOOP || TRACE_TIMING || INPUT_RECORD
+	serialCommands();
+#endif
+#if TRACE_TIMING
+	traceRing.stream();
+#endif
+#if INPUT_RECORD
+	inputLog.stream();
+#endif
 	
 } // ######## END MAIN LOOP ########
 
 
 // ####### SEQENCER FUNCTIONS
 
+// pattern under a pattern key, from the group of 8 the playing pattern is in
+int patternForKey(int thisKey) {
+	return (playingPattern / NUM_PATTERN_KEYS) * NUM_PATTERN_KEYS + thisKey - 3;
+}
+
 void step_ahead(int patternNum) {
 	// step each pattern ahead one place
-	for (int j=0; j<8; j++){
+	for (int j=0; j<NUM_PATTERNS; j++){
 		if (patternSettings[j].reverse) {
 			seqPos[j]--;
 			auto_reset(j); // determine whether to reset or not based on param settings
@@ -1712,7 +2298,7 @@ void step_ahead(int patternNum) {
 }
 void step_back(int patternNum) {
 	// step each pattern ahead one place
-	for (int j=0; j<8; j++){
+	for (int j=0; j<NUM_PATTERNS; j++){
 		if (patternSettings[j].reverse) {
 			seqPos[j]++;
 			auto_reset(j); // determine whether to reset or not based on param settings
@@ -1739,17 +2325,17 @@ void new_step_ahead(int patternNum) {
 void auto_reset(int p){
 	// should be conditioned on whether we're in S2!!
 	if ( seqPos[p] >= PatternLength(p) || 
-	   (patternSettings[p].autoreset && (patternSettings[p].autoresetstep > (patternSettings[p].startstep) ) && (seqPos[p] >= patternSettings[p].autoresetstep)) ||
-	   (patternSettings[p].autoreset && (patternSettings[p].autoresetstep == 0 ) && (seqPos[p] >= patternSettings[p].rndstep)) ||
+	   (autoresetP[p] && (patternSettings[p].autoresetstep > (patternSettings[p].startstep) ) && (seqPos[p] >= patternSettings[p].autoresetstep)) ||
+	   (autoresetP[p] && (patternSettings[p].autoresetstep == 0 ) && (seqPos[p] >= rndstepP[p])) ||
 	   (patternSettings[p].reverse && (seqPos[p] < 0)) || // normal reverse reset
-	   (patternSettings[p].reverse && patternSettings[p].autoreset && (seqPos[p] < patternSettings[p].startstep )) // ||
-	   //(patternSettings[p].reverse && patternSettings[p].autoreset && (patternSettings[p].autoresetstep == 0 ) && (seqPos[p] < patternSettings[p].rndstep)) 
+	   (patternSettings[p].reverse && autoresetP[p] && (seqPos[p] < patternSettings[p].startstep )) // ||
+	   //(patternSettings[p].reverse && autoresetP[p] && (patternSettings[p].autoresetstep == 0 ) && (seqPos[p] < rndstepP[p])) 
 	   ) {
 
 		if (patternSettings[p].reverse) {
-			if (patternSettings[p].autoreset){
+			if (autoresetP[p]){
 				if (patternSettings[p].autoresetstep == 0){
-					seqPos[p] = patternSettings[p].rndstep-1;
+					seqPos[p] = rndstepP[p]-1;
 				}else{
 					seqPos[p] = patternSettings[p].autoresetstep-1; // resets pattern in REV
 				}	
@@ -1760,44 +2346,50 @@ void auto_reset(int p){
 		} else {
 			seqPos[p] = (patternSettings[p].startstep); // resets pattern in FWD
 		}
-		if (patternSettings[p].autoresetfreq == patternSettings[p].current_cycle){ // reset cycle logic
-			if (probResult(patternSettings[p].autoresetprob)){ 
+		if (patternSettings[p].autoresetfreq == currentCycleP[p]){ // reset cycle logic
+			if (probResult(p, patternSettings[p].autoresetprob)){ 
 				// chance of doing autoreset
-				patternSettings[p].autoreset = true;
+				autoresetP[p] = true;
 			} else {
-				patternSettings[p].autoreset = false;
+				autoresetP[p] = false;
 			}
-			patternSettings[p].current_cycle = 1; // reset cycle to start new iteration
+			currentCycleP[p] = 1; // reset cycle to start new iteration
 		} else {
-			patternSettings[p].autoreset = false;
-			patternSettings[p].current_cycle++; // advance to next cycle
+			autoresetP[p] = false;
+			currentCycleP[p] = (currentCycleP[p] + 1) & 0x0F; // advance to next cycle, wraps like autoresetfreq
 		}
-		patternSettings[p].rndstep = (rand() % PatternLength(p)) + 1; // randomly choose step for next cycle
+		rndstepP[p] = patternRng[p].range(PatternLength(p)) + 1; // randomly choose step for next cycle
 	}
 // return ()
 }
 
-bool probResult(int probSetting){
-//	int tempProb = (rand() % probSetting);
-//	Serial.println(tempProb);
- 	if (probSetting == 0){
- 		return false;
- 	}
-	if((rand() % 100) < probSetting){ // assumes probSetting is a range 0-100
- 		return true;
- 	} else {
- 		return false;
- 	}
- }
-
-bool evaluate_AB(int condition, int patternNum) {
+// back to the first autoreset cycle
+void resetAutoreset(int p){
+	currentCycleP[p] = 1;
+	rndstepP[p] = 3;
+	autoresetP[p] = false;
+}
+
+bool probResult(int patternNum, int probSetting){
+	return patternRng[patternNum].chance(probSetting); // assumes probSetting is a range 0-100
+}
+
+// restart every pattern's random stream, from the stored seed if there is one
+void seedPatternStreams(){
+	uint32_t seed = patternSeed ? patternSeed : bootSeed;
+	for (int p=0; p<NUM_PATTERNS; p++){
+		patternRng[p].seed(seed, p);
+		superSteps.seed(p, seed);
+	}
+	arp.seed(seed);
+}
+
+// a b from trigConditionsAB, see PlanStep
+bool evaluate_AB(int a, int b, int patternNum) {
 	bool shouldTrigger = false;;
 
 	loopCount[patternNum][seqPos[patternNum]]++;		
 
-	int a = trigConditionsAB[condition][0];
-	int b = trigConditionsAB[condition][1];
-
 //Serial.print (patternNum);
 //Serial.print ("/");
 //Serial.print (seqPos[patternNum]);
@@ -1851,7 +2443,42 @@ void changeStepType(int amount){
 			break;
 	}								
 	//							Serial.println(stepNoteP[playingPattern][selectedStep].stepType);
+	updatePlanStep(playingPattern, selectedStep);
+}
+
+// the selected step's superstep LFO - field 0 wave (off below the first), 1 rate, 2 destination
+void changeSuperStep(int field, int amount){
+	int8_t& lfo = stepNoteP[playingPattern][selectedStep].params[4];
+	int wave = lfo < 0 ? -1 : SuperSteps::wave(lfo);
+	int rate = lfo < 0 ? 2 : SuperSteps::rate(lfo);		// a cycle a step to start with
+	int dest = lfo < 0 ? 0 : SuperSteps::dest(lfo);
+	if (field == 0) {
+		wave = constrain(wave + amount, -1, LFO_WAVES - 1);
+	} else if (wave < 0) {
+		return;
+	} else if (field == 1) {
+		rate = constrain(rate + amount, 0, SuperSteps::rates - 1);
+	} else {
+		dest = constrain(dest + amount, 0, 3);
+	}
+	lfo = wave < 0 ? -1 : SuperSteps::encode(wave, rate, dest);
+	updatePlanStep(playingPattern, selectedStep);
+}
+
+// the echo page, the same for a pattern and for MIDI mode
+void changeEcho(int source, int field, int amount){
+	Echo::Settings& e = echo.settings[source];
+	if (field == 0) {
+		e.repeats = constrain(e.repeats + amount, 0, Echo::maxRepeats);
+	} else if (field == 1) {
+		e.feedback = constrain(e.feedback + amount, 0, 100);
+	} else if (field == 2) {
+		e.time = constrain(e.time + amount, 0, NUM_MULTDIVS-1);
+	} else {
+		e.shift = constrain(e.shift + amount, -12, 12);
+	}
 }
+
 void step_on(int patternNum){
 //		Serial.print(patternNum);
 //		Serial.println(" step on");
@@ -1868,17 +2495,32 @@ void step_off(int patternNum, int position){
 }
 
 void doStep() {
-// // probability test
-	bool testProb = probResult(stepNoteP[playingPattern][seqPos[playingPattern]].prob);
-	
-	
+	PROFILE_SCOPE(PROF_DOSTEP);
+
+	// one reading of the time for the bar and the steps, so a slot change is
+	// always in place before the steps on its bar
+	Micros now = micros();
+
+	if (barStart) {
+		barStart = false;
+		if (patternBanks.ready() && !song.playing()) {
+			swapBank();		// song mode changes banks itself, in songBar()
+		}
+	}
+	if (playing && song.playing() && now >= nextBarTime) {
+		songBar(nextBarTime);
+	}
+	if (patternSysEx.loadReady()) {
+		applySysExLoad();	// between steps
+	}
+
 	switch(omxMode){
 		case MODE_S1:
 			if(playing) {
 				// ############## STEP TIMING ##############
 //				if(micros() >= nextStepTime){
-				if(micros() >= timePerPattern[playingPattern].nextStepTimeP){
-					seqReset();
+				if(now + stepLead(playingPattern) >= nextStepTimeP[playingPattern]){
+					seqReset(nextStepTimeP[playingPattern]);
 					// DO STUFF
 
 //					int lastPos = (seqPos[playingPattern]+15) % 16;
@@ -1888,17 +2530,22 @@ void doStep() {
 //					lastStepTime = nextStepTime;
 //					nextStepTime += step_micros;
 
-					timePerPattern[playingPattern].lastPosP = (seqPos[playingPattern]+15) % 16;
-					if (lastNote[playingPattern][timePerPattern[playingPattern].lastPosP] > 0){
-						step_off(playingPattern, timePerPattern[playingPattern].lastPosP);
+					int lastPos = (seqPos[playingPattern] + NUM_STEPS - 1) % NUM_STEPS;
+					if (lastNote[playingPattern][lastPos] > 0){
+						step_off(playingPattern, lastPos);
 					}
-					timePerPattern[playingPattern].lastStepTimeP = timePerPattern[playingPattern].nextStepTimeP;
-					timePerPattern[playingPattern].nextStepTimeP += (step_micros)*( multValues[patternSettings[playingPattern].clockDivMultP] ); // calc step based on rate
+					TRACE_EVENT(TRACE_STEP, nextStepTimeP[playingPattern], micros(), playingPattern, 0, 0);
+					lastStepTimeP[playingPattern] = nextStepTimeP[playingPattern];
+					playedStepP[playingPattern] = seqPos[playingPattern];
+					nextStepTimeP[playingPattern] += patternPlans[playingPattern].stepMicros; // calc step based on rate
 
-					if (testProb){ //  && evaluate_AB(stepNoteP[playingPattern][seqPos[playingPattern]].condition, playingPattern)
+					// probability test
+					if (probResult(playingPattern, patternPlanSteps[playingPattern][seqPos[playingPattern]].prob)){ //  && evaluate_AB(...)
 						playNote(playingPattern);
 	//					step_on(playingPattern);
 					}
+					playLanes(playingPattern);
+					superSteps.schedule(playingPattern, lastStepTimeP[playingPattern], nextStepTimeP[playingPattern]);
 
 
 					show_current_step(playingPattern); // show led for step
@@ -1911,28 +2558,40 @@ void doStep() {
 
 		case MODE_S2:
 			if(playing) {
-				unsigned long playstepmicros = micros();
-				
+				unsigned long playstepmicros = now;
+				if (playstepmicros < nextStepDue) {
+					break;		// no pattern is due yet
+				}
+				Micros earliest = (Micros)-1;
+
 				for (int j=0; j<NUM_PATTERNS; j++){ // check all patterns for notes to play in time
 
 					// CLOCK PER PATTERN BASED APPROACH
-				  	if(playstepmicros >= timePerPattern[j].nextStepTimeP){
+				  	if(playstepmicros + stepLead(j) >= nextStepTimeP[j]){
 
-						seqReset(); // check for seqReset
-						timePerPattern[j].lastStepTimeP = timePerPattern[j].nextStepTimeP;
-						timePerPattern[j].nextStepTimeP += (step_micros)*( multValues[patternSettings[j].clockDivMultP] ); // calc step based on rate
+						seqReset(nextStepTimeP[j]); // check for seqReset
+						TRACE_EVENT(TRACE_STEP, nextStepTimeP[j], micros(), j, 0, 0);
+						lastStepTimeP[j] = nextStepTimeP[j];
+						playedStepP[j] = seqPos[j];
+						nextStepTimeP[j] += patternPlans[j].stepMicros; // calc step based on rate
+
+						// probability test, taken even when muted so muting doesn't shift the pattern's random choices
+						const PlanStep& step = patternPlanSteps[j][seqPos[j]];
+						bool testProb = probResult(j, step.prob);
 
 						// only play if not muted
 						if (!patternSettings[j].mute) {
-							timePerPattern[j].lastPosP = (seqPos[j]+15) % 16;
-							if (lastNote[j][timePerPattern[j].lastPosP] > 0){
-								step_off(j, timePerPattern[j].lastPosP);
+							int lastPos = (seqPos[j] + NUM_STEPS - 1) % NUM_STEPS;
+							if (lastNote[j][lastPos] > 0){
+								step_off(j, lastPos);
 							}
 							if (testProb){
-								if (evaluate_AB(stepNoteP[j][seqPos[j]].condition, j)){							
+								if (evaluate_AB(trigConditionsAB[step.condition][0], trigConditionsAB[step.condition][1], j)){							
 									playNote(j);
 								}
 							}
+							playLanes(j);
+							superSteps.schedule(j, lastStepTimeP[j], nextStepTimeP[j]);
 						}
 //						show_current_step(playingPattern);
 						if(j == playingPattern){ // only show selected pattern
@@ -1940,7 +2599,11 @@ void doStep() {
                         }
 						new_step_ahead(j);
 					}
+					if (nextStepTimeP[j] - stepLead(j) < earliest) {
+						earliest = nextStepTimeP[j] - stepLead(j);
+					}
 				}
+				nextStepDue = earliest;
 
 				
 			} else {
@@ -1948,6 +2611,12 @@ void doStep() {
 			}
 			break;
 
+		case MODE_OM:
+			// fall through
+		case MODE_MIDI:
+			arpStep(now);
+			break;
+
 		default:
 			break;	
 	}
@@ -1978,6 +2647,13 @@ void midiNoteOn(int notenum, int velocity, int channel) {
 		MM::sendNoteOn(adjnote, velocity, channel);
 		// CV
 		cvNoteOn(adjnote);
+
+		// how long the key is held isn't known yet, its echoes are half the echo time.
+		// Not for a solo pattern's keys, the sequencer modes only play echoes while playing
+		if (omxMode == MODE_MIDI || omxMode == MODE_OM) {
+			Micros delay = echoMicros(Echo::midiSource);
+			echo.add(Echo::midiSource, adjnote, velocity, channel, micros(), delay / 2, delay);
+		}
 	}
 
 	strip.setPixelColor(notenum, MIDINOTEON);         //  Set pixel's color (in RAM)
@@ -1999,6 +2675,67 @@ void midiNoteOff(int notenum, int channel) {
 	dirtyDisplay = true;
 }
 
+// #### MIDI Mode arpeggiator (see arp.h)
+
+void arpKeyOn(int notenum) {
+	int adjnote = notes[notenum] + (octave * 12);
+	if (adjnote>=0 && adjnote <128){
+		midiLastNote = adjnote;
+		midiKeyState[notenum] = adjnote;
+		if (arp.held() == 0) {
+			arp.restart();
+			nextArpTime = micros();		// the first note now, the rest on the arp's grid from it
+		}
+		arp.press(adjnote);
+	}
+
+	strip.setPixelColor(notenum, MIDINOTEON);
+	dirtyPixels = true;	
+	dirtyDisplay = true;
+}
+
+void arpKeyOff(int notenum) {
+	int adjnote = midiKeyState[notenum];
+	if (adjnote>=0 && adjnote <128){
+		arp.release(adjnote);
+	}
+	midiKeyState[notenum] = -1;
+
+	strip.setPixelColor(notenum, LEDOFF); 
+	dirtyPixels = true;
+	dirtyDisplay = true;
+}
+
+// from doStep() in MIDI mode. Each note is queued a PPQ tick ahead of its time
+// on the arp's grid, so it goes out on time and a key change reaches the next
+// note unless that's less than a tick away.
+void arpStep(Micros now) {
+	if (!playing) {
+		// the clock isn't running to play the queues, see advanceSteps()
+		pendingNoteOffs.play(now);
+		pendingNoteOns.play(now);
+		echo.play(now);
+	}
+	if (!arpOn || arp.held() == 0) {
+		return;
+	}
+
+	Micros stepMicros = step_micros * multValues[arpRate];
+	if ((long)(now - nextArpTime) > (long)stepMicros) {
+		// held up, pick up the grid from here rather than catch up
+		nextArpTime += (now - nextArpTime) / stepMicros * stepMicros;
+	}
+	while ((long)(now + ppqInterval - nextArpTime) >= 0) {
+		int note = arp.next();
+		pendingNoteOns.insert(note, defaultVelocity, midiChannel, nextArpTime, true, TRACE_NO_PATTERN);
+		pendingNoteOffs.insert(note, midiChannel, nextArpTime + stepMicros * arpGate / 100, true, TRACE_NO_PATTERN);
+		echo.add(Echo::midiSource, note, defaultVelocity, midiChannel, nextArpTime, stepMicros * arpGate / 100,
+			echoMicros(Echo::midiSource));
+		midiLastNote = note;
+		nextArpTime += stepMicros;
+	}
+}
+
 // #### SEQ Mode note on/off
 void seqNoteOn(int notenum, int velocity, int patternNum){
 	int adjnote = notes[notenum] + (octave * 12); // adjust key for octave range
@@ -2040,16 +2777,18 @@ void seqNoteOff(int notenum, int patternNum){
 
 // Play a note / step (SEQUENCERS)
 void playNote(int patternNum) {
+	PROFILE_SCOPE(PROF_PLAYNOTE);
 //	Serial.println(stepNoteP[patternNum][seqPos[patternNum]].note); // Debug
 	bool sendnoteCV = false;
 	int rnd_swing;
 	if (cvPattern[patternNum]){
 		sendnoteCV = true;
 	}
-	StepType playStepType = stepNoteP[patternNum][seqPos[patternNum]].stepType;
+	const PatternPlan& plan = patternPlans[patternNum];
+	StepType playStepType = (StepType)patternPlanSteps[patternNum][seqPos[patternNum]].stepType;
 	
-	if (stepNoteP[patternNum][seqPos[patternNum]].stepType == STEPTYPE_RAND){
-		auto tempType = random(STEPTYPE_COUNT);
+	if (playStepType == STEPTYPE_RAND){
+		auto tempType = patternRng[patternNum].range(STEPTYPE_COUNT);
 	
 		// this is fucking hacky to increment the enum for stepType
 		switch(tempType){
@@ -2091,7 +2830,8 @@ void playNote(int patternNum) {
 			patternSettings[patternNum].reverse = !patternSettings[patternNum].reverse;		
 			break;      
 		case STEPTYPE_RANDSTEP:
-			seqPos[patternNum] = (rand() % PatternLength(patternNum)) + 1;
+			// 1 past the playing step, wrapped - seqPos == length would index past the pattern
+			seqPos[patternNum] = (patternRng[patternNum].range(PatternLength(patternNum)) + 1) % PatternLength(patternNum);
 			break;      
 		case STEPTYPE_RESTART:	
 			seqPos[patternNum] = 0;	
@@ -2099,49 +2839,67 @@ void playNote(int patternNum) {
 		break;
 	}
 
-	// regular note on trigger
+	// regular note on trigger - the step type may have moved seqPos
+	const PlanStep& step = patternPlanSteps[patternNum][seqPos[patternNum]];
 	
-	if (stepNoteP[patternNum][seqPos[patternNum]].trig == TRIGTYPE_PLAY){
+	if (step.flags & PLAN_PLAY){
 
-		seq_velocity = stepNoteP[patternNum][seqPos[patternNum]].vel;
+		seq_velocity = step.vel;
 
-		noteoff_micros = micros() + ( stepNoteP[patternNum][seqPos[patternNum]].len + 1 )* step_micros ;
-		pendingNoteOffs.insert(stepNoteP[patternNum][seqPos[patternNum]].note, PatternChannel(patternNum), noteoff_micros, sendnoteCV );
+		// from the step's own time rather than now, the step may have been taken early for it
+		noteon_micros = lastStepTimeP[patternNum] + planOffset(plan, step); // swing, groove and nudge
+		if ((step.flags & PLAN_SWING) && plan.swing == 99){ // random drunken swing
+			rnd_swing = patternRng[patternNum].range(95) + 1; // rand 1 - 95 // randomly apply swing value 
+			noteon_micros += (Micros)(plan.swingUnit * rnd_swing);
+		}
 
-		if (seqPos[patternNum] % 2 == 0){
+		if (!(step.flags & PLAN_RATCHET)){
+			noteoff_micros = noteon_micros + planLengthTicks(step) * ppqInterval;
+			pendingNoteOffs.insert(step.note, plan.channel, noteoff_micros, sendnoteCV, patternNum );
+		}
 
-			if (patternSettings[patternNum].swing < 99){
-				noteon_micros = micros() + ((ppqInterval * multValues[patternSettings[patternNum].clockDivMultP])/(PPQ / 24) * patternSettings[patternNum].swing); // full range swing					
-//				Serial.println((ppqInterval * multValues[patternSettings[patternNum].clockDivMultP])/(PPQ / 24) * patternSettings[patternNum].swing);					
-//			} else if ((patternSettings[patternNum].swing > 50) && (patternSettings[patternNum].swing < 99)){
-//			   noteon_micros = micros() + ((step_micros * multValues[patternSettings[patternNum].clockDivMultP]) * ((patternSettings[patternNum].swing - 50)* .01) ); // late swing
-//			   Serial.println(((step_micros * multValues[patternSettings[patternNum].clockDivMultP]) * ((patternSettings[patternNum].swing - 50)* .01) ));
-			} else if (patternSettings[patternNum].swing == 99){ // random drunken swing
-				rnd_swing = rand() % 95 + 1; // rand 1 - 95 // randomly apply swing value 
-				noteon_micros = micros() + ((ppqInterval * multValues[patternSettings[patternNum].clockDivMultP])/(PPQ / 24) * rnd_swing);
+		// Queue note-on, or all the step's hits
+		if (step.flags & PLAN_RATCHET){
+			Ratchets::Hit hits[Ratchets::maxHits];
+			int stepTicks = (plan.stepMicros + ppqInterval / 2) / ppqInterval;
+			int n = Ratchets::expand(step.ratchet + 1, step.ratchetVel, step.ratchetSpace, seq_velocity, stepTicks, hits);
+			for (int h = 0; h < n; h++){
+				Micros on = noteon_micros + hits[h].on * ppqInterval;
+				pendingNoteOns.insert(step.note, hits[h].velocity, plan.channel, on, sendnoteCV, patternNum );
+				pendingNoteOffs.insert(step.note, plan.channel, on + hits[h].length * ppqInterval, sendnoteCV, patternNum );
 			}
-
+			echo.add(patternNum, step.note, hits[0].velocity, plan.channel, noteon_micros,
+				hits[0].length * ppqInterval, echoMicros(patternNum));
 		} else {
-			noteon_micros = micros();
-		}		
-
-		// Queue note-on
-		pendingNoteOns.insert(stepNoteP[patternNum][seqPos[patternNum]].note, seq_velocity, PatternChannel(patternNum), noteon_micros, sendnoteCV );
+			pendingNoteOns.insert(step.note, seq_velocity, plan.channel, noteon_micros, sendnoteCV, patternNum );
+			echo.add(patternNum, step.note, seq_velocity, plan.channel, noteon_micros,
+				planLengthTicks(step) * ppqInterval, echoMicros(patternNum));
+		}
 
-		// {notenum, vel, notelen, step_type, {p1,p2,p3,p4}, prob}
 		// send param locks 
+		const int8_t* params = stepNoteP[patternNum][seqPos[patternNum]].params;
 		for (int q=0; q<4; q++){	
-			int tempCC = stepNoteP[patternNum][seqPos[patternNum]].params[q];
-			if (tempCC > -1) {
-				MM::sendControlChange(pots[q],tempCC,PatternChannel(patternNum));
-				prevPlock[q] = tempCC;
+			if (step.plocks & (1 << q)) {
+				MM::sendControlChange(pots[q],params[q],plan.channel);
+				prevPlock[q] = params[q];
 			} else if (prevPlock[q] != potValues[q]) {
-				//if (tempCC != prevPlock[q]) {
-				MM::sendControlChange(pots[q],potValues[q],PatternChannel(patternNum));
+				MM::sendControlChange(pots[q],potValues[q],plan.channel);
 				prevPlock[q] = potValues[q];
 			}
 		}
-		lastNote[patternNum][seqPos[patternNum]] = stepNoteP[patternNum][seqPos[patternNum]].note;
+
+		// superstep LFO for as long as the note plays, up to the p-lock on its pot
+		if (step.flags & PLAN_SUPERSTEP){
+			int8_t lfo = params[4];
+			int dest = SuperSteps::dest(lfo);
+			int depth = (step.plocks & (1 << dest)) ? params[dest] : 127;
+			superSteps.start(patternNum, lfo, depth, pots[dest], plan.channel, noteon_micros,
+				planLengthTicks(step) * ppqInterval, plan.stepMicros, lfoTicks[dest] * ppqInterval);
+			prevPlock[dest] = -1;		// the next note puts the pot's value back
+		} else {
+			superSteps.stop(patternNum);
+		}
+		lastNote[patternNum][seqPos[patternNum]] = step.note;
 
 		// CV is sent from pendingNoteOns/pendingNoteOffs
 
@@ -2150,6 +2908,12 @@ void playNote(int patternNum) {
 
 void allNotesOff() {
 	pendingNoteOffs.allOff();
+	echo.allOff();
+}
+
+// the echo time for a source, synced to the tempo rather than the pattern's rate
+Micros echoMicros(int source) {
+	return step_micros * multValues[echo.settings[source].time];
 }
 
 void allNotesOffPanic() {
@@ -2164,22 +2928,42 @@ void transposeSeq(int patternNum, int amt) {
 	for (int k=0; k<NUM_STEPS; k++){
 		stepNoteP[patternNum][k].note += amt;
 	}
+	updatePlan(patternNum);
+}
+
+// back to the first step, A:B conditions from the first cycle
+void restartPattern(int k){
+	for (int q=0; q<NUM_STEPS; q++){
+		loopCount[k][q] = 0;
+	}
+	if (patternSettings[k].reverse) { // REVERSE
+		seqPos[k] = PatternLength(k) - 1;
+	} else {
+		seqPos[k] = 0;
+	}
 }
 
-void seqReset(){
+// stepTime is when the step about to play is due, the first one after the reset
+void seqReset(Micros stepTime){
 	if (seqResetFlag) {
 		for (int k=0; k<NUM_PATTERNS; k++){
-			for (int q=0; q<NUM_STEPS; q++){
-				loopCount[k][q] = 0;
-			}
-			if (patternSettings[k].reverse) { // REVERSE
-				seqPos[k] = PatternLength(k) - 1;
-			} else {
-				seqPos[k] = 0;
+			restartPattern(k);
+		}
+		if (patternSeed) {
+			// same seed, same choices - restart the streams and the reset automation
+			seedPatternStreams();
+			for (int k=0; k<NUM_PATTERNS; k++){
+				resetAutoreset(k);
 			}
 		}
 		MM::stopClock();
 		MM::startClock();
+		if (mtcOut.running()) {
+			// playing, time code goes back to 00:00:00:00 on the step the patterns start again on
+			mtcOut.stop(stepTime);
+			mtcOut.locate(0);
+			mtcOut.start(stepTime);
+		}
 		seqResetFlag = false;
 	}
 }
@@ -2187,30 +2971,168 @@ void seqReset(){
 void seqStart() {
 	playing = 1;
 	
+	// Start or Continue ahead of the first clock, and any bank the song opens
+	// with loaded before it
+	if (seqResetFlag) {
+		seqReset(micros());		// time code isn't running yet, it starts below
+		mtcOut.locate(0);
+	} else {
+		MM::continueClock();
+	}
+	if (song.enabled()) {
+		songStart();
+	}
 
+	// first clock tick and first bar on the first step
+	pendingTempoCount = 0;
+	Micros now = clockOut.start(ppqInterval * (PPQ / 24));
+	ticks = 0;
+	nextBarTime = now;
+	if (mtcMode == MTC_MODE_OUT) {
+		mtcOut.start(now);		// time code from the same first tick
+	}
 	for (int x=0; x<NUM_PATTERNS; x++){
-		timePerPattern[x].nextStepTimeP = micros();
-		timePerPattern[x].lastStepTimeP = micros();
+		nextStepTimeP[x] = now;
+		lastStepTimeP[x] = now;
 	}
+	nextStepDue = now;
 
-	if (!seqResetFlag) {
-		MM::continueClock();
-//	} else if (seqPos[playingPattern]==0) {
-//		MM::startClock();
-	}
+	memset(ccLaneSent, -1, sizeof(ccLaneSent));		// lanes send their first value again
 }
 
 void seqStop() {
+	clockOut.stop();
+	mtcOut.stop(micros());
+	chasing = false;
+	if (pendingTempoCount > 0) {
+		pendingTempoCount = 0;
+		resetClocks();		// the last tempo asked for
+	}
 	ticks = 0;
 	playing = 0;
 	MM::stopClock();
 	allNotesOff();
+	pendingControlChanges.clear();
+	superSteps.clear();
+	ccLanes.endTake();
 }
 
 void seqContinue() {
 	playing = 1;
 }
 
+// #### SEEK
+// every pattern where it'd be ppqTicks into playing from the top, worked out
+// rather than stepped through so it takes as long at bar 500 as at bar 1. The
+// patterns go where playing straight through takes them - random steps and
+// autoreset aren't played out, and A:B counts take every step as played.
+// Tick ppqTicks is due at tickTime, the clock starts again on the same grid.
+void seekPatterns(uint32_t ppqTicks, Micros tickTime) {
+	for (int p = 0; p < NUM_PATTERNS; p++){
+		// S1 steps every pattern at the playing pattern's rate
+		Micros stepMicros = patternPlans[omxMode == MODE_S1 ? playingPattern : p].stepMicros;
+		uint32_t stepTicks = stepMicros / ppqInterval;
+		uint32_t steps = (ppqTicks + stepTicks - 1) / stepTicks;		// played already, the next is on or after the tick
+		seekPattern(p, steps);
+		nextStepTimeP[p] = tickTime + (steps * stepTicks - ppqTicks) * ppqInterval;
+		lastStepTimeP[p] = nextStepTimeP[p] - stepMicros;
+	}
+	nextStepDue = 0;
+	memset(ccLaneSent, -1, sizeof(ccLaneSent));
+
+	// the first clock on or after the tick
+	uint32_t clock = (ppqTicks + PPQ / 24 - 1) / (PPQ / 24);
+	Micros period = ppqInterval * (PPQ / 24);
+	Micros first = tickTime + (clock * (PPQ / 24) - ppqTicks) * ppqInterval;
+	Micros now = micros();
+	pendingTempoCount = 0;
+	clockOut.start(period, (int32_t)(first - now) > 0 ? first - now : 0);
+	ticks = clock;
+	nextBarTime = first + ((24 * 4 - clock % (24 * 4)) % (24 * 4)) * period;
+}
+
+// pattern p once it's played steps steps from the top, see seekPatterns()
+void seekPattern(int p, uint32_t steps){
+	int len = PatternLength(p);
+	int first = patternSettings[p].startstep < len ? patternSettings[p].startstep : 0;
+	bool reverse = patternSettings[p].reverse;
+	uint32_t loop = len - first;		// it goes round these after the first time through
+	uint32_t later = steps > (uint32_t)len ? steps - len : 0;
+	uint32_t rounds = later / loop;
+	uint32_t into = later % loop;
+
+	for (int q = 0; q < len; q++){
+		// times step q has played - once the first time through, then once a round
+		int fromTop = reverse ? len - 1 - q : q;
+		int inLoop = reverse ? (int)loop - 1 - q : q - first;		// < 0 = not in the rounds
+		uint32_t plays = (uint32_t)fromTop < steps ? 1 : 0;
+		if (inLoop >= 0 && steps > (uint32_t)len) {
+			plays += rounds + ((uint32_t)inLoop < into ? 1 : 0);
+		}
+		uint8_t b = trigConditionsAB[patternPlanSteps[p][q].condition][1];
+		loopCount[p][q] = b > 0 ? plays % b : 0;
+	}
+	if (steps < (uint32_t)len) {
+		seqPos[p] = reverse ? len - 1 - steps : steps;
+	} else {
+		seqPos[p] = reverse ? loop - 1 - into : first + into;
+	}
+	resetAutoreset(p);
+}
+
+// #### MTC CHASE
+// follows incoming time code at the unit's own tempo - plays when it starts,
+// stops when it stops, and puts the patterns in place again when it jumps or
+// drifts more than a frame away
+void chaseMtc(){
+	if (mtcMode != MTC_MODE_CHASE) {
+		return;
+	}
+	Micros now = micros();
+	if (!mtcIn.running(now)) {
+		if (chasing) {
+			seqStop();
+			dirtyDisplay = true;
+		}
+		return;
+	}
+	uint64_t position = mtcIn.position(now);
+	if (chasing) {
+		int64_t drift = (int64_t)(position - (chasePosition + (uint32_t)(now - chaseAt)));
+		int64_t frame = Mtc::frameMicros(mtcIn.rate);
+		if (drift <= frame && drift >= -frame) {
+			return;
+		}
+	}
+	chaseTo(position, now);
+}
+
+void chaseTo(uint64_t position, Micros now){
+	if (playing) {
+		allNotesOff();
+		pendingControlChanges.clear();
+		superSteps.clear();
+	} else {
+		playing = 1;
+		seqResetFlag = false;		// the seek's put them in place, not back to the top
+		MM::continueClock();
+	}
+
+	// from the time code's next PPQ tick
+	uint32_t ppqTicks = position / ppqInterval;
+	Micros into = position % ppqInterval;
+	Micros tickTime = now;
+	if (into) {
+		ppqTicks++;
+		tickTime += ppqInterval - into;
+	}
+	seekPatterns(ppqTicks, tickTime);
+	chasing = true;
+	chasePosition = position;
+	chaseAt = now;
+	dirtyDisplay = true;
+}
+
 void rotatePattern(int patternNum, int rot) {
 	if ( patternNum < 0 || patternNum >= NUM_PATTERNS )
 		return;
@@ -2221,20 +3143,22 @@ void rotatePattern(int patternNum, int rot) {
 		arr[d] = stepNoteP[patternNum][s];
 	for (int i = 0; i < size; ++i)
 		stepNoteP[patternNum][i] = arr[i];
+	updatePlan(patternNum);
 }
 
 void resetPatternDefaults(int patternNum){
 	for (int i = 0; i < NUM_STEPS; i++){
 		// {notenum,vel,len,stepType,{p1,p2,p3,p4,p5}}
-		stepNoteP[patternNum][i].note = patternDefaultNoteMap[patternNum];
+		stepNoteP[patternNum][i].note = patternDefaultNoteMap[patternNum % NUM_PATTERN_KEYS];
 		stepNoteP[patternNum][i].len = 0;
 	}
+	updatePlan(patternNum);
 }
 
 void clearPattern(int patternNum){
 	for (int i = 0; i < NUM_STEPS; i++){
 		// {notenum,vel,len,stepType,{p1,p2,p3,p4,p5}}
-		stepNoteP[patternNum][i].note = patternDefaultNoteMap[patternNum];
+		stepNoteP[patternNum][i].note = patternDefaultNoteMap[patternNum % NUM_PATTERN_KEYS];
 		stepNoteP[patternNum][i].vel = defaultVelocity;
 		stepNoteP[patternNum][i].len = 0;
 		stepNoteP[patternNum][i].stepType = STEPTYPE_NONE;
@@ -2246,6 +3170,8 @@ void clearPattern(int patternNum){
 		stepNoteP[patternNum][i].prob = 100;
 		stepNoteP[patternNum][i].condition = 0;
 	}
+	updatePlan(patternNum);
+	ccLanes.clear(patternNum);
 }
 
 void copyPattern(int patternNum){
@@ -2262,6 +3188,313 @@ void pastePattern(int patternNum){
 	//}
 
 	memcpy( &stepNoteP[patternNum], &copyPatternBuffer, NUM_STEPS * sizeof(StepNote) );
+	updatePlan(patternNum);
+}
+
+// #### PLAYBACK PLANS (see PatternPlan)
+
+// after any edit to stepNoteP[patternNum][stepNum]
+void updatePlanStep(int patternNum, int stepNum){
+	const StepNote& n = stepNoteP[patternNum][stepNum];
+	PlanStep& step = patternPlanSteps[patternNum][stepNum];
+	step.note = n.note;
+	step.vel = Grooves::velocity(patternSettings[patternNum].groove, stepNum, n.vel);
+	step.prob = n.prob;
+	step.condition = n.condition;
+	step.stepType = n.stepType;
+	step.flags = (n.trig == TRIGTYPE_PLAY ? PLAN_PLAY : 0) | (stepNum % 2 == 0 ? PLAN_SWING : 0)
+		| (n.params[4] > -1 ? PLAN_SUPERSTEP : 0) | (n.ratchet > 0 ? PLAN_RATCHET : 0);
+	step.len = n.len;
+	step.ratchet = n.ratchet;
+	step.ratchetVel = n.ratchetVel;
+	step.ratchetSpace = n.ratchetSpace;
+	step.plocks = 0;
+	for (int q=0; q<4; q++){
+		if (n.params[q] > -1) {
+			step.plocks |= 1 << q;
+		}
+	}
+	step.offsetTicks = n.nudge + Grooves::table[patternSettings[patternNum].groove].offset[stepNum % Grooves::length];
+	nextStepDue = 0;		// the step's lead may have changed, the next sweep works it out again
+}
+
+// note length in PPQ ticks, so tempo changes don't touch steps
+int planLengthTicks(const PlanStep& step){
+	return (step.len + 1) * (PPQ / 4);
+}
+
+// where the step's note-on falls from the step's time - swing, groove and
+// nudge, see groove.h. Worked out as the step plays so a tempo change only
+// touches the pattern's plan
+int32_t planOffset(const PatternPlan& plan, const PlanStep& step){
+	int32_t offset = step.offsetTicks * (int32_t)plan.tickMicros;
+	if ((step.flags & PLAN_SWING) && plan.swing < 99){
+		offset += plan.swingMicros; // full range swing, drunken swing is rolled as the step plays
+	}
+	int32_t earliest = -(int32_t)(plan.stepMicros / 2);
+	return offset < earliest ? earliest : offset;
+}
+
+// how far ahead of its time the pattern's next step is taken, so an early
+// note-on can still be queued before it's due
+Micros stepLead(int patternNum){
+	int32_t offset = planOffset(patternPlans[patternNum], patternPlanSteps[patternNum][seqPos[patternNum]]);
+	return offset < 0 ? -offset : 0;
+}
+
+// after a change to the pattern's channel, swing or clock div/mult, or the tempo. The
+// groove is in the steps, see updatePlan()
+void updatePlanTiming(int patternNum){
+	PatternPlan& plan = patternPlans[patternNum];
+	float mult = multValues[patternSettings[patternNum].clockDivMultP];
+	plan.channel = PatternChannel(patternNum);
+	plan.swing = patternSettings[patternNum].swing;
+	plan.stepMicros = step_micros * mult;
+	plan.tickMicros = plan.stepMicros / (PPQ / 4);
+	plan.swingUnit = (ppqInterval * mult)/(PPQ / 24);
+	plan.swingMicros = plan.swingUnit * plan.swing;
+	nextStepDue = 0;		// the steps' leads may have changed
+}
+
+void updatePlan(int patternNum){
+	updatePlanTiming(patternNum);
+	for (int i = 0; i < NUM_STEPS; i++){
+		updatePlanStep(patternNum, i);
+	}
+}
+
+void updateAllPlans(){
+	for (int p = 0; p < NUM_PATTERNS; p++){
+		updatePlan(p);
+	}
+}
+
+// #### PATTERN BANKS
+
+static_assert(sizeof(StepNote) <= PatternEncoder::maxRecord && sizeof(PatternSettings) <= PatternEncoder::maxRecord,
+	"the compact pattern format has one mask bit per record byte");
+
+// banks and dumps only exist from the current version on
+PatternBanks::Image bankImage(StepNote* steps, PatternSettings* settings) {
+	return { (uint8_t*)steps, sizeof(StepNote), NUM_STEPS, (uint8_t*)settings, sizeof(PatternSettings), NUM_PATTERNS, EEPROM_VERSION, EEPROM_VERSION,
+		(const uint8_t*)defaultStepP, (const uint8_t*)defaultSettingsP };
+}
+
+int shownBank() {
+	return patternBanks.loadingBank() >= 0 ? patternBanks.loadingBank() : currentBank;
+}
+
+// a SysEx load is writing the shadow copy, or holds a finished one there
+bool sysExOwnsShadow() {
+	return patternSysEx.loadInProgress() || patternSysEx.loadReady();
+}
+
+void selectBank(int bank) {
+	if (sysExOwnsShadow()) {
+		return;
+	}
+	if (bank == currentBank) {
+		patternBanks.clear();	// changed our mind
+	} else {
+		patternBanks.load(bank, bankImage(&bankStepNoteP[0][0], bankPatternSettings));
+	}
+	dirtyDisplay = true;
+}
+
+// Only called between steps, so the sequencer never sees half of each bank.
+// Pending notes are left alone and finish as scheduled.
+void swapBank() {
+	if (sysExOwnsShadow()) {
+		return;		// the shadow copy isn't a bank, applySysExLoad() takes it
+	}
+	if (patternBanks.loadFailed()) {
+		initPatterns();		// nothing saved in that bank yet
+	} else {
+		memcpy( &stepNoteP, &bankStepNoteP, sizeof(stepNoteP) );
+		memcpy( &patternSettings, &bankPatternSettings, sizeof(patternSettings) );
+	}
+	updateAllPlans();
+	currentBank = patternBanks.loadingBank();
+	patternBanks.clear();
+	dirtyDisplay = true;
+}
+
+// #### SONG MODE (see song.h)
+
+// the slot's bank is live, or read and waiting in the shadow copy
+bool songSlotReady(const Song::Slot& slot) {
+	if (slot.bank == currentBank) {
+		return true;
+	}
+	return !sysExOwnsShadow() && patternBanks.ready() && patternBanks.loadingBank() == slot.bank;
+}
+
+// read the next slot's bank while this one plays
+void preloadSongSlot() {
+	if (sysExOwnsShadow()) {
+		return;		// tried again on the next bar
+	}
+	const Song::Slot& next = song.upcoming();
+	if (next.bank != currentBank && patternBanks.loadingBank() != next.bank) {
+		patternBanks.load(next.bank, bankImage(&bankStepNoteP[0][0], bankPatternSettings));
+	}
+}
+
+// Starts the slot on the bar at barTime. Every pattern starts again from its
+// first step, so the slot lines up with the bar whatever played before it.
+// Pending notes are left alone and finish as scheduled.
+void startSongSlot(const Song::Slot& slot, Micros barTime) {
+	PROFILE_SCOPE(PROF_SWAP);
+
+	if (slot.bank != currentBank) {
+		swapBank();		// songSlotReady() said it's in the shadow copy
+	}
+	playingPattern = constrain(slot.pattern, 0, NUM_PATTERNS - 1);
+	for (int k=0; k<NUM_PATTERNS; k++){
+		restartPattern(k);
+		nextStepTimeP[k] = barTime;
+		lastStepTimeP[k] = barTime;
+	}
+	nextStepDue = barTime;
+	dirtyDisplay = true;
+}
+
+// called from doStep() once the clock reaches nextBarTime, before any step on that bar
+void songBar(Micros barTime) {
+	const Song::Slot& next = song.upcoming();
+	if (song.bar(songSlotReady(next))) {
+		startSongSlot(next, barTime);
+	}
+	preloadSongSlot();
+	nextBarTime = barTime + ppqInterval * PPQ * 4;		// until the clock's next tick says otherwise
+}
+
+// from the first slot on the first bar. Nothing is playing yet, so its bank
+// is read now if it isn't the live one.
+void songStart() {
+	song.start();
+	const Song::Slot& first = song.upcoming();
+	if (first.bank != currentBank && !sysExOwnsShadow()) {
+		if (patternBanks.loadingBank() != first.bank) {
+			patternBanks.load(first.bank, bankImage(&bankStepNoteP[0][0], bankPatternSettings));
+		}
+		while (patternBanks.loading()) {
+			patternBanks.update();
+		}
+	}
+}
+
+// the SONG box on the pattern params page, 0 turns song mode off
+void selectSongSlot(int slot) {
+	songSlot = slot;
+	if (slot > 1 && song.slot(slot - 1).bars == 0) {
+		// a new slot at the end, start from the one before
+		song.slot(slot - 1).bank = song.slot(slot - 2).bank;
+		song.slot(slot - 1).pattern = song.slot(slot - 2).pattern;
+	}
+
+	bool wasOn = song.enabled();
+	song.enable(slot > 0);
+	if (wasOn && !song.enabled()) {
+		patternBanks.clear();		// drop a preloaded bank, it isn't wanted now
+	} else if (playing && song.playing()) {
+		preloadSongSlot();			// just turned on, the first slot starts on the next bar
+	}
+	dirtyDisplay = true;
+}
+
+// #### CC AUTOMATION LANES (see cclanes.h)
+
+const int laneTicks = 6;		// lane output rate, every 6th PPQ tick - 4 values a step
+
+// Schedules the pattern's lane values across the step that just started, timed
+// from its start so they land with the notes. Only changed values are sent.
+void playLanes(int patternNum) {
+	if (!ccLanes.hasLanes(patternNum)) {
+		return;
+	}
+	PROFILE_SCOPE(PROF_LANES);
+
+	Micros stepMicros = patternPlans[patternNum].stepMicros;
+	uint16_t stepTick = playedStepP[patternNum] * CCLanes::ticksPerStep;
+	for (int k=0; k<NUM_CC_POTS; k++){
+		int lane = ccLanes.find(patternNum, k);
+		if (lane < 0 || ccLanes.recording(patternNum, k)) {
+			continue;		// the pot itself is playing
+		}
+		for (int t=0; t<CCLanes::ticksPerStep; t+=laneTicks){
+			int v = ccLanes.valueAt(lane, stepTick + t);
+			if (v != ccLaneSent[patternNum][k]) {
+				ccLaneSent[patternNum][k] = v;
+				Micros at = lastStepTimeP[patternNum] + stepMicros * t / CCLanes::ticksPerStep;
+				pendingControlChanges.insert(pots[k], v, PatternChannel(patternNum), at);
+			}
+		}
+	}
+}
+
+// a pot moved while recording, placed on the playing pattern's tick grid
+void recordLane(int k) {
+	int p = playingPattern;
+	Micros stepMicros = patternPlans[p].stepMicros;
+	Micros now = micros();
+	Micros into = now > lastStepTimeP[p] ? now - lastStepTimeP[p] : 0;		// the step may have been taken early
+	int subTick = stepMicros > 0 ? into * CCLanes::ticksPerStep / stepMicros : 0;
+	if (subTick > CCLanes::ticksPerStep - 1) {
+		subTick = CCLanes::ticksPerStep - 1;
+	}
+	ccLanes.record(p, k, playedStepP[p] * CCLanes::ticksPerStep + subTick, analogValues[k]);
+	ccLaneSent[p][k] = analogValues[k];
+}
+
+// #### SYSEX DUMP / LOAD (see sysex.h)
+
+// header fields as in saveHeader()
+const int SYSEX_HEADER_SIZE = 4 + NUM_CC_POTS;
+
+void onSysEx(const uint8_t* data, uint16_t length, bool complete) {
+	if (complete && mtcIn.fullFrame(data, length, micros())) {
+		return;		// an MTC locate
+	}
+	patternSysEx.receive(data, length, complete);
+	if (patternSysEx.loadInProgress()) {
+		patternBanks.clear();	// the load owns the shadow copy from its header on
+	}
+}
+
+void onQuarterFrame(uint8_t data) {
+	mtcIn.quarterFrame(data, micros());
+}
+
+void sendSysExDump() {
+	uint8_t header[SYSEX_HEADER_SIZE];
+	header[0] = (uint8_t)omxMode;
+	header[1] = (uint8_t)playingPattern;
+	header[2] = (uint8_t)( midiChannel - 1 );
+	header[3] = (uint8_t)currentBank;
+	for ( int i=0; i<NUM_CC_POTS; i++ ) {
+		header[4 + i] = pots[i];
+	}
+	patternSysEx.sendDump( bankImage( &stepNoteP[0][0], patternSettings ), header, SYSEX_HEADER_SIZE );
+}
+
+// a complete, checked load is waiting in the shadow copy
+void applySysExLoad() {
+	memcpy( &stepNoteP, &bankStepNoteP, sizeof(stepNoteP) );
+	memcpy( &patternSettings, &bankPatternSettings, sizeof(patternSettings) );
+
+	// mode and bank stay as they are, they belong to this unit
+	if ( patternSysEx.loadHeaderLength() >= SYSEX_HEADER_SIZE ) {
+		const uint8_t* header = patternSysEx.loadHeader();
+		playingPattern = constrain( header[1], 0, NUM_PATTERNS - 1 );
+		midiChannel = constrain( header[2], 0, 15 ) + 1;
+		for ( int i=0; i<NUM_CC_POTS; i++ ) {
+			pots[i] = header[4 + i] & 0x7F;
+		}
+	}
+	updateAllPlans();
+	patternSysEx.loadApplied();
+	dirtyDisplay = true;
 }
 
 void u8g2centerText(const char* s, int16_t x, int16_t y, uint16_t w, uint16_t h) {
@@ -2285,30 +3518,6 @@ void u8g2centerNumber(int n, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
 
 
 // #### LED STUFF
-// Rainbow cycle along whole strip. Pass delay time (in ms) between frames.
-void rainbow(int wait) {
-  // Hue of first pixel runs 5 complete loops through the color wheel.
-  // Color wheel has a range of 65536 but it's OK if we roll over, so
-  // just count from 0 to 5*65536. Adding 256 to firstPixelHue each time
-  // means we'll make 5*65536/256 = 1280 passes through this outer loop:
-  for(long firstPixelHue = 0; firstPixelHue < 1*65536; firstPixelHue += 256) {
-    for(int i=0; i<strip.numPixels(); i++) { // For each pixel in strip...
-      // Offset pixel hue by an amount to make one full revolution of the
-      // color wheel (range of 65536) along the length of the strip
-      // (strip.numPixels() steps):
-      int pixelHue = firstPixelHue + (i * 65536L / strip.numPixels());
-
-      // strip.ColorHSV() can take 1 or 3 arguments: a hue (0 to 65535) or
-      // optionally add saturation and value (brightness) (each 0 to 255).
-      // Here we're using just the single-argument hue variant. The result
-      // is passed through strip.gamma32() to provide 'truer' colors
-      // before assigning to each pixel:
-      strip.setPixelColor(i, strip.gamma32(strip.ColorHSV(pixelHue)));
-    }
-    strip.show(); // Update strip with new contents
-    delay(wait);  // Pause for a moment
-  }
-}
 void setAllLEDS(int R, int G, int B) {
 	for(int i=0; i<LED_COUNT; i++) { // For each pixel...
 		strip.setPixelColor(i, strip.Color(R, G, B));
@@ -2316,35 +3525,212 @@ void setAllLEDS(int R, int G, int B) {
 	dirtyPixels = true;
 }
 
-// #### OLED STUFF
-void testdrawrect(void) {
-  display.clearDisplay();
-
-  for(int16_t i=0; i<display.height()/2; i+=2) {
-    display.drawRect(i, i, display.width()-2*i, display.height()-2*i, SSD1306_WHITE);
-    display.display(); // Update screen with each newly-drawn rectangle
-    delay(1);
-  }
+// #### STARTUP ANIMATION
+// Runs one frame per call from loop() so MIDI, clock and the sequencer are live
+// while it plays. Any key or encoder turn skips the rest.
+
+enum BootPhase {
+	BOOT_RECTS = 0,	// nested rectangles on the OLED
+	BOOT_LOADING,	// OMX-27 + spinner
+	BOOT_LEDS,		// light up each key
+	BOOT_RAINBOW,	// rainbow cycle across the strip
+	BOOT_CLEAR,		// hold, then clear LEDs
+	BOOT_DONE
+};
+
+BootPhase bootPhase = BOOT_DONE;
+int bootFrame = 0;
+elapsedMillis bootFrameTimer = 0;
+unsigned long bootFrameWait = 0;
+
+void startBootAnimation() {
+	bootPhase = BOOT_RECTS;
+	bootFrame = 0;
+	bootFrameWait = 0;
+	bootFrameTimer = 0;
+	display.clearDisplay();
+}
 
-  delay(500);
+void endBootAnimation() {
+	if (bootPhase == BOOT_DONE) return;
+	bootPhase = BOOT_DONE;
+	strip.fill(0, 0, LED_COUNT);
+	display.clearDisplay();
+	display.display();
+	dirtyPixels = true;
+	dirtyDisplay = true;
 }
 
-void drawLoading(void) {
+// returns true while the animation owns the display and LEDs
+bool updateBootAnimation() {
+	if (bootPhase == BOOT_DONE) return false;
+	if (bootFrameTimer < bootFrameWait) return true;
+	bootFrameTimer = 0;
+
 	const char* loader[] = {"\u25f0", "\u25f1", "\u25f2", "\u25f3"};
-	display.clearDisplay();
-	u8g2_display.setFontMode(0);  
-	for(int16_t i=0; i<16; i+=1) {
-		display.clearDisplay();
-		u8g2_display.setCursor(18,18);
-		u8g2_display.setFont(FONT_TENFAT);
-		u8g2_display.print("OMX-27");
-		u8g2_display.setFont(FONT_SYMB_BIG);
-		u8g2centerText(loader[i%4], 80, 10, 32, 32); // "\u00BB\u00AB" // // dice: "\u2685"
-		display.display();
-		delay(100);
+
+	switch (bootPhase) {
+		case BOOT_RECTS: {
+			int16_t i = bootFrame * 2;
+			display.drawRect(i, i, display.width()-2*i, display.height()-2*i, SSD1306_WHITE);
+			display.display();
+			bootFrameWait = 1;
+			if (++bootFrame >= display.height()/4) {
+				bootPhase = BOOT_LOADING;
+				bootFrame = 0;
+				bootFrameWait = 700;
+			}
+			break;
+		}
+		case BOOT_LOADING:
+			display.clearDisplay();
+			u8g2_display.setFontMode(0);
+			u8g2_display.setCursor(18,18);
+			u8g2_display.setFont(FONT_TENFAT);
+			u8g2_display.print("OMX-27");
+			u8g2_display.setFont(FONT_SYMB_BIG);
+			u8g2centerText(loader[bootFrame%4], 80, 10, 32, 32); // "\u00BB\u00AB" // // dice: "\u2685"
+			display.display();
+			bootFrameWait = 100;
+			if (++bootFrame >= 16) {
+				bootPhase = BOOT_LEDS;
+				bootFrame = 0;
+				bootFrameWait = 200;
+			}
+			break;
+		case BOOT_LEDS:
+			strip.setPixelColor(bootFrame, HALFWHITE);
+			strip.show();
+			bootFrameWait = 5;
+			if (++bootFrame >= LED_COUNT) {
+				bootPhase = BOOT_RAINBOW;
+				bootFrame = 0;
+			}
+			break;
+		case BOOT_RAINBOW: {
+			// one revolution of the color wheel, 256 frames
+			long firstPixelHue = bootFrame * 256L;
+			for(int i=0; i<strip.numPixels(); i++) {
+				int pixelHue = firstPixelHue + (i * 65536L / strip.numPixels());
+				strip.setPixelColor(i, strip.gamma32(strip.ColorHSV(pixelHue)));
+			}
+			strip.show();
+			bootFrameWait = 5;
+			if (++bootFrame >= 65536 / 256) {
+				bootPhase = BOOT_CLEAR;
+				bootFrame = 0;
+				bootFrameWait = 500;
+			}
+			break;
+		}
+		case BOOT_CLEAR:
+			endBootAnimation();
+			return false;
+		default:
+			break;
+	}
+	return true;
+}
+
+#if BOOT_TIMING
+// print how long it took to get MIDI going once someone is listening on Serial
+void reportBootTiming() {
+	if (bootTimingReported || !Serial) return;
+	if (!MM::firstSendMicros() && !MM::firstReceiveMicros()) return;
+	bootTimingReported = true;
+
+	Serial.print("boot: setup done ");
+	Serial.print(setupDoneMicros);
+	Serial.print("us, first MIDI out ");
+	Serial.print(MM::firstSendMicros());
+	Serial.print("us, first MIDI in ");
+	Serial.print(MM::firstReceiveMicros());
+	Serial.println("us");
+}
+#endif
+
+#if PROFILE_LOOP || TRACE_TIMING || INPUT_RECORD
+// single character debug commands over Serial
+void serialCommands() {
+	while (Serial.available()) {
+		int c = Serial.read();
+#if PROFILE_LOOP
+		if (c == 'p') {
+			loopProfiler.dump();
+		} else if (c == 'r') {
+			loopProfiler.reset();
+		}
+#endif
+#if TRACE_TIMING
+		if (c == 't') {
+			traceRing.toggleStreaming();
+		}
+#endif
+#if INPUT_RECORD
+		if (c == 'i') {
+			inputLog.toggleStreaming();
+		}
+#endif
 	}
+}
+#endif
+
+#if PROFILE_LOOP
+// #### LOOP PROFILER
+// hidden page - long press the encoder on the mode select screen, turn to pick
+// a section, press to leave. Send 'p' over Serial for a full dump, 'r' to reset.
+
+void updateProfiler() {
+	if (profilerPage && profilerRefresh > 250) {
+		profilerRefresh = 0;
+		dirtyDisplay = true;
+	}
+}
+
+void dispProfilerPage() {
+	LoopProfiler::Stats st;
+	loopProfiler.stats(profilerSection, st);
+	char line[32];
+
+	display.clearDisplay();
+	u8g2_display.setFontMode(1);
+	u8g2_display.setFont(FONT_LABELS);
+	u8g2_display.setForegroundColor(WHITE);
+	u8g2_display.setBackgroundColor(BLACK);
+
+	snprintf(line, sizeof(line), "%s  n=%lu", loopProfiler.name(profilerSection), (unsigned long)st.count);
+	u8g2_display.setCursor(0, 8);
+	u8g2_display.print(line);
+	snprintf(line, sizeof(line), "min %lu  avg %lu us", (unsigned long)st.min, (unsigned long)st.avg);
+	u8g2_display.setCursor(0, 19);
+	u8g2_display.print(line);
+	snprintf(line, sizeof(line), "p99 %lu  max %lu us", (unsigned long)st.p99, (unsigned long)st.max);
+	u8g2_display.setCursor(0, 30);
+	u8g2_display.print(line);
+}
+#endif
 
-  delay(100);
+// as initPatterns() leaves a pattern. Set a field at a time so the unused
+// bits stay zero, the compact format compares whole bytes.
+void initPatternDefaults( void ) {
+	for ( int i=0; i<NUM_PATTERNS; i++ ) {
+		StepNote& step = defaultStepP[i];
+		step.note = patternDefaultNoteMap[i % NUM_PATTERN_KEYS];
+		step.vel = 100;
+		step.len = 0;
+		step.trig = TRIGTYPE_MUTE;
+		for ( int q=0; q<5; q++ ) step.params[q] = -1;
+		step.prob = 100;
+		step.condition = 0;
+		step.stepType = STEPTYPE_NONE;
+
+		PatternSettings& settings = defaultSettingsP[i];
+		settings.len = 15;
+		settings.channel = i;
+		settings.current_cycle = 1;
+		settings.rndstep = 3;
+		settings.clockDivMultP = 3;
+	}
 }
 
 void initPatterns( void ) {
@@ -2359,28 +3745,15 @@ void initPatterns( void ) {
 //		49,
 //		51 };
 
-	StepNote stepNote = { 0, 100, 0, TRIGTYPE_MUTE, { -1, -1, -1, -1, -1 }, 100, 0, STEPTYPE_NONE };
-					// {note, vel, len, TRIGTYPE, {params0, params1, params2, params3, params4}, prob, condition, STEPTYPE}
-
 	for ( int i=0; i<NUM_PATTERNS; i++ ) {
-		stepNote.note = patternDefaultNoteMap[i];		// Defined in sequencer.h
+		// note from patternDefaultNoteMap, vel 100, muted, no p-locks, length 16 on
+		// channel i+1 - see initPatternDefaults()
 		for ( int j=0; j<NUM_STEPS; j++ ) {			
-			memcpy( &stepNoteP[i][j], &stepNote, sizeof(StepNote) );
+			memcpy( &stepNoteP[i][j], &defaultStepP[i], sizeof(StepNote) );
 		}
 
-		patternSettings[i].len = 15;
-		patternSettings[i].channel = i;		// 0 - 15 becomes 1 - 16
-		patternSettings[i].mute = false;
-		patternSettings[i].reverse = false;
-		patternSettings[i].swing = 0;
-		patternSettings[i].startstep = 0;
-		patternSettings[i].autoresetstep = 0;
-		patternSettings[i].autoresetfreq = 0;
-		patternSettings[i].autoresetprob = 0;
-		patternSettings[i].current_cycle = 1;
-		patternSettings[i].rndstep = 3;
-		patternSettings[i].autoreset = false;
-		patternSettings[i].solo = false;
+		memcpy( &patternSettings[i], &defaultSettingsP[i], sizeof(PatternSettings) );
+		resetAutoreset(i);
 	}
 }
 
@@ -2402,7 +3775,17 @@ void saveHeader( void ) {
 		EEPROM.update( EEPROM_HEADER_ADDRESS + 4 + i, pots[i] );
 	}
 
-	// 23 bytes remain for header fields
+	// 1 byte for the pattern bank
+	EEPROM.update( EEPROM_HEADER_ADDRESS + 9, (uint8_t)currentBank );
+
+	// 1 byte for the random seed
+	EEPROM.update( EEPROM_HEADER_ADDRESS + 10, (uint8_t)patternSeed );
+
+	// 1 byte each for the pattern dimensions this was saved with
+	EEPROM.update( EEPROM_HEADER_ADDRESS + 11, (uint8_t)NUM_PATTERNS );
+	EEPROM.update( EEPROM_HEADER_ADDRESS + 12, (uint8_t)NUM_STEPS );
+
+	// 3 bytes remain for header fields, 16-31 are used by upgradeEEPROM()
 }
 
 // returns true if the header contained initialized data
@@ -2421,11 +3804,21 @@ bool loadHeader( void ) {
 		return false;
 	}
 
-	if ( version != EEPROM_VERSION ) {
-		// write an adapter if we ever need to increment the EEPROM version and also save the existing patterns
-		// for now, return false will essentially reset the state
+	// saved by a build with other pattern dimensions, nothing past the header lines up.
+	// Version 8 didn't save them, it was only ever 8 x 16 (see upgradeStep8())
+	if ( version != 8
+		&& ( EEPROM.read( EEPROM_HEADER_ADDRESS + 11 ) != NUM_PATTERNS || EEPROM.read( EEPROM_HEADER_ADDRESS + 12 ) != NUM_STEPS ) ) {
 		return false;
 	}
+
+	// older layouts are upgraded in place, anything we can't read resets the state.
+	// A current version with upgrade progress left means the power went off as an
+	// upgrade was finishing
+	if ( version != EEPROM_VERSION || EEPROM.read( EEPROM_UPGRADE_ADDRESS ) != 0xFF ) {
+		if ( !upgradeEEPROM( version ) ) {
+			return false;
+		}
+	}
 	
 	omxMode = (OMXMode)EEPROM.read( EEPROM_HEADER_ADDRESS + 1 );
 
@@ -2438,31 +3831,227 @@ bool loadHeader( void ) {
 		pots[i] = EEPROM.read( EEPROM_HEADER_ADDRESS + 4 + i );
 	}
 
+	currentBank = EEPROM.read( EEPROM_HEADER_ADDRESS + 9 );
+	if ( currentBank >= NUM_BANKS ) {
+		currentBank = 0;	// saved before banks existed
+	}
+
+	patternSeed = EEPROM.read( EEPROM_HEADER_ADDRESS + 10 );
+	if ( patternSeed > 99 ) {
+		patternSeed = 0;	// saved before seeds existed
+	}
+
 	return true;
 }
 
-void savePatterns( void ) {
-	int nLocalAddress = EEPROM_PATTERN_ADDRESS;
-	int s = sizeof( StepNote );
+// ####### EEPROM VERSION UPGRADES #######
+
+// One entry per EEPROM_VERSION we can still read, oldest first. Each entry's
+// functions convert a single StepNote / PatternSettings record, the index'th, from
+// that version into the layout of the next entry. The last entry is the current
+// layout. Patterns always start at EEPROM_PATTERN_ADDRESS; the journal, in the
+// versions that have one, follows the settings.
+struct EepromUpgrade {
+	uint8_t version;
+	int stepSize;
+	int settingsSize;
+	int settingsAddress;
+	bool journal;
+	void (*upgradeStep)( int index, const uint8_t* from, uint8_t* to );
+	void (*upgradeSettings)( int index, const uint8_t* from, uint8_t* to );
+};
+
+#if NUM_PATTERNS == 8 && NUM_STEPS == 16
+// Version 8 saved the settings at a fixed 1056, after writing the steps, so they
+// overwrote steps 85 - 89 (pattern 5, steps 5 - 9). Those come back as the
+// pattern's default step, every other step and the settings as they were. The
+// records were the same size: the ratchet bits were unused bits after stepType
+// and groove unused bits after solo, that nothing promised to keep clear, and
+// nudge was the step's padding byte
+const int V8_SETTINGS_ADDRESS = 1056;
+static_assert(sizeof(StepNote) == 12 && sizeof(PatternSettings) == 7, "version 8 records are read in place");
+
+void upgradeStep8( int index, const uint8_t* from, uint8_t* to ) {
+	StepNote step;
+	int address = EEPROM_PATTERN_ADDRESS + index * sizeof(StepNote);
+	if ( address + (int)sizeof(StepNote) > V8_SETTINGS_ADDRESS
+		&& address < V8_SETTINGS_ADDRESS + NUM_PATTERNS * (int)sizeof(PatternSettings) ) {
+		memcpy( &step, &defaultStepP[index / NUM_STEPS], sizeof(StepNote) );
+	} else {
+		memcpy( &step, from, sizeof(StepNote) );
+	}
+	step.ratchet = 0;
+	step.ratchetVel = 0;
+	step.ratchetSpace = 0;
+	step.nudge = 0;
+	memcpy( to, &step, sizeof(StepNote) );
+}
 
-	// EEPROM.put uses EEPROM.update under the hood, so writes here of the same data are a noop
+void upgradeSettings8( int index, const uint8_t* from, uint8_t* to ) {
+	PatternSettings settings;
+	memcpy( &settings, from, sizeof(PatternSettings) );
+	settings.groove = 0;
+	memcpy( to, &settings, sizeof(PatternSettings) );
+}
+#endif
+
+// Older than version 8 isn't read back
+const EepromUpgrade eepromUpgrades[] = {
+#if NUM_PATTERNS == 8 && NUM_STEPS == 16
+	{ 8, 12, 7, V8_SETTINGS_ADDRESS, false, upgradeStep8, upgradeSettings8 },
+#endif
+	{ EEPROM_VERSION, sizeof(StepNote), sizeof(PatternSettings), EEPROM_PATTERN_SETTINGS_ADDRESS, true, nullptr, nullptr },
+};
+const int NUM_EEPROM_UPGRADES = sizeof(eepromUpgrades) / sizeof(eepromUpgrades[0]);
+const int MAX_UPGRADE_RECORD = 16;
+static_assert(sizeof(StepNote) <= MAX_UPGRADE_RECORD && sizeof(PatternSettings) <= MAX_UPGRADE_RECORD,
+	"upgradeRecords() converts a record at a time in MAX_UPGRADE_RECORD bytes");
+
+// Upgrade progress lives in spare header bytes so a power pull mid-upgrade resumes
+// where it left off instead of converting records twice:
+// +0 version being upgraded, +1 pass, +2 records done, +4 scratch owner.
+// The scratch copy of the record being converted doesn't fit after them, it takes
+// the last bytes of EEPROM instead - the old journal is folded before the first
+// record and the new one formatted after the last, so nothing else is there then
+const int UPGRADE_VERSION = EEPROM_UPGRADE_ADDRESS + 0;
+const int UPGRADE_PASS = EEPROM_UPGRADE_ADDRESS + 1;
+const int UPGRADE_DONE = EEPROM_UPGRADE_ADDRESS + 2;
+const int UPGRADE_SCRATCH_OWNER = EEPROM_UPGRADE_ADDRESS + 4;
+const int UPGRADE_SCRATCH = E2END + 1 - MAX_UPGRADE_RECORD;
+static_assert(UPGRADE_SCRATCH_OWNER + 2 <= EEPROM_HEADER_ADDRESS + EEPROM_HEADER_SIZE,
+	"the upgrade progress must fit in the header");
+#if PATTERNS_IN_EEPROM
+static_assert(UPGRADE_SCRATCH >= EEPROM_JOURNAL_ADDRESS,
+	"the upgrade scratch copy must be past the pattern image");
+#endif
+
+uint16_t readEEPROMWord( int address ) {
+	return EEPROM.read( address ) | ( EEPROM.read( address + 1 ) << 8 );
+}
 
-	// for each pattern
-	for ( int i=0; i<NUM_PATTERNS; i++ ) {
-		for ( int j=0; j<NUM_STEPS; j++ ) {
-			EEPROM.put( nLocalAddress, stepNoteP[i][j] );
-			nLocalAddress += s;
+void writeEEPROMWord( int address, uint16_t value ) {
+	EEPROM.update( address, value & 0xFF );
+	EEPROM.update( address + 1, value >> 8 );
+}
+
+// rewrite one block of records in place, one record at a time
+void upgradeRecords( int pass, int fromAddress, int fromSize, int toAddress, int toSize, int count,
+					void (*convert)( int index, const uint8_t* from, uint8_t* to ) ) {
+	int done = 0;
+	uint8_t lastPass = EEPROM.read( UPGRADE_PASS );
+	if ( lastPass != 0xFF && lastPass > pass ) {
+		return;		// finished before a power pull
+	} else if ( lastPass == pass ) {
+		done = readEEPROMWord( UPGRADE_DONE );	// resuming
+	} else {
+		writeEEPROMWord( UPGRADE_SCRATCH_OWNER, 0xFFFF );
+		writeEEPROMWord( UPGRADE_DONE, 0 );
+		EEPROM.update( UPGRADE_PASS, pass );
+	}
+
+	// when records grow, work back to front so we never write over one we haven't read yet
+	bool backwards = toAddress + toSize * count > fromAddress + fromSize * count;
+
+	uint8_t from[MAX_UPGRADE_RECORD];
+	uint8_t to[MAX_UPGRADE_RECORD];
+	for ( int k = done; k < count; k++ ) {
+		int i = backwards ? count - 1 - k : k;
+
+		// keep a copy of the old record until the new one is in place
+		if ( readEEPROMWord( UPGRADE_SCRATCH_OWNER ) == k ) {
+			for ( int b = 0; b < fromSize; b++ ) from[b] = EEPROM.read( UPGRADE_SCRATCH + b );
+		} else {
+			for ( int b = 0; b < fromSize; b++ ) from[b] = EEPROM.read( fromAddress + i * fromSize + b );
+			for ( int b = 0; b < fromSize; b++ ) EEPROM.update( UPGRADE_SCRATCH + b, from[b] );
+			writeEEPROMWord( UPGRADE_SCRATCH_OWNER, k );
 		}
+
+		convert( i, from, to );
+		for ( int b = 0; b < toSize; b++ ) EEPROM.update( toAddress + i * toSize + b, to[b] );
+		writeEEPROMWord( UPGRADE_DONE, k + 1 );
 	}
+}
 
-	nLocalAddress = EEPROM_PATTERN_SETTINGS_ADDRESS;
-	s = sizeof( PatternSettings );
+// returns true if the stored data is now at EEPROM_VERSION
+bool upgradeEEPROM( uint8_t version ) {
+#if !PATTERNS_IN_EEPROM
+	return false;	// no patterns in EEPROM to upgrade, bank files carry their own version
+#endif
+	int u = 0;
+	while ( u < NUM_EEPROM_UPGRADES && eepromUpgrades[u].version != version ) u++;
+	if ( u == NUM_EEPROM_UPGRADES ) {
+		return false;	// too old, or written by a newer firmware
+	}
 
-	// save pattern settings
-	for ( int i=0; i<NUM_PATTERNS; i++ ) {
-		EEPROM.put( nLocalAddress, patternSettings[i] );
-		nLocalAddress += s;
+	for ( ; u < NUM_EEPROM_UPGRADES - 1; u++ ) {
+		const EepromUpgrade& from = eepromUpgrades[u];
+		const EepromUpgrade& to = eepromUpgrades[u+1];
+		int fromSettings = from.settingsAddress;
+		int toSettings = to.settingsAddress;
+
+		bool resuming = EEPROM.read( UPGRADE_VERSION ) == from.version;
+		if ( !resuming && from.journal ) {
+			// fold the old journal into the old image first, the new image may grow over it
+			PatternJournal oldJournal;
+			oldJournal.begin(
+				{ nullptr, from.stepSize, NUM_PATTERNS * NUM_STEPS, EEPROM_PATTERN_ADDRESS },
+				{ nullptr, from.settingsSize, NUM_PATTERNS, fromSettings },
+				fromSettings + NUM_PATTERNS * from.settingsSize, EEPROM.length() );
+			oldJournal.replay();
+			oldJournal.compact();
+		}
+		if ( !resuming ) {
+			EEPROM.update( UPGRADE_PASS, 0xFF );
+			EEPROM.update( UPGRADE_VERSION, from.version );
+		}
+
+		// settings sit after the patterns, so move them first if the patterns grow
+		if ( toSettings > fromSettings ) {
+			upgradeRecords( 0, fromSettings, from.settingsSize, toSettings, to.settingsSize, NUM_PATTERNS, from.upgradeSettings );
+			upgradeRecords( 1, EEPROM_PATTERN_ADDRESS, from.stepSize, EEPROM_PATTERN_ADDRESS, to.stepSize, NUM_PATTERNS * NUM_STEPS, from.upgradeStep );
+		} else {
+			upgradeRecords( 0, EEPROM_PATTERN_ADDRESS, from.stepSize, EEPROM_PATTERN_ADDRESS, to.stepSize, NUM_PATTERNS * NUM_STEPS, from.upgradeStep );
+			upgradeRecords( 1, fromSettings, from.settingsSize, toSettings, to.settingsSize, NUM_PATTERNS, from.upgradeSettings );
+		}
+
+		// the version byte commits this step, stale progress bytes are ignored after it.
+		// The dimensions go first, loadHeader() checks them from then on
+		EEPROM.update( EEPROM_HEADER_ADDRESS + 11, (uint8_t)NUM_PATTERNS );
+		EEPROM.update( EEPROM_HEADER_ADDRESS + 12, (uint8_t)NUM_STEPS );
+		EEPROM.update( EEPROM_HEADER_ADDRESS + 0, to.version );
+	}
+
+	// whatever is left where the journal now lives isn't ours
+	patternJournal.format();
+
+	// erase the progress, UPGRADE_VERSION last so loadHeader() sees a power
+	// pull before then and comes back here to finish
+	for ( int a = UPGRADE_PASS; a < EEPROM_HEADER_ADDRESS + EEPROM_HEADER_SIZE; a++ ) {
+		EEPROM.update( a, 0xFF );
+	}
+	for ( int b = 0; b < MAX_UPGRADE_RECORD; b++ ) {
+		EEPROM.update( UPGRADE_SCRATCH + b, 0xFF );
 	}
+	EEPROM.update( UPGRADE_VERSION, 0xFF );
+	return true;
+}
+
+#if PATTERNS_IN_EEPROM
+// the journal runs from the end of the fixed image to the end of EEPROM, and
+// needs room for at least a pattern's worth of step records
+static_assert(EEPROM_PATTERN_SETTINGS_ADDRESS >= EEPROM_PATTERN_ADDRESS + EEPROM_PATTERN_SIZE
+	&& EEPROM_JOURNAL_ADDRESS >= EEPROM_PATTERN_SETTINGS_ADDRESS + EEPROM_PATTERN_SETTINGS_SIZE,
+	"the pattern edit journal must not overlap the fixed pattern image");
+static_assert(EEPROM_JOURNAL_ADDRESS + 1 + NUM_STEPS * (4 + sizeof(StepNote)) <= E2END + 1,
+	"the pattern edit journal must fit in EEPROM");
+#endif
+
+void savePatterns( void ) {
+	// steps and pattern settings that changed since the last save are appended
+	// to the journal rather than overwritten in place - see journal.h
+#if PATTERNS_IN_EEPROM
+	patternJournal.save();
+#endif
 }
 
 void loadPatterns( void ) {
@@ -2487,6 +4076,9 @@ void loadPatterns( void ) {
 		EEPROM.get( nLocalAddress, patternSettings[i] );
 		nLocalAddress += s;
 	}
+
+	// newer edits are in the journal
+	patternJournal.replay();
 }
 
 // currently saves everything ( mode + patterns )
@@ -2494,6 +4086,9 @@ void saveToEEPROM( void ) {
 	//Serial.println( "saving..." );
 	saveHeader();
 	savePatterns();
+
+	// and keep the bank file in step with it
+	patternBanks.save( currentBank, bankImage( &stepNoteP[0][0], patternSettings ) );
 }
 
 // currently loads everything ( mode + patterns )
@@ -2507,9 +4102,15 @@ bool loadFromEEPROM( void ) {
 
 	if ( bContainedData ) {
 		//Serial.println( "loading patterns" );
+#if PATTERNS_IN_EEPROM
 		loadPatterns();
+#endif
 		return true;
 	}	
 
+	// nothing we can use, the journal belongs to whatever was there before
+#if PATTERNS_IN_EEPROM
+	patternJournal.format();
+#endif
 	return false;
 }
\ No newline at end of file
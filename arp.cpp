@@ -0,0 +1,81 @@
+#include "arp.h"
+
+const char* Arpeggiator::modeNames[ARP_MODES] = { "UP", "DN", "UD", "RND", "PLY" };
+
+Arpeggiator::Arpeggiator() {
+	mode = ARP_UP;
+	octaves = 1;
+	count = 0;
+	pos = 0;
+}
+
+void Arpeggiator::press(uint8_t note) {
+	if (count == maxHeld) return;
+	for (int i = 0; i < count; ++i) {
+		if (played[i] == note) return;
+	}
+	played[count] = note;
+
+	int i = count;
+	while (i > 0 && sorted[i - 1] > note) {
+		sorted[i] = sorted[i - 1];
+		i--;
+	}
+	sorted[i] = note;
+	count++;
+}
+
+namespace {
+	// false if it isn't there
+	bool removeNote(uint8_t* list, int count, uint8_t note) {
+		int i = 0;
+		while (i < count && list[i] != note) i++;
+		if (i == count) return false;
+		for (; i < count - 1; ++i) {
+			list[i] = list[i + 1];
+		}
+		return true;
+	}
+}
+
+void Arpeggiator::release(uint8_t note) {
+	if (removeNote(played, count, note)) {
+		removeNote(sorted, count, note);
+		count--;
+	}
+}
+
+void Arpeggiator::releaseAll() {
+	count = 0;
+}
+
+int Arpeggiator::next() {
+	if (count == 0) return -1;
+
+	int length = count * octaves;
+	int k;
+	switch (mode) {
+		case ARP_DOWN:
+			k = length - 1 - pos % length;
+			break;
+		case ARP_UPDOWN: {
+			int period = length > 1 ? 2 * length - 2 : 1;		// the top and bottom once each
+			int q = pos % period;
+			k = q < length ? q : period - q;
+			break;
+		}
+		case ARP_RANDOM:
+			k = rng.range(length);
+			break;
+		default:
+			k = pos % length;
+			break;
+	}
+	pos++;
+
+	int note = (mode == ARP_PLAYED ? played : sorted)[k % count] + 12 * (k / count);
+	while (note > 127) note -= 12;
+	return note;
+}
+
+Arpeggiator arp;
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "rng.h"
+
+// Arpeggiator for MIDI mode: the held keys played one at a time, in order,
+// over an octave range. This is just the note order - the sketch times the
+// notes on the clock and queues them with the pending note ons / offs.
+//
+// The held keys are kept twice, as pressed and sorted by pitch, in fixed
+// arrays updated on every press and release, so a key change is at most
+// maxHeld moves and never allocates. The order is a position into the
+// pattern the held keys make, taken modulo its length at each note, so keys
+// coming and going carry on from where it was instead of starting over.
+
+enum ArpMode {
+	ARP_UP = 0,
+	ARP_DOWN,
+	ARP_UPDOWN,
+	ARP_RANDOM,
+	ARP_PLAYED,		// as pressed
+
+	ARP_MODES
+};
+
+class Arpeggiator {
+	public:
+		static const int maxHeld = 26;		// a key each
+		static const int maxOctaves = 4;
+		static const char* modeNames[ARP_MODES];
+
+		Arpeggiator();
+		void seed(uint32_t seed) { rng.seed(seed, 0xA4); }
+
+		ArpMode mode;
+		int octaves;		// 1 - maxOctaves
+
+		void press(uint8_t note);
+		void release(uint8_t note);
+		void releaseAll();
+		int held() { return count; }
+
+		void restart() { pos = 0; }			// from the first note
+		int next();							// the next note, -1 with no keys held
+
+	private:
+		uint8_t played[maxHeld];
+		uint8_t sorted[maxHeld];
+		int count;
+		uint32_t pos;
+		Rng rng;
+};
+
+extern Arpeggiator arp;
@@ -0,0 +1,265 @@
+#include "banks.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "crc.h"
+#include "patterncodec.h"
+
+namespace {
+	void bankFileName(char* buf, int len, int bank) {
+		snprintf(buf, len, "bank%02d.omx", bank);
+	}
+	const char* tempFileName = "bank.tmp";
+}
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#ifndef BANK_FLASH_SIZE
+#define BANK_FLASH_SIZE (48 * 1024)		// program flash set aside for bank files
+#endif
+
+namespace {
+	class FlashBankStorage : public BankStorage {
+		public:
+			bool begin() {
+				return fs.begin(BANK_FLASH_SIZE);
+			}
+			bool exists(int bank) {
+				char name[16];
+				bankFileName(name, sizeof(name), bank);
+				return fs.exists(name);
+			}
+			bool read(int bank, uint32_t offset, void* buf, int len) {
+				if (bank != readBank) {
+					// keep the file open while a bank is streamed in
+					if (readBank >= 0) readFile.close();
+					char name[16];
+					bankFileName(name, sizeof(name), bank);
+					readFile = fs.open(name, FILE_READ);
+					readBank = readFile ? bank : -1;
+				}
+				if (readBank < 0 || !readFile.seek(offset)) return false;
+				return readFile.read(buf, len) == (size_t)len;
+			}
+			bool create(int bank) {
+				closeRead();
+				fs.remove(tempFileName);
+				writeFile = fs.open(tempFileName, FILE_WRITE);
+				writeBank = bank;
+				return writeFile;
+			}
+			bool append(const void* buf, int len) {
+				return writeFile && writeFile.write(buf, len) == (size_t)len;
+			}
+			bool commit() {
+				if (!writeFile) return false;
+				writeFile.close();
+				char name[16];
+				bankFileName(name, sizeof(name), writeBank);
+				return fs.rename(tempFileName, name);
+			}
+
+		private:
+			LittleFS_Program fs;
+			File readFile;
+			File writeFile;
+			int readBank = -1;
+			int writeBank = -1;
+
+			void closeRead() {
+				if (readBank >= 0) readFile.close();
+				readBank = -1;
+			}
+	};
+
+	FlashBankStorage flashBankStorage;
+}
+
+BankStorage& bankStorage = flashBankStorage;
+
+#else
+
+// desktop build - bank files in the working directory
+namespace {
+	class FileBankStorage : public BankStorage {
+		public:
+			bool begin() {
+				return true;
+			}
+			bool exists(int bank) {
+				char name[16];
+				bankFileName(name, sizeof(name), bank);
+				FILE* f = fopen(name, "rb");
+				if (f) fclose(f);
+				return f != nullptr;
+			}
+			bool read(int bank, uint32_t offset, void* buf, int len) {
+				char name[16];
+				bankFileName(name, sizeof(name), bank);
+				FILE* f = fopen(name, "rb");
+				if (!f) return false;
+				bool ok = fseek(f, offset, SEEK_SET) == 0 && fread(buf, 1, len, f) == (size_t)len;
+				fclose(f);
+				return ok;
+			}
+			bool create(int bank) {
+				writeFile = fopen(tempFileName, "wb");
+				writeBank = bank;
+				return writeFile != nullptr;
+			}
+			bool append(const void* buf, int len) {
+				return writeFile && fwrite(buf, 1, len, writeFile) == (size_t)len;
+			}
+			bool commit() {
+				if (!writeFile) return false;
+				fclose(writeFile);
+				writeFile = nullptr;
+				char name[16];
+				bankFileName(name, sizeof(name), writeBank);
+				return rename(tempFileName, name) == 0;
+			}
+
+		private:
+			FILE* writeFile = nullptr;
+			int writeBank = -1;
+	};
+
+	FileBankStorage fileBankStorage;
+}
+
+BankStorage& bankStorage = fileBankStorage;
+
+#endif
+
+
+PatternBanks::PatternBanks() {
+	clear();
+	loadPattern = -1;
+}
+
+bool PatternBanks::begin() {
+	return bankStorage.begin();
+}
+
+bool PatternBanks::save(int bank, const Image& from) {
+	uint8_t header[headerSize] = {
+		'O', 'M', 'X', 'B',
+		formatVersion,
+		from.version,
+		(uint8_t)from.stepSize,
+		(uint8_t)from.settingsSize,
+		(uint8_t)from.patterns,
+		(uint8_t)from.stepCount,
+		0, 0
+	};
+
+	if (!bankStorage.create(bank)) return false;
+	bool ok = bankStorage.append(header, headerSize);
+
+	// index, sizing each pattern with a dry run of the encoder
+	int offset = headerSize + from.patterns * indexEntrySize;
+	for (int p = 0; ok && p < from.patterns; ++p) {
+		const uint8_t* steps = from.steps + p * from.stepCount * from.stepSize;
+		const uint8_t* settings = from.settings + p * from.settingsSize;
+		uint8_t crc = crc8(0xFF, steps, from.stepCount * from.stepSize);
+		crc = crc8(crc, settings, from.settingsSize);
+		int chunk = PatternEncoder::size(from, p);
+
+		uint8_t entry[indexEntrySize] = {
+			(uint8_t)(offset & 0xFF), (uint8_t)(offset >> 8),
+			(uint8_t)(chunk & 0xFF), (uint8_t)(chunk >> 8),
+			crc, 0
+		};
+		ok = bankStorage.append(entry, indexEntrySize);
+		offset += chunk;
+	}
+
+	// pattern chunks, encoded straight out of the live image
+	PatternEncoder encoder;
+	uint8_t piece[pieceSize];
+	for (int p = 0; ok && p < from.patterns; ++p) {
+		encoder.begin(from, p);
+		int n;
+		while (ok && (n = encoder.read(piece, pieceSize)) > 0) {
+			ok = bankStorage.append(piece, n);
+		}
+	}
+
+	return bankStorage.commit() && ok;
+}
+
+int PatternBanks::maxFileSize(const Image& image) {
+	return headerSize + image.patterns * (indexEntrySize + PatternEncoder::maxSize(image));
+}
+
+void PatternBanks::load(int bank, const Image& into) {
+	loadImage = into;
+	loadBank = bank;
+	loadPattern = -1;
+	loadDone = false;
+	loadError = false;
+}
+
+void PatternBanks::update() {
+	if (!loading()) return;
+
+	bool ok;
+	if (loadPattern < 0) {
+		ok = readHeader();
+	} else {
+		ok = readPattern(loadPattern);
+	}
+	loadPattern++;
+
+	if (!ok) {
+		loadError = true;
+		loadDone = true;
+	} else if (loadPattern >= loadImage.patterns) {
+		loadDone = true;
+	}
+}
+
+bool PatternBanks::readHeader() {
+	uint8_t header[headerSize];
+	if (!bankStorage.exists(loadBank)) return false;
+	if (!bankStorage.read(loadBank, 0, header, headerSize)) return false;
+
+	return memcmp(header, "OMXB", 4) == 0
+		&& header[4] == formatVersion
+		&& header[5] >= loadImage.oldestVersion && header[5] <= loadImage.version
+		&& header[6] == loadImage.stepSize
+		&& header[7] == loadImage.settingsSize
+		&& header[8] == loadImage.patterns
+		&& header[9] == loadImage.stepCount;
+}
+
+bool PatternBanks::readPattern(int p) {
+	uint8_t entry[indexEntrySize];
+	if (!bankStorage.read(loadBank, headerSize + p * indexEntrySize, entry, indexEntrySize)) return false;
+	int offset = entry[0] | (entry[1] << 8);
+	int length = entry[2] | (entry[3] << 8);
+	if (length > PatternEncoder::maxSize(loadImage)) return false;
+
+	// decode a piece at a time straight into the image
+	PatternDecoder decoder;
+	decoder.begin(loadImage, p);
+	uint8_t piece[pieceSize];
+	for (int at = 0; at < length; at += pieceSize) {
+		int n = length - at < pieceSize ? length - at : pieceSize;
+		if (!bankStorage.read(loadBank, offset + at, piece, n)) return false;
+		for (int i = 0; i < n; ++i) {
+			if (!decoder.put(piece[i])) return false;
+		}
+	}
+	if (!decoder.done()) return false;
+
+	int stepBytes = loadImage.stepCount * loadImage.stepSize;
+	uint8_t crc = crc8(0xFF, loadImage.steps + p * stepBytes, stepBytes);
+	crc = crc8(crc, loadImage.settings + p * loadImage.settingsSize, loadImage.settingsSize);
+	return crc == entry[4];
+}
+
+PatternBanks patternBanks;
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+// Pattern banks: complete sets of patterns + pattern settings stored as files,
+// one per bank. On the Teensy the files live in LittleFS on program flash, on a
+// desktop build they're plain files in the working directory, so the format
+// code can be run and checked on Linux.
+//
+// Bank file layout (little endian):
+//   0  'O' 'M' 'X' 'B'
+//   4  format version
+//   5  EEPROM_VERSION of the records
+//   6  step record size, 7 settings record size
+//   8  number of patterns, 9 steps per pattern, 10-11 reserved
+//   12 index, per pattern: offset (2), length (2), crc8 (1), reserved (1)
+//   then one chunk per pattern in the compact format (see patterncodec.h),
+//   the crc is of the decoded steps followed by the decoded settings
+
+class BankStorage {
+	public:
+		virtual bool begin() = 0;
+		virtual bool exists(int bank) = 0;
+		virtual bool read(int bank, uint32_t offset, void* buf, int len) = 0;
+
+		// writes go to a temporary file which replaces the bank on commit(),
+		// so a bank is never left half written
+		virtual bool create(int bank) = 0;
+		virtual bool append(const void* buf, int len) = 0;
+		virtual bool commit() = 0;
+};
+
+extern BankStorage& bankStorage;
+
+
+class PatternBanks {
+	public:
+		struct Image {
+			uint8_t* steps;			// [patterns][stepCount] step records
+			int stepSize;
+			int stepCount;			// steps per pattern
+			uint8_t* settings;		// [patterns] settings records
+			int settingsSize;
+			int patterns;
+			uint8_t version;		// EEPROM_VERSION
+			uint8_t oldestVersion;	// oldest EEPROM_VERSION whose records load as they are
+			const uint8_t* stepDefaults;		// [patterns] step record of a blank pattern
+			const uint8_t* settingsDefaults;	// [patterns] settings record of a blank pattern
+		};
+
+		PatternBanks();
+		bool begin();
+
+		bool save(int bank, const Image& from);
+
+		// Loads into the given image one pattern per update(), so a bank can be
+		// read while another one keeps playing
+		void load(int bank, const Image& into);
+		void update();
+		bool loading() { return loadBank >= 0 && !loadDone; }
+		bool ready() { return loadBank >= 0 && loadDone; }
+		bool loadFailed() { return loadError; }		// missing or unreadable, image is untouched past the failure
+		int loadingBank() { return loadBank; }
+		int maxFileSize(const Image& image);		// every pattern as full as it gets
+		void clear() { loadBank = -1; loadDone = false; loadError = false; }
+
+	private:
+		static const int headerSize = 12;
+		static const int indexEntrySize = 6;
+		static const int pieceSize = 32;		// bytes read or written at a time
+		static const uint8_t formatVersion = 2;
+
+		Image loadImage;
+		int loadBank;
+		int loadPattern;		// next pattern to read, -1 = header
+		bool loadDone;
+		bool loadError;
+		bool readHeader();
+		bool readPattern(int p);
+};
+
+extern PatternBanks patternBanks;
@@ -0,0 +1,187 @@
+// OMX-27 pattern dump / load over SysEx - see sysex.h in the firmware for the protocol
+//
+// A dump is saved as a .syx file holding the messages exactly as the unit sent
+// them, so loading a file just replays it chunk by chunk, waiting for the unit
+// to acknowledge each one.
+
+var MANUFACTURER = 0x7D, DEVICE = 0x27;
+var DUMP_REQUEST = 1, HEADER = 2, PATTERN = 3, END = 4, ACK = 5;
+var STATUS = ["ok", "bad crc", "layout doesn't match this firmware", "bad chunk", "incomplete"];
+
+var midiAccess = null;
+var midiIn = null;
+var midiOut = null;
+
+var dumpMessages = null;	// collecting a dump
+var waitingAck = null;		// resolve() for the chunk in flight
+
+window.addEventListener("DOMContentLoaded", function(event) {
+	if (!navigator.requestMIDIAccess) {
+		document.querySelector("#midi").style.display = "none";
+		document.querySelector("#nomidi").style.display = "block";
+		return;
+	}
+	navigator.requestMIDIAccess({sysex: true}).then( onMIDIInit, onMIDIFail );
+
+	$("dump").onclick = requestDump;
+	$("load").onchange = function(ev) {
+		if (ev.target.files.length) loadFile(ev.target.files[0]);
+	};
+});
+
+function $(id) {
+	return document.getElementById(id);
+}
+
+function log(text) {
+	$("log").textContent += text + "\n";
+}
+
+function onMIDIInit(midi) {
+	midiAccess = midi;
+	fillSelect($("midiIn"), midiAccess.inputs, function(port) {
+		if (midiIn) midiIn.onmidimessage = null;
+		midiIn = port;
+		midiIn.onmidimessage = midiProcess;
+	});
+	fillSelect($("midiOut"), midiAccess.outputs, function(port) {
+		midiOut = port;
+	});
+}
+
+function onMIDIFail() {
+	log("Could not access your MIDI devices (SysEx permission is needed).");
+}
+
+// pick the omx-27 port by default
+function fillSelect(select, ports, choose) {
+	select.options.length = 0;
+	for (var port of ports.values()) {
+		var isOmx = port.name.toString().indexOf("omx-27") != -1;
+		select.add(new Option(port.name, port.id, isOmx, isOmx));
+		if (isOmx) choose(port);
+	}
+	select.onchange = function() {
+		for (var port of ports.values()) {
+			if (port.id == select.value) choose(port);
+		}
+	};
+}
+
+// 8-bit data -> 7-in-8 packed, crc8 (poly 0x07, start 0xFF) of the unpacked bytes
+function crc8(crc, b) {
+	crc ^= b;
+	for (var i = 0; i < 8; i++) {
+		crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xFF : (crc << 1) & 0xFF;
+	}
+	return crc;
+}
+
+function message(cmd, seq, data) {
+	var msg = [0xF0, MANUFACTURER, DEVICE, cmd, seq];
+	var crc = 0xFF;
+	for (var i = 0; i < data.length; i += 7) {
+		var highAt = msg.length;
+		var high = 0;
+		msg.push(0);
+		for (var j = 0; j < 7 && i + j < data.length; j++) {
+			crc = crc8(crc, data[i + j]);
+			high |= (data[i + j] >> 7) << j;
+			msg.push(data[i + j] & 0x7F);
+		}
+		msg[highAt] = high;
+	}
+	msg.push(crc >> 7, crc & 0x7F, 0xF7);
+	return msg;
+}
+
+function isOurs(data) {
+	return data[0] == 0xF0 && data[1] == MANUFACTURER && data[2] == DEVICE;
+}
+
+function midiProcess(ev) {
+	var data = ev.data;
+	if (!isOurs(data)) return;
+
+	var cmd = data[3];
+	if (cmd == ACK) {
+		if (waitingAck) {
+			var resolve = waitingAck;
+			waitingAck = null;
+			resolve(data[6]);
+		}
+	} else if (dumpMessages) {
+		dumpMessages.push(Array.from(data));
+		if (cmd == END) {
+			saveDump(dumpMessages);
+			dumpMessages = null;
+		}
+	}
+}
+
+function requestDump() {
+	if (!midiOut) return log("No MIDI output selected");
+	dumpMessages = [];
+	midiOut.send(message(DUMP_REQUEST, 0, []));
+	log("Dump requested...");
+}
+
+function saveDump(messages) {
+	var bytes = [];
+	messages.forEach(function(m) { bytes = bytes.concat(m); });
+	var blob = new Blob([new Uint8Array(bytes)], {type: "application/octet-stream"});
+	var a = document.createElement("a");
+	a.href = URL.createObjectURL(blob);
+	a.download = "omx27-patterns.syx";
+	a.click();
+	log("Saved " + messages.length + " chunks, " + bytes.length + " bytes");
+}
+
+// split a .syx file back into messages
+function splitMessages(bytes) {
+	var messages = [], current = null;
+	for (var i = 0; i < bytes.length; i++) {
+		if (bytes[i] == 0xF0) current = [];
+		if (current) current.push(bytes[i]);
+		if (bytes[i] == 0xF7 && current) {
+			if (isOurs(current)) messages.push(current);
+			current = null;
+		}
+	}
+	return messages;
+}
+
+function sendChunk(msg) {
+	return new Promise(function(resolve) {
+		var timer = setTimeout(function() {
+			waitingAck = null;
+			resolve(-1);
+		}, 1000);
+		waitingAck = function(status) {
+			clearTimeout(timer);
+			resolve(status);
+		};
+		midiOut.send(msg);
+	});
+}
+
+async function loadFile(file) {
+	if (!midiOut || !midiIn) return log("Select the OMX-27 MIDI input and output first");
+	var bytes = new Uint8Array(await file.arrayBuffer());
+	var messages = splitMessages(bytes);
+	log("Loading " + file.name + ": " + messages.length + " chunks");
+
+	var start = performance.now();
+	for (var i = 0; i < messages.length; i++) {
+		var status;
+		for (var attempt = 0; attempt < 3; attempt++) {
+			status = await sendChunk(messages[i]);
+			if (status != 1) break;		// only bad crc is worth resending
+		}
+		if (status != 0) {
+			log("Chunk " + i + " failed: " + (status < 0 ? "no answer" : STATUS[status]));
+			return;
+		}
+	}
+	log("Loaded in " + Math.round(performance.now() - start) + " ms - the unit applies it between steps");
+}
@@ -0,0 +1,274 @@
+#include "cclanes.h"
+
+#include <string.h>
+
+namespace {
+	const int maxPointSize = 4;		// ticks up to 128 steps and a 7 bit change, 2 bytes each
+	const int holdGap = 6;			// a still pot longer than this gets a point where it starts moving again
+
+	int putVarint(uint8_t* out, unsigned v) {
+		int n = 0;
+		while (v >= 0x80) {
+			out[n++] = (v & 0x7F) | 0x80;
+			v >>= 7;
+		}
+		out[n++] = v;
+		return n;
+	}
+
+	int getVarint(const uint8_t* in, unsigned& v) {
+		int n = 0;
+		int shift = 0;
+		v = 0;
+		uint8_t b;
+		do {
+			b = in[n++];
+			v |= (unsigned)(b & 0x7F) << shift;
+			shift += 7;
+		} while (b & 0x80);
+		return n;
+	}
+}
+
+int CCLanes::Writer::put(int t, int v) {
+	int d = v - value;
+	int n = putVarint(out, t - tick);
+	n += putVarint(out + n, ((unsigned)d << 1) ^ (unsigned)(d >> 31));		// zigzag, small changes either way are one byte
+	out += n;
+	tick = t;
+	value = v;
+	points++;
+	return n;
+}
+
+int CCLanes::getPoint(const uint8_t* in, int& dTick, int& dValue) {
+	unsigned t, z;
+	int n = getVarint(in, t);
+	n += getVarint(in + n, z);
+	dTick = t;
+	dValue = (int)(z >> 1) ^ -(int)(z & 1);
+	return n;
+}
+
+CCLanes::CCLanes() {
+	used = 0;
+	count = 0;
+	patternMask = 0;
+	takePattern = -1;
+	takePot = -1;
+	pendingTick = -1;
+	doorOpen = false;
+	wasFull = false;
+}
+
+void CCLanes::record(int pattern, int pot, uint16_t tick, uint8_t value) {
+	if (takePattern >= 0 && (takePattern != pattern || takePot != pot || tick < pendingTick)) {
+		endTake();
+	}
+	if (takePattern < 0) {
+		if (find(pattern, pot) < 0 && count == maxLanes) {
+			wasFull = true;
+			return;
+		}
+		takePattern = pattern;
+		takePot = pot;
+		takeStart = used;
+		takeFirstTick = tick;
+		take = { pool + used, 0, 0, 0 };
+		doorOpen = false;
+	} else if (tick != pendingTick && !commit()) {
+		endTake();		// out of room, keep what there is
+		return;
+	}
+	pendingTick = tick;
+	pendingValue = value;
+}
+
+// the pending value goes into the take, false if there's no room for it
+bool CCLanes::commit() {
+	int tick = pendingTick;
+	int value = pendingValue;
+	pendingTick = -1;
+	if (tick < 0 || (take.points > 0 && value == take.value && !doorOpen)) {
+		return true;
+	}
+	if (used + 2 * maxPointSize > poolSize) {
+		wasFull = true;
+		return false;
+	}
+
+	if (take.points > 0 && tick - take.tick > holdGap) {
+		// the pot was still until now, so don't ramp across the gap
+		used += take.put(tick - 1, take.value);
+		doorOpen = false;
+	}
+	if (doorOpen) {
+		float slope = (float)(value - beforeLast.value) / (tick - beforeLast.tick);
+		if (slope >= slopeLow && slope <= slopeHigh) {
+			// still on the line, the last point moves along to this one
+			take = beforeLast;
+			used = take.out - pool;
+			used += take.put(tick, value);
+			float low = (float)(value - tolerance - beforeLast.value) / (tick - beforeLast.tick);
+			float high = (float)(value + tolerance - beforeLast.value) / (tick - beforeLast.tick);
+			if (low > slopeLow) slopeLow = low;
+			if (high < slopeHigh) slopeHigh = high;
+			return true;
+		}
+	}
+
+	beforeLast = take;
+	doorOpen = take.points > 0;
+	if (doorOpen) {
+		slopeLow = (float)(value - tolerance - take.value) / (tick - take.tick);
+		slopeHigh = (float)(value + tolerance - take.value) / (tick - take.tick);
+	}
+	used += take.put(tick, value);
+	return true;
+}
+
+void CCLanes::endTake() {
+	if (takePattern < 0) return;
+	commit();
+	int pattern = takePattern;
+	int pot = takePot;
+	takePattern = -1;
+	takePot = -1;
+	if (take.points == 0) return;
+
+	int old = find(pattern, pot);
+	int takeSize = used - takeStart;
+	int laneStart = takeStart;
+	int laneSize = takeSize;
+	int lanePoints = take.points;
+
+	if (old >= 0) {
+		// the old lane's points before and after the take, the take's in between,
+		// and the old lane's values either side of it so it keeps its shape there
+		int edgeBefore = takeFirstTick > 0 ? valueAt(old, takeFirstTick - 1) : -1;
+		int edgeAfter = valueAt(old, take.tick + 1);
+		Writer merged = { pool + used, 0, 0, 0 };
+		bool fits = true;
+		for (int pass = 0; pass < 3 && fits; ++pass) {
+			if (merged.out - pool + maxPointSize > poolSize) {
+				fits = false;
+			} else if (pass == 1 && edgeBefore >= 0 && (merged.points == 0 || merged.tick < takeFirstTick - 1)) {
+				merged.put(takeFirstTick - 1, edgeBefore);
+			} else if (pass == 2) {
+				merged.put(take.tick + 1, edgeAfter);
+			}
+			const Lane& l = laneList[old];
+			const uint8_t* in = pass == 1 ? pool + takeStart : pool + l.start;
+			int size = pass == 1 ? takeSize : l.size;
+			int tick = 0;
+			int value = 0;
+			for (int at = 0; at < size && fits; ) {
+				int dTick, dValue;
+				at += getPoint(in + at, dTick, dValue);
+				tick += dTick;
+				value += dValue;
+				bool keep = pass == 1 || (pass == 0 ? tick < takeFirstTick - 1 : tick > take.tick + 1);
+				if (!keep) continue;
+				if (merged.out - pool + maxPointSize > poolSize) {
+					fits = false;
+				} else {
+					merged.put(tick, value);
+				}
+			}
+		}
+		if (fits) {
+			laneStart = used;
+			laneSize = merged.out - (pool + used);
+			lanePoints = merged.points;
+			used += laneSize;
+			remove(takeStart, takeSize);
+			laneStart -= takeSize;
+		} else {
+			wasFull = true;		// keep just the take
+		}
+		const Lane& l = laneList[old];
+		if (laneStart > l.start) laneStart -= l.size;
+		remove(l.start, l.size);
+	} else {
+		old = count++;
+	}
+
+	laneList[old] = { (int8_t)pattern, (uint8_t)pot, (uint16_t)laneStart, (uint16_t)laneSize, (uint16_t)lanePoints, 0, 0, 0, false };
+	updateMask();
+}
+
+void CCLanes::clear(int pattern) {
+	if (takePattern == pattern) {
+		used = takeStart;
+		takePattern = -1;
+		takePot = -1;
+	}
+	for (int i = count - 1; i >= 0; --i) {
+		if (laneList[i].pattern == pattern) dropLane(i);
+	}
+	wasFull = false;
+}
+
+int CCLanes::find(int pattern, int pot) {
+	for (int i = 0; i < count; ++i) {
+		if (laneList[i].pattern == pattern && laneList[i].pot == pot) return i;
+	}
+	return -1;
+}
+
+uint8_t CCLanes::valueAt(int lane, uint16_t tick) {
+	Lane& l = laneList[lane];
+	if (l.cursorStarted && tick < l.cursorTick) {
+		// came round again, back to the first point
+		l.cursor = 0;
+		l.cursorTick = 0;
+		l.cursorValue = 0;
+		l.cursorStarted = false;
+	}
+
+	const uint8_t* in = pool + l.start;
+	while (l.cursor < l.size) {
+		int dTick, dValue;
+		int n = getPoint(in + l.cursor, dTick, dValue);
+		int nextTick = l.cursorTick + dTick;
+		int nextValue = l.cursorValue + dValue;
+		if (nextTick > tick) {
+			if (!l.cursorStarted) return nextValue;		// before the first point, hold it
+			return l.cursorValue + (nextValue - l.cursorValue) * (tick - l.cursorTick) / (nextTick - l.cursorTick);
+		}
+		l.cursor += n;
+		l.cursorTick = nextTick;
+		l.cursorValue = nextValue;
+		l.cursorStarted = true;
+	}
+	return l.cursorValue;		// after the last point, hold it
+}
+
+// close the gap a lane or take leaves in the pool
+void CCLanes::remove(int start, int size) {
+	memmove(pool + start, pool + start + size, used - (start + size));
+	used -= size;
+	for (int i = 0; i < count; ++i) {
+		if (laneList[i].start > start) laneList[i].start -= size;
+	}
+	if (takePattern >= 0 && takeStart > start) {
+		takeStart -= size;
+		beforeLast.out -= size;
+		take.out -= size;
+	}
+}
+
+void CCLanes::dropLane(int lane) {
+	remove(laneList[lane].start, laneList[lane].size);
+	laneList[lane] = laneList[--count];
+	updateMask();
+}
+
+void CCLanes::updateMask() {
+	patternMask = 0;
+	for (int i = 0; i < count; ++i) {
+		patternMask |= 1U << laneList[i].pattern;
+	}
+}
+
+CCLanes ccLanes;
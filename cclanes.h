@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "dimensions.h"
+
+// CC automation lanes. While recording, pot moves are stored as points on the
+// pattern's own tick grid, ticksPerStep to a step (the MIDI clock's PPQ at
+// 1x), so a lane follows the pattern's rate, length and the tempo. On
+// playback the value between two points is interpolated.
+//
+// One lane per pattern and pot, all lanes share one fixed byte pool. A lane is
+// its points in tick order, each
+//   [varint ticks since the last point] [zigzag varint change in value]
+// starting from tick 0 / value 0, so a slow sweep costs 2 bytes a point.
+// Points a straight line through their neighbours would land within
+// tolerance of are left out, so a steady sweep is just its two ends.
+//
+// A take - the points of one pass over one pot - is written to the end of the
+// pool as it comes in and merged into the pot's lane when it ends, replacing
+// the points in the ticks it covered. Only one pot records at a time, touching
+// another one or the pattern coming round again ends the take.
+
+class CCLanes {
+	public:
+		static const int poolSize = 1536;		// bytes for all lanes
+		static const int maxLanes = 16;
+		static const int ticksPerStep = 24;
+		static const int tolerance = 1;			// CC values a point may be off the line that replaces it
+
+		CCLanes();
+
+		// recording
+		void record(int pattern, int pot, uint16_t tick, uint8_t value);
+		void endTake();
+		bool recording(int pattern, int pot) { return takePattern == pattern && takePot == pot; }
+		void clear(int pattern);				// a pattern's lanes, and its take
+		bool full() { return wasFull; }			// a take was cut short for want of room since the last clear
+
+		// playback
+		bool hasLanes(int pattern) { return patternMask & (1U << pattern); }
+		int find(int pattern, int pot);			// lane, -1 if none
+		uint8_t valueAt(int lane, uint16_t tick);	// cheapest called with ticks going forward
+
+		// what it costs
+		int lanes() { return count; }
+		int laneBytes(int lane) { return laneList[lane].size; }
+		int lanePoints(int lane) { return laneList[lane].points; }
+		int poolUsed() { return used; }
+
+	private:
+		struct Lane {
+			int8_t pattern;
+			uint8_t pot;
+			uint16_t start;			// in pool
+			uint16_t size;
+			uint16_t points;
+
+			// playback position, valueAt() picks up from here
+			uint16_t cursor;		// bytes into the lane of the next point
+			uint16_t cursorTick;	// the point before it
+			uint8_t cursorValue;
+			bool cursorStarted;		// past the first point
+		};
+
+		// reads and writes points
+		struct Writer {
+			uint8_t* out;
+			int tick;
+			int value;
+			int points;
+			int put(int tick, int value);		// bytes written
+		};
+
+		uint8_t pool[poolSize];
+		int used;
+		Lane laneList[maxLanes];
+		int count;
+		uint16_t patternMask;
+
+		int takePattern;		// -1 when not recording
+		int takePot;
+		int takeStart;
+		int takeFirstTick;
+		Writer take;
+		int pendingTick;		// the last value on the newest tick, written once the tick's gone by
+		int pendingValue;
+
+		// the take's last point can move along to a later one while every
+		// value it passed stays within tolerance of the line to it
+		Writer beforeLast;		// the take without its last point
+		bool doorOpen;
+		float slopeLow;			// slopes from the point before the last that keep within tolerance
+		float slopeHigh;
+		bool wasFull;
+
+		bool commit();
+		void remove(int start, int size);
+		void dropLane(int lane);
+		void updateMask();
+		static int getPoint(const uint8_t* in, int& dTick, int& dValue);
+};
+
+extern CCLanes ccLanes;
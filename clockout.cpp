@@ -0,0 +1,102 @@
+#include "clockout.h"
+#include "MM.h"
+#include "profiler.h"
+
+ClockOut::ClockOut() {
+	on = false;
+	next = 0;
+	period = 0;
+	newPeriod = 0;
+	count = 0;
+	had = 0;
+}
+
+uint32_t ClockOut::start(uint32_t p, uint32_t wait) {
+	stop();
+	MM::setHandleRealTimeSent(onSent);
+	__disable_irq();
+	uint32_t now = micros();
+	if (wait) {
+		// the first clock from the timer too
+		timer.begin(onTimer, (unsigned long)wait);
+		timer.update((unsigned long)p);
+		next = now + wait;
+		count = 0;
+	} else {
+		timer.begin(onTimer, (unsigned long)p);
+		next = now + p;
+		ticks[0] = { now, now };
+		count = 1;
+	}
+	period = p;
+	newPeriod = 0;
+	had = 0;
+	on = true;
+	__enable_irq();
+	if (wait) return now + wait;
+	MM::sendRealTime(0xF8);
+	return now;
+}
+
+void ClockOut::stop() {
+	timer.end();
+	on = false;
+}
+
+uint32_t ClockOut::change(uint32_t p) {
+	__disable_irq();
+	uint32_t from = next + period;
+	newPeriod = p;
+	__enable_irq();
+	return from;
+}
+
+bool ClockOut::tick(Tick& t) {
+	__disable_irq();
+	uint32_t behind = count - had;
+	if (behind == 0) {
+		__enable_irq();
+		return false;
+	}
+	if (behind > history) {
+		// stalled for longer than the history holds, only an estimate of this one
+		t = ticks[(count - history) % history];
+		t.due -= (behind - history) * period;
+		t.sent = t.due;
+	} else {
+		t = ticks[had % history];
+	}
+	had++;
+	__enable_irq();
+	return true;
+}
+
+void ClockOut::interrupt() {
+	uint32_t due = next;
+	next = due + period;		// the timer's just loaded it
+	if (newPeriod) {
+		period = newPeriod;
+		newPeriod = 0;
+		timer.update((unsigned long)period);
+	}
+	ticks[count % history] = { due, due };
+	count++;
+	MM::sendRealTime(0xF8);
+}
+
+void ClockOut::onTimer() {
+	clockOut.interrupt();
+}
+
+// from MM, straight away or once the loop's message it waited for has gone
+void ClockOut::onSent(uint8_t status, uint32_t micros) {
+	if (status != 0xF8 || clockOut.count == 0) return;
+	Tick& t = clockOut.ticks[(clockOut.count - 1) % history];
+	t.sent = micros;
+#if PROFILE_LOOP
+	int32_t late = (int32_t)(micros - t.due);
+	loopProfiler.record(PROF_CLOCKOUT, (late > 0 ? late : 0) * (F_CPU / 1000000));
+#endif
+}
+
+ClockOut clockOut;
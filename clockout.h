@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// MIDI clock out from a hardware timer. The timer's interrupt sends each 24
+// PPQ clock at its deadline through MM's real-time lane, so a slow pass
+// through loop() can't hold clocks back and then send them in a burst. The
+// loop catches up on the ticks that went by with tick(), that's where it
+// counts bars and steps tempo ramps.
+//
+// The timer can't cut short the period it's counting down, a new one is
+// loaded at the next tick and so takes over from the tick after it. That's
+// the same time whichever side of the next tick the interrupt gets to it, so
+// change() can say when it'll be.
+//
+// How late each clock went out is recorded as the profiler's CLKOUT section.
+
+class ClockOut {
+	public:
+		struct Tick {
+			uint32_t due;
+			uint32_t sent;		// micros() as the clock went out
+		};
+
+		ClockOut();
+		// sends the first clock, or has the timer send it wait us from now,
+		// returns when it's due
+		uint32_t start(uint32_t period, uint32_t wait = 0);
+		void stop();
+		bool running() { return on; }
+
+		// the period from the returned time on, a clock tick after the next
+		uint32_t change(uint32_t period);
+
+		// the oldest tick the loop hasn't had yet, false once it's had them all
+		bool tick(Tick& t);
+
+	private:
+		static const int history = 8;		// ticks the loop can fall behind and still have their times
+
+		IntervalTimer timer;
+		bool on;
+		volatile uint32_t next;			// the tick the timer is counting down to
+		volatile uint32_t period;		// loaded at the next tick
+		volatile uint32_t newPeriod;	// to load at the next tick, 0 = none
+		volatile uint32_t count;		// ticks sent
+		uint32_t had;					// ticks the loop has had
+		Tick ticks[history];
+
+		void interrupt();
+		static void onTimer();
+		static void onSent(uint8_t status, uint32_t micros);
+};
+
+extern ClockOut clockOut;
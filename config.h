@@ -13,15 +13,20 @@ enum OMXMode
 const OMXMode DEFAULT_MODE = MODE_MIDI;
 
 // Increment this when data layout in EEPROM changes. May need to write version upgrade readers when this changes.
-const uint8_t EEPROM_VERSION = 8;
+const uint8_t EEPROM_VERSION = 9;
 
 #define EEPROM_HEADER_ADDRESS	          0
 #define EEPROM_HEADER_SIZE		     32
+#define EEPROM_UPGRADE_ADDRESS	     16      // version upgrade progress, inside the header (see upgradeEEPROM())
 #define EEPROM_PATTERN_ADDRESS 	     32
-#define EEPROM_PATTERN_SIZE		     1024      // 8 * 16 * sizeof(StepNote))
-#define EEPROM_PATTERN_SETTINGS_ADDRESS 1056
-#define EEPROM_PATTERN_SETTINGS_SIZE      56      // 8 * sizeof(PatternSettings)
-// next address 1104 (was 1096 before clock)
+#define EEPROM_PATTERN_SIZE		     (NUM_PATTERNS * NUM_STEPS * sizeof(StepNote))
+#define EEPROM_PATTERN_SETTINGS_ADDRESS (EEPROM_PATTERN_ADDRESS + EEPROM_PATTERN_SIZE)
+#define EEPROM_PATTERN_SETTINGS_SIZE      (NUM_PATTERNS * sizeof(PatternSettings))
+#define EEPROM_JOURNAL_ADDRESS         (EEPROM_PATTERN_SETTINGS_ADDRESS + EEPROM_PATTERN_SETTINGS_SIZE)	// pattern edit journal (see journal.h), runs to the end of EEPROM
+
+// Pattern banks - whole sets of patterns stored as files in program flash (see banks.h)
+#define NUM_BANKS                         (PATTERNS_IN_EEPROM ? 16 : 3)	// bigger builds' banks are 8-12K each
+#define BANK_FLASH_SIZE          (48 * 1024)
 
 // DEFINE CC NUMBERS FOR POTS // CCS mapped to Organelle Defaults
 const int CC1 = 1;
@@ -37,6 +42,13 @@ const int CC_OM2 = 14; // Mother mode - enc turn
 
 const int LED_BRIGHTNESS = 50;
 
+// Build with BOOT_TIMING 1 to print over Serial how long the unit took to
+// get MIDI going after power on (see reportBootTiming()). Left at 0 it isn't
+// compiled in.
+#ifndef BOOT_TIMING
+#define BOOT_TIMING 0
+#endif
+
 // DONT CHANGE ANYTHING BELOW HERE
 
 const int LED_PIN  = 14;
@@ -54,6 +66,7 @@ const int LED_COUNT = 27;
 
 #define NUM_CC_POTS 5
 int pots[NUM_CC_POTS] = {CC1,CC2,CC3,CC4,CC5};			// the MIDI CC (continuous controller) for each analog input
+int lfoTicks[4] = {6,6,6,6};			// PPQ ticks between superstep values on the first 4 pots' CCs - 6 is 4 a step, 1 every tick
 
 const int gridh = 32;
 const int gridw = 128;
@@ -87,6 +100,8 @@ enum Dialogs{
      REV,
      SAVED,
      SAVE,
+     CCREC_ON,
+     CCREC_OFF,
 
      NUM_DIALOGS
 };
@@ -102,20 +117,29 @@ InfoDialogs infoDialog[NUM_DIALOGS] = {
   {"FWD >>", false},
   {"<< REV", false},
   {"SAVED", false},
-  {"SAVE?", false}
+  {"SAVE?", false},
+  {"CC REC", false},
+  {"REC OFF", false}
 };
 
 enum SubModes
 {
 	SUBMODE_MIDI = 0,
+	SUBMODE_ARP,
+	SUBMODE_ECHO,
 	SUBMODE_SEQ,
 	SUBMODE_SEQ2,
+	SUBMODE_SEQ3,
+	SUBMODE_SEQ4,
 	SUBMODE_NOTESEL,
 	SUBMODE_NOTESEL2,
 	SUBMODE_NOTESEL3,
+	SUBMODE_NOTESEL4,
+	SUBMODE_NOTESEL5,
 	SUBMODE_PATTPARAMS,
 	SUBMODE_PATTPARAMS2,
 	SUBMODE_PATTPARAMS3,
+	SUBMODE_PATTPARAMS4,
 	SUBMODE_STEPREC,
 
 	SUBMODES_COUNT
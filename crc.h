@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+// CRC-8 (poly 0x07), one byte at a time. Start from 0xFF so an all-zero
+// record never checks out.
+inline uint8_t crc8(uint8_t crc, uint8_t data) {
+	crc ^= data;
+	for (int i = 0; i < 8; ++i)
+		crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+	return crc;
+}
+
+inline uint8_t crc8(uint8_t crc, const uint8_t* data, int len) {
+	for (int i = 0; i < len; ++i)
+		crc = crc8(crc, data[i]);
+	return crc;
+}
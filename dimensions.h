@@ -0,0 +1,41 @@
+#pragma once
+
+// Pattern dimensions. The default build is 8 patterns of up to 16 steps; build
+// with e.g. -DNUM_PATTERNS=16 -DNUM_STEPS=64 or -DNUM_STEPS=128 for more tracks
+// or longer patterns. Everything sized by them - pattern storage, the step
+// engine, bank files and SysEx dumps - follows, and the PatternSettings fields
+// that hold a step number get just enough bits for NUM_STEPS.
+//
+// The 16 step keys show one page of a longer pattern at a time, hold F2 and
+// press a step key to pick the page. The 8 pattern keys select from the group
+// of 8 the playing pattern is in, the encoder on PTN reaches them all.
+//
+// tools/host/omx_bench prints the RAM / EEPROM / bank flash each build needs.
+
+#ifndef NUM_PATTERNS
+#define NUM_PATTERNS 8
+#endif
+
+#ifndef NUM_STEPS
+#define NUM_STEPS 16
+#endif
+
+#define NUM_PATTERN_KEYS 8
+#define NUM_STEP_KEYS 16
+#define NUM_STEP_PAGES (NUM_STEPS / NUM_STEP_KEYS)
+
+// Only the default 8 x 16 fits the Teensy's 2K EEPROM next to the journal.
+// Bigger builds keep the header in EEPROM and the patterns in the bank files.
+#define PATTERNS_IN_EEPROM (NUM_PATTERNS * NUM_STEPS <= 8 * 16)
+
+static_assert(NUM_PATTERNS % NUM_PATTERN_KEYS == 0 && NUM_PATTERNS <= 16,
+	"NUM_PATTERNS is 8 or 16 - one MIDI channel and one trace nibble each");
+static_assert(NUM_STEPS % NUM_STEP_KEYS == 0 && NUM_STEPS <= 128,
+	"NUM_STEPS is a whole number of 16 step pages, at most 128 (bank and SysEx headers hold it in a byte)");
+
+// bits needed to store 0 .. n-1
+constexpr int bitsFor(unsigned n) {
+	return n <= 1 ? 0 : 1 + bitsFor((n + 1) / 2);
+}
+
+#define STEP_BITS bitsFor(NUM_STEPS)
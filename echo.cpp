@@ -0,0 +1,122 @@
+#include "echo.h"
+
+#include <Arduino.h>
+#include "MM.h"
+#include "trace.h"
+
+Echo::Echo() {
+	for (int s = 0; s < sources; ++s) {
+		settings[s] = { 0, 60, 3, 0 };		// off, 60%, 1/8
+	}
+	for (int i = 0; i < poolSize; ++i) {
+		pool[i].state = FREE;
+	}
+	inUse = 0;
+	peakUse = 0;
+	steals = 0;
+}
+
+void Echo::add(int source, int note, int velocity, int channel, uint32_t on, uint32_t length, uint32_t delay) {
+	const Settings& s = settings[source];
+	if (s.repeats == 0 || delay == 0) return;
+
+	Voice first;
+	first.note = note;
+	first.velocity = velocity;
+	first.channel = channel - 1;
+	first.source = source;
+	first.left = s.repeats > maxRepeats ? maxRepeats : s.repeats;
+	first.feedback = s.feedback;
+	first.shift = s.shift;
+	first.on = on;
+	first.delay = delay;
+	first.gate = length < delay ? ((uint64_t)length << 16) / delay : 0xFFFF;
+	if (!nextRepeat(first)) return;		// too quiet or out of range already
+
+	Voice* v = take();
+	*v = first;
+	v->state = WAITING;
+}
+
+// moves v on to its next repeat, false if there isn't one
+bool Echo::nextRepeat(Voice& v) {
+	if (v.left == 0) return false;
+	int velocity = v.velocity * v.feedback / 100;
+	int note = v.note + v.shift;
+	if (velocity < 1 || note < 0 || note > 127) return false;
+	v.velocity = velocity;
+	v.note = note;
+	v.on += v.delay;
+	v.left--;
+	return true;
+}
+
+Echo::Voice* Echo::take() {
+	for (int i = 0; i < poolSize; ++i) {
+		if (pool[i].state == FREE) {
+			inUse++;
+			if (inUse > peakUse) peakUse = inUse;
+			return &pool[i];
+		}
+	}
+
+	// full - the quietest waiting repeat, else the sounding one that ends first
+	Voice* victim = nullptr;
+	for (int i = 0; i < poolSize; ++i) {
+		Voice& v = pool[i];
+		if (v.state == WAITING && (!victim || v.velocity < victim->velocity)) victim = &v;
+	}
+	if (!victim) {
+		for (int i = 0; i < poolSize; ++i) {
+			Voice& v = pool[i];
+			if (!victim || (int32_t)(off(v) - off(*victim)) < 0) victim = &v;
+		}
+		MM::sendNoteOff(victim->note, 0, victim->channel + 1);
+	}
+	steals++;
+	return victim;
+}
+
+void Echo::play(uint32_t now) {
+	if (inUse == 0) return;
+	for (int i = 0; i < poolSize; ++i) {
+		Voice& v = pool[i];
+		if (v.state == WAITING && (int32_t)(now - v.on) >= 0) {
+			MM::sendNoteOn(v.note, v.velocity, v.channel + 1);
+			TRACE_EVENT(TRACE_NOTE_ON, v.on, micros(), v.source == midiSource ? TRACE_NO_PATTERN : v.source, v.note, v.channel + 1);
+			v.state = SOUNDING;
+		}
+		if (v.state == SOUNDING && (int32_t)(now - off(v)) >= 0) {
+			MM::sendNoteOff(v.note, 0, v.channel + 1);
+			TRACE_EVENT(TRACE_NOTE_OFF, off(v), micros(), v.source == midiSource ? TRACE_NO_PATTERN : v.source, v.note, v.channel + 1);
+			if (nextRepeat(v)) {
+				v.state = WAITING;		// picked up on the next pass if it's due already
+			} else {
+				v.state = FREE;
+				inUse--;
+			}
+		}
+	}
+}
+
+void Echo::allOff() {
+	for (int i = 0; i < poolSize; ++i) {
+		Voice& v = pool[i];
+		if (v.state == SOUNDING) {
+			MM::sendNoteOff(v.note, 0, v.channel + 1);
+		}
+		v.state = FREE;
+	}
+	inUse = 0;
+}
+
+void Echo::retime(const TempoChange& change) {
+	for (int i = 0; i < poolSize; ++i) {
+		Voice& v = pool[i];
+		if (v.state == FREE) continue;
+		v.on = change.map(v.on);
+		v.delay = (uint64_t)v.delay * change.newTick / change.oldTick;
+	}
+}
+
+Echo echo;
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "dimensions.h"
+#include "tempo.h"
+
+// MIDI delay: each note a pattern or MIDI mode plays comes back a number of
+// times, a tempo-synced time apart, each repeat quieter by the feedback and
+// optionally shifted in pitch.
+//
+// A note's repeats are one voice from a fixed pool, which plays a repeat,
+// turns it off and sets itself up for the next, so a voice lives as long as
+// its echo does. A repeat is never longer than the echo time, so one voice
+// never overlaps itself. With the pool full a new note takes the voice whose
+// next repeat would be the quietest; failing that, the sounding one that ends
+// first, turned off early.
+//
+// The pool is a fixed size rather than one per pattern, so the bigger builds
+// (see dimensions.h) don't pay for it in RAM: it holds the heaviest echo on
+// poolPatterns patterns, and past that voices are stolen.
+
+class Echo {
+	public:
+		static const int sources = NUM_PATTERNS + 1;		// the patterns, then MIDI mode
+		static const int midiSource = NUM_PATTERNS;
+		static const int maxRepeats = 8;
+		// patterns playing 16ths with the most repeats an 1/8 apart, the default
+		// time: a voice lasts the repeats and the last one's length, 2 * 9 steps
+		static const int poolPatterns = 8;
+		static const int poolSize = 2 * (maxRepeats + 1) * poolPatterns;		// 2304 bytes
+
+		struct Settings {
+			uint8_t repeats;		// 0 = off
+			uint8_t feedback;		// velocity each repeat keeps, percent
+			uint8_t time;			// index into multValues
+			int8_t shift;			// semitones each repeat
+		};
+		Settings settings[sources];
+
+		Echo();
+
+		// a note the source played, its repeats every delay after on
+		void add(int source, int note, int velocity, int channel, uint32_t on, uint32_t length, uint32_t delay);
+		void play(uint32_t now);
+		void allOff();				// turns off sounding repeats, drops the rest
+		void retime(const TempoChange& change);		// the repeats to come follow a tempo change
+
+		int used() { return inUse; }
+		int peak() { return peakUse; }
+		long stolen() { return steals; }
+
+	private:
+		enum State : uint8_t {
+			FREE = 0,
+			WAITING,
+			SOUNDING
+		};
+
+		struct Voice {				// 16 bytes
+			uint32_t on;
+			uint32_t delay;
+			uint16_t gate;			// length, in 65536ths of delay
+			uint8_t note;
+			uint8_t velocity;
+			uint8_t feedback;
+			int8_t shift;
+			uint8_t left : 4;		// repeats still to start, this one included
+			uint8_t channel : 4;	// 0 - 15, maps to 1 - 16
+			State state : 2;
+			uint8_t source : 6;		// for the timing trace
+		};
+		static_assert(sources <= 64, "Voice::source holds the source");
+
+		Voice pool[poolSize];
+		int inUse;
+		int peakUse;
+		long steals;
+
+		Voice* take();
+		bool nextRepeat(Voice& v);
+		static uint32_t off(const Voice& v) { return v.on + (uint32_t)((uint64_t)v.delay * v.gate >> 16); }
+};
+
+extern Echo echo;
@@ -0,0 +1,26 @@
+#include "groove.h"
+
+// accents on the beats, off-beat 16ths softer
+#define SWING_ACCENTS { 8, -6, 0, -6, 8, -6, 0, -6, 8, -6, 0, -6, 8, -6, 0, -6 }
+
+const Groove Grooves::table[count] = {
+	{ "OFF",  { 0 }, { 0 } },
+	{ "54%",  { 0, 2, 0, 2, 0, 2, 0, 2, 0, 2, 0, 2, 0, 2, 0, 2 }, SWING_ACCENTS },
+	{ "58%",  { 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4 }, SWING_ACCENTS },
+	{ "62%",  { 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6 }, SWING_ACCENTS },
+	{ "66%",  { 0, 8, 0, 8, 0, 8, 0, 8, 0, 8, 0, 8, 0, 8, 0, 8 }, SWING_ACCENTS },
+	{ "71%",  { 0, 10, 0, 10, 0, 10, 0, 10, 0, 10, 0, 10, 0, 10, 0, 10 }, SWING_ACCENTS },
+	{ "PUSH", { 0, 0, -3, 0, 0, 0, -3, 0, 0, 0, -3, 0, 0, 0, -3, -1 },
+		{ 6, -8, 10, -8, 0, -8, 10, -8, 6, -8, 10, -8, 0, -8, 10, -4 } },
+	{ "LAZY", { 0, 1, 0, 2, 3, 1, 0, 2, 0, 1, 0, 2, 3, 1, 2, 2 },
+		{ 4, -10, -2, -8, 10, -10, -2, -8, 4, -10, -2, -8, 10, -10, -4, -6 } },
+};
+
+int Grooves::velocity(int groove, int step, int velocity) {
+	int change = table[groove].velocity[step % length];
+	if (change == 0 || velocity == 0) {
+		return velocity;		// a step at 0 stays silent
+	}
+	int v = velocity + change;
+	return v < 1 ? 1 : (v > 127 ? 127 : v);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+// Grooves: a 16 step table of timing offsets and velocity changes laid over a
+// pattern, step 16 + n playing as step n. Offsets are in ticks of the
+// pattern's own grid, 24 to a step (the MIDI clock's PPQ at 1x), so a groove
+// follows the pattern's rate and the tempo. A step's own nudge (see StepNote)
+// adds to it.
+//
+// The swing grooves delay every other 16th by an MPC style swing amount: 54%
+// of an 8th puts the off-beat 16th 2 ticks late, 71% 10. The feel grooves
+// push the off-beat 8ths early or drag the back beats late.
+//
+// updatePlanTiming() works the offsets out in micros for each step whenever
+// the tempo, rate, swing, groove or a nudge changes, so playing a step only
+// adds its offset to the step's time. A step can go early by half a step at
+// most, the sequencer takes it that much ahead of time (see stepLead()).
+
+struct Groove {
+	const char* name;
+	int8_t offset[16];			// ticks, - is early
+	int8_t velocity[16];		// added to the step's velocity
+};
+
+class Grooves {
+	public:
+		static const int count = 8;
+		static const int length = 16;
+		static const int maxNudge = 12;		// a step's own offset, ticks either way
+		static const Groove table[count];
+
+		// the step's velocity with the groove's accent on it, 1 - 127
+		static int velocity(int groove, int step, int velocity);
+};
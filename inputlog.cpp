@@ -0,0 +1,81 @@
+#include "inputlog.h"
+
+#if INPUT_RECORD
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+InputLog::InputLog() {
+	head = 0;
+	tail = 0;
+	lost = 0;
+	loopMicros = 0;
+	streaming = false;
+	eepromSent = 0;
+}
+
+void InputLog::begin() {
+	for (int i = 0; i < eepromSize; ++i) {
+		bootEEPROM[i] = EEPROM.read(i);
+	}
+	beginLoop(micros());
+	record(INPUT_BOOT, 0, 0, 0);
+}
+
+void InputLog::toggleStreaming() {
+	// unlike the timing trace nothing is skipped - a capture has to start from
+	// boot, so stopping only pauses the stream
+	streaming = !streaming;
+}
+
+void InputLog::stream() {
+	if (!streaming || !Serial) return;
+
+	uint8_t frame[INPUT_FRAME_HEADER + INPUT_EEPROM_CHUNK];
+	frame[0] = 'O';
+	frame[1] = 'M';
+	frame[2] = 'X';
+	frame[4] = INPUT_FORMAT_VERSION;
+
+	while (eepromSent < eepromSize) {
+		if (Serial.availableForWrite() < INPUT_FRAME_HEADER + INPUT_EEPROM_CHUNK) return;
+		frame[3] = 'E';
+		frame[5] = INPUT_EEPROM_CHUNK;
+		frame[6] = eepromSent & 0xFF;
+		frame[7] = eepromSent >> 8;
+		memcpy(frame + INPUT_FRAME_HEADER, bootEEPROM + eepromSent, INPUT_EEPROM_CHUNK);
+		Serial.write(frame, INPUT_FRAME_HEADER + INPUT_EEPROM_CHUNK);
+		eepromSent += INPUT_EEPROM_CHUNK;
+	}
+
+	while (head != tail) {
+		int count = head - tail;
+		if (count > maxFrameRecords) count = maxFrameRecords;
+		int frameSize = INPUT_FRAME_HEADER + count * INPUT_RECORD_SIZE;
+		if (Serial.availableForWrite() < frameSize) return;		// never block the loop
+
+		frame[3] = 'I';
+		frame[5] = count;
+		frame[6] = lost & 0xFF;
+		frame[7] = lost >> 8;
+
+		uint8_t* p = frame + INPUT_FRAME_HEADER;
+		for (int i = 0; i < count; ++i) {
+			const Record& r = ring[tail++ % ringSize];
+			p[0] = r.micros;
+			p[1] = r.micros >> 8;
+			p[2] = r.micros >> 16;
+			p[3] = r.micros >> 24;
+			p[4] = r.event;
+			p[5] = r.a;
+			p[6] = r.b;
+			p[7] = r.c;
+			p += INPUT_RECORD_SIZE;
+		}
+		Serial.write(frame, frameSize);
+	}
+}
+
+InputLog inputLog;
+
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+
+// Input recorder: logs every input the sketch acts on - keypad events,
+// encoder turns, encoder button states, pot changes, incoming MIDI and the
+// random seed - stamped with micros() at the top of the loop() pass that read
+// them. Send 'i' over Serial to stream the log out, starting with the EEPROM as
+// it was at power on and then every event since boot. tools/host/omx_replay
+// plays a capture back on the host simulator, pass for pass, to reproduce what
+// the unit did.
+//
+// Build with INPUT_RECORD 1 to turn it on (costs 2K for the ring and 2K for the
+// EEPROM copy). Left at 0 the INPUT_* macros expand to nothing.
+//
+// Stream format (little endian), a frame at a time:
+//   'O' 'M' 'X' 'E'  version  length (1)  EEPROM offset (2)  then length bytes
+//   'O' 'M' 'X' 'I'  version  record count (1)  lost records (2)
+//   then count records of 8 bytes:
+//   loop micros (4)  event (1)  a (1)  b (1)  c (1)
+// If the ring ever fills up (not streaming, or the host not reading fast enough)
+// recording stops there and lost counts what was dropped since - a replay is
+// exact up to the last record sent.
+
+#ifndef INPUT_RECORD
+#define INPUT_RECORD 0
+#endif
+
+enum InputEvent {
+	INPUT_BOOT = 1,		// setup() started
+	INPUT_SEED,			// b c = value passed to randomSeed()
+	INPUT_KEY,			// a = key, b = KEY_JUST_PRESSED / KEY_JUST_RELEASED
+	INPUT_ENCODER,		// a = direction (signed), b = speedup
+	INPUT_BUTTON,		// a = Button::State
+	INPUT_POT,			// a = pot, b c = smoothed 13 bit reading
+	INPUT_MIDI			// a b c = status, data 1, data 2 (not SysEx)
+};
+
+const uint8_t INPUT_FORMAT_VERSION = 1;
+const int INPUT_FRAME_HEADER = 8;
+const int INPUT_RECORD_SIZE = 8;
+const int INPUT_EEPROM_CHUNK = 128;
+
+#if INPUT_RECORD
+
+class InputLog {
+	public:
+		InputLog();
+		void begin();			// call first thing in setup(), copies the EEPROM
+
+		void beginLoop(uint32_t micros) { loopMicros = micros; }
+		void record(uint8_t event, uint8_t a, uint8_t b, uint8_t c) {
+			if (lost || head - tail == ringSize) {
+				if (lost < UINT16_MAX) lost++;
+				return;
+			}
+			Record& r = ring[head % ringSize];
+			r.micros = loopMicros;
+			r.event = event;
+			r.a = a;
+			r.b = b;
+			r.c = c;
+			head++;
+		}
+
+		void toggleStreaming();
+		void stream();			// call from loop(), sends what fits in the USB serial buffer
+
+	private:
+		static const uint32_t ringSize = 256;		// power of two
+		static const int maxFrameRecords = 16;
+		static const int eepromSize = 2048;
+
+		struct Record {
+			uint32_t micros;
+			uint8_t event;
+			uint8_t a;
+			uint8_t b;
+			uint8_t c;
+		};
+		Record ring[ringSize];
+		uint32_t head;
+		uint32_t tail;
+		uint16_t lost;			// events dropped after the ring filled up
+		uint32_t loopMicros;
+		bool streaming;
+		int eepromSent;			// bytes of the boot image already streamed
+		uint8_t bootEEPROM[eepromSize];
+};
+
+extern InputLog inputLog;
+
+#define INPUT_LOOP(micros)				inputLog.beginLoop(micros)
+#define INPUT_EVENT(event, a, b, c)		inputLog.record(event, a, b, c)
+
+#else
+
+#define INPUT_LOOP(micros)
+#define INPUT_EVENT(event, a, b, c)
+
+#endif
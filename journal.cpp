@@ -0,0 +1,198 @@
+#include "journal.h"
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "crc.h"
+
+PatternJournal::PatternJournal() {
+	journalStart = 0;
+	journalEnd = 0;
+	head = 0;
+	gen = 0;
+	compactPos = -1;
+	lastReplayMicros = 0;
+	for (int i = 0; i < maxItems; ++i)
+		latest[i] = 0;
+}
+
+void PatternJournal::begin(Region steps, Region settings, int start, int end) {
+	regions[0] = steps;
+	regions[1] = settings;
+	journalStart = start;
+	journalEnd = end;
+	head = start + 1;
+}
+
+int PatternJournal::itemCount() {
+	int n = regions[0].count + regions[1].count;
+	return n < maxItems ? n : maxItems;
+}
+
+int PatternJournal::itemSize(int id) {
+	return id < regions[0].count ? regions[0].size : regions[1].size;
+}
+
+uint8_t* PatternJournal::itemRam(int id) {
+	const Region& r = id < regions[0].count ? regions[0] : regions[1];
+	if (!r.ram) return nullptr;		// EEPROM only, ie folding an old layout
+	if (id >= regions[0].count) id -= regions[0].count;
+	return r.ram + id * r.size;
+}
+
+int PatternJournal::itemAddress(int id) {
+	if (id < regions[0].count)
+		return regions[0].address + id * regions[0].size;
+	id -= regions[0].count;
+	return regions[1].address + id * regions[1].size;
+}
+
+int PatternJournal::replay() {
+	uint32_t startMicros = micros();
+	int applied = 0;
+
+	for (int i = 0; i < maxItems; ++i)
+		latest[i] = 0;
+	compactPos = -1;
+
+	gen = EEPROM.read(journalStart);
+	if (gen == erased) {
+		// never used - start the first generation
+		format();
+		lastReplayMicros = micros() - startMicros;
+		return 0;
+	}
+
+	int pos = journalStart + 1;
+	while (pos + 4 <= journalEnd) {
+		if (EEPROM.read(pos) != gen) break;
+		int id = EEPROM.read(pos + 1) | (EEPROM.read(pos + 2) << 8);
+		if (id >= itemCount()) break;
+		int size = itemSize(id);
+		if (pos + recordSize(id) > journalEnd) break;
+
+		uint8_t crc = 0xFF;
+		for (int i = 0; i < 3 + size; ++i)
+			crc = crc8(crc, EEPROM.read(pos + i));
+		if (crc != EEPROM.read(pos + 3 + size)) break;	// torn write - everything before it is good
+
+		uint8_t* ram = itemRam(id);
+		for (int i = 0; ram && i < size; ++i)
+			ram[i] = EEPROM.read(pos + 3 + i);
+		latest[id] = pos;
+		pos += recordSize(id);
+		applied++;
+	}
+	head = pos;
+
+	lastReplayMicros = micros() - startMicros;
+	return applied;
+}
+
+bool PatternJournal::changed(int id) {
+	int address = latest[id] ? latest[id] + 3 : itemAddress(id);
+	uint8_t* ram = itemRam(id);
+	for (int i = 0; i < itemSize(id); ++i) {
+		if (EEPROM.read(address + i) != ram[i]) return true;
+	}
+	return false;
+}
+
+bool PatternJournal::append(int id) {
+	int size = itemSize(id);
+	int next = head + recordSize(id);
+	if (next > journalEnd) return false;	// no room!
+
+	// terminate first, then body, then the gen byte commits the record
+	if (next < journalEnd)
+		EEPROM.write(next, erased);
+
+	uint8_t* ram = itemRam(id);
+	uint8_t crc = crc8(0xFF, gen);
+	crc = crc8(crc, id & 0xFF);
+	crc = crc8(crc, id >> 8);
+	EEPROM.write(head + 1, id & 0xFF);
+	EEPROM.write(head + 2, id >> 8);
+	for (int i = 0; i < size; ++i) {
+		EEPROM.write(head + 3 + i, ram[i]);
+		crc = crc8(crc, ram[i]);
+	}
+	EEPROM.write(head + 3 + size, crc);
+	EEPROM.write(head, gen);
+
+	latest[id] = head;
+	head = next;
+	return true;
+}
+
+int PatternJournal::save() {
+	int appended = 0;
+	for (int id = 0; id < itemCount(); ++id) {
+		if (!changed(id)) continue;
+		if (!append(id)) {
+			compact();
+			append(id);
+		}
+		appended++;
+	}
+
+	if (appended > 0) {
+		if (compacting()) {
+			compactPos = 0;		// anything already folded may be stale again
+		} else if (used() > capacity() * 3 / 4) {
+			compactPos = 0;		// fold it in the background before it fills up
+		}
+	}
+	return appended;
+}
+
+void PatternJournal::fold(int id) {
+	if (!latest[id]) return;
+	int address = itemAddress(id);
+	for (int i = 0; i < itemSize(id); ++i)
+		EEPROM.update(address + i, EEPROM.read(latest[id] + 3 + i));
+}
+
+void PatternJournal::nextGeneration() {
+	// drop the records before moving the gen on, so a power pull in between
+	// leaves an empty journal over an up to date image
+	EEPROM.write(journalStart + 1, erased);
+	gen = (gen + 1) % erased;
+	EEPROM.write(journalStart, gen);
+
+	for (int i = 0; i < maxItems; ++i)
+		latest[i] = 0;
+	head = journalStart + 1;
+	compactPos = -1;
+}
+
+void PatternJournal::update() {
+	if (!compacting()) return;
+
+	// fold one record per call to keep loop() short
+	while (compactPos < itemCount() && !latest[compactPos])
+		compactPos++;
+	if (compactPos < itemCount()) {
+		fold(compactPos++);
+		return;
+	}
+	nextGeneration();
+}
+
+void PatternJournal::compact() {
+	for (int id = 0; id < itemCount(); ++id)
+		fold(id);
+	nextGeneration();
+}
+
+void PatternJournal::format() {
+	if (gen == erased) gen = 0;
+	EEPROM.write(journalStart + 1, erased);
+	EEPROM.write(journalStart, gen);
+
+	for (int i = 0; i < maxItems; ++i)
+		latest[i] = 0;
+	head = journalStart + 1;
+	compactPos = -1;
+}
+
+PatternJournal patternJournal;
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "dimensions.h"
+
+// Append-only journal of pattern edits, kept in the EEPROM space after the
+// fixed pattern image. Saving appends a CRC-checked record for each step or
+// pattern setting that differs from what is already stored instead of
+// overwriting it in place, so a power pull mid-save only loses the record being
+// written and repeated saves of one step are spread across the journal.
+// When the journal fills up it is folded back into the fixed image one record
+// per update() and a new generation is started.
+//
+// Record layout: [gen] [id lo] [id hi] [payload ...] [crc8]
+// A record only counts once its gen byte (written last) matches the journal
+// generation, and the byte after the newest record is always 0xFF.
+
+class PatternJournal {
+	public:
+		struct Region {
+			uint8_t* ram;		// live copy in RAM, or nullptr to only work on EEPROM
+			int size;			// bytes per record payload, ie sizeof(StepNote)
+			int count;			// number of records
+			int address;		// EEPROM address of the fixed image
+		};
+
+		PatternJournal();
+		void begin(Region steps, Region settings, int journalAddress, int journalEnd);
+
+		int replay();			// apply stored records over RAM, returns number applied
+		int save();				// journal everything that changed in RAM, returns number appended
+		void format();			// drop all records without folding them
+		void update();			// background compaction, call from loop()
+		void compact();			// fold the whole journal now
+
+		bool compacting() { return compactPos >= 0; }
+		int used() { return head - (journalStart + 1); }
+		int capacity() { return journalEnd - (journalStart + 1); }
+		uint32_t replayMicros() { return lastReplayMicros; }
+
+	private:
+		static const int maxItems = PATTERNS_IN_EEPROM ? NUM_PATTERNS * NUM_STEPS + NUM_PATTERNS : 1;	// unused when the patterns are in the bank files
+		static const uint8_t erased = 0xFF;
+
+		Region regions[2];
+		int journalStart;
+		int journalEnd;
+		int head;				// address of the next record
+		uint8_t gen;
+		int compactPos;			// next item to fold, -1 when idle
+		uint32_t lastReplayMicros;
+		uint16_t latest[maxItems];	// address of newest record per item, 0 = fixed image
+
+		int itemCount();
+		int itemSize(int id);
+		uint8_t* itemRam(int id);
+		int itemAddress(int id);
+		int recordSize(int id) { return 4 + itemSize(id); }
+		bool changed(int id);
+		bool append(int id);
+		void fold(int id);
+		void nextGeneration();
+};
+
+extern PatternJournal patternJournal;
@@ -0,0 +1,190 @@
+#include "mtc.h"
+#include "MM.h"
+
+namespace {
+	const uint8_t nominalFps[MTC_RATES] = { 24, 25, 30, 30 };
+	const uint32_t dropBlock = 17982;		// frames in ten minutes of drop frame
+	const uint32_t dropMinute = 1798;		// and in a minute that drops two
+}
+
+const char* Mtc::rateNames[MTC_RATES] = { "24", "25", "29D", "30" };
+const char* Mtc::modeNames[MTC_MODES] = { "OFF", "OUT", "CHS" };
+const uint16_t Mtc::quarterThirds[MTC_RATES] = { 31250, 30000, 25025, 25000 };
+
+Timecode Mtc::timecode(uint32_t frames, int rate) {
+	if (rate == MTC_30_DROP) {
+		uint32_t m = frames % dropBlock;
+		frames += 18 * (frames / dropBlock) + (m >= 2 ? 2 * ((m - 2) / dropMinute) : 0);
+	}
+	int fps = nominalFps[rate];
+	uint32_t seconds = frames / fps;
+	Timecode tc;
+	tc.frames = frames % fps;
+	tc.seconds = seconds % 60;
+	tc.minutes = (seconds / 60) % 60;
+	tc.hours = (seconds / 3600) % 24;
+	return tc;
+}
+
+uint32_t Mtc::frames(const Timecode& tc, int rate) {
+	uint32_t minutes = tc.hours * 60 + tc.minutes;
+	uint32_t frames = (minutes * 60 + tc.seconds) * nominalFps[rate] + tc.frames;
+	if (rate == MTC_30_DROP) {
+		frames -= 2 * (minutes - minutes / 10);
+	}
+	return frames;
+}
+
+MtcOut::MtcOut() {
+	rate = MTC_25;
+	on = false;
+	startPosition = 0;
+	startAt = 0;
+	quarter = 0;
+	remainder = 0;
+	tc = { 0, 0, 0, 0 };
+}
+
+void MtcOut::start(uint32_t at) {
+	stop(at);
+	startAt = at;
+	uint32_t thirds = Mtc::quarterThirds[rate];
+
+	// the first quarter frame on an even frame, at or after the position
+	uint64_t quarters = (startPosition * 3 + thirds - 1) / thirds;
+	quarters = (quarters + 7) & ~(uint64_t)7;
+	uint64_t lead = quarters * thirds - startPosition * 3;		// thirds of a us until it's due
+	quarter = (uint32_t)quarters;
+	remainder = lead % 3;
+	uint32_t wait = lead / 3;
+
+	int32_t late = (int32_t)(micros() - at);		// - when at is still to come, a step taken early
+	if (late < 0) {
+		wait -= late;
+	} else {
+		wait = wait > (uint32_t)late ? wait - late : 0;
+	}
+	if (wait == 0) {
+		send();
+		wait = nextPeriod();
+	}
+	__disable_irq();
+	timer.begin(onTimer, (unsigned long)wait);
+	timer.update((unsigned long)nextPeriod());
+	on = true;
+	__enable_irq();
+}
+
+void MtcOut::stop(uint32_t at) {
+	if (!on) return;
+	timer.end();
+	on = false;
+	startPosition = position(at);
+	startAt = at;
+}
+
+void MtcOut::locate(uint64_t micros) {
+	startPosition = micros;
+}
+
+uint64_t MtcOut::position(uint32_t at) {
+	return on ? startPosition + (uint32_t)(at - startAt) : startPosition;
+}
+
+// the period after the one the timer's counting, in whole us
+uint32_t MtcOut::nextPeriod() {
+	uint32_t thirds = remainder + Mtc::quarterThirds[rate];
+	remainder = thirds % 3;
+	return thirds / 3;
+}
+
+void MtcOut::send() {
+	int piece = quarter & 7;
+	if (piece == 0) {
+		tc = Mtc::timecode(quarter / 4, rate);
+	}
+	uint8_t nibble;
+	switch (piece) {
+		case 0: nibble = tc.frames & 0x0F; break;
+		case 1: nibble = tc.frames >> 4; break;
+		case 2: nibble = tc.seconds & 0x0F; break;
+		case 3: nibble = tc.seconds >> 4; break;
+		case 4: nibble = tc.minutes & 0x0F; break;
+		case 5: nibble = tc.minutes >> 4; break;
+		case 6: nibble = tc.hours & 0x0F; break;
+		default: nibble = (tc.hours >> 4) | (rate << 1); break;
+	}
+	quarter++;
+	MM::sendRealTime(0xF1, (piece << 4) | nibble);
+}
+
+void MtcOut::onTimer() {
+	mtcOut.send();
+	mtcOut.timer.update((unsigned long)mtcOut.nextPeriod());
+}
+
+MtcIn::MtcIn() {
+	rate = MTC_25;
+	got = 0;
+	expect = 0;
+	known = false;
+	anchor = 0;
+	anchorAt = 0;
+	heardAt = 0;
+	heard = false;
+}
+
+void MtcIn::quarterFrame(uint8_t data, uint32_t at) {
+	if (known && !running(at)) {
+		// starting again, from where it stopped or was located to until it says otherwise
+		anchor = position(at);
+		anchorAt = at;
+	}
+	int piece = (data >> 4) & 7;
+	if (piece != expect) {
+		got = 0;		// a jump or a dropped piece, wait for the next run of eight
+	}
+	nibbles[piece] = data & 0x0F;
+	got |= 1 << piece;
+	expect = (piece + 1) & 7;
+	heardAt = at;
+	heard = true;
+	if (piece != 7 || got != 0xFF) return;
+
+	Timecode tc;
+	tc.frames = nibbles[0] | (nibbles[1] & 0x01) << 4;
+	tc.seconds = nibbles[2] | (nibbles[3] & 0x03) << 4;
+	tc.minutes = nibbles[4] | (nibbles[5] & 0x03) << 4;
+	tc.hours = nibbles[6] | (nibbles[7] & 0x01) << 4;
+	rate = (nibbles[7] >> 1) & 3;
+	// the time code is where the first of the eight went out, this is the last
+	anchor = Mtc::quarterMicros((uint64_t)Mtc::frames(tc, rate) * 4 + 7, rate);
+	anchorAt = at;
+	known = true;
+	got = 0;
+}
+
+// F0 7F <device> 01 01 hr mn sc fr F7, a locate
+bool MtcIn::fullFrame(const uint8_t* data, uint16_t length, uint32_t at) {
+	if (length != 10 || data[0] != 0xF0 || data[1] != 0x7F || data[3] != 0x01 || data[4] != 0x01) return false;
+	Timecode tc = { (uint8_t)(data[5] & 0x1F), data[6], data[7], data[8] };
+	rate = (data[5] >> 5) & 3;
+	anchor = Mtc::quarterMicros((uint64_t)Mtc::frames(tc, rate) * 4, rate);
+	anchorAt = at;
+	known = true;
+	heard = false;		// it says where, quarter frames say it's running
+	got = 0;
+	return true;
+}
+
+bool MtcIn::running(uint32_t at) {
+	return known && heard && at - heardAt < timeout;
+}
+
+uint64_t MtcIn::position(uint32_t at) {
+	if (running(at)) return anchor + (uint32_t)(at - anchorAt);
+	return heard ? anchor + (uint32_t)(heardAt - anchorAt) : anchor;		// the last quarter frame, or the locate
+}
+
+MtcOut mtcOut;
+MtcIn mtcIn;
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// MIDI Time Code. Out, quarter frames from a hardware timer through MM's
+// real-time lane, so notes going out can't hold them up; the time is the
+// sequencer's own, from the first clock tick of a start from the top, so it
+// runs whatever the tempo does. In, the time code another unit sends, for the
+// sequencer to chase.
+//
+// Eight quarter frames carry a time code, a nibble each, starting on an even
+// frame. A quarter frame is a whole number of thirds of a microsecond at every
+// rate, so the timer's periods are worked out in thirds and never drift.
+
+enum MtcRate {
+	MTC_24 = 0,			// as the rate bits of the time code's hours
+	MTC_25,
+	MTC_30_DROP,		// 29.97, drop frame numbering
+	MTC_30,
+
+	MTC_RATES
+};
+
+enum MtcMode {
+	MTC_MODE_OFF = 0,
+	MTC_MODE_OUT,		// send time code while playing
+	MTC_MODE_CHASE,		// follow incoming time code
+
+	MTC_MODES
+};
+
+struct Timecode {
+	uint8_t hours;
+	uint8_t minutes;
+	uint8_t seconds;
+	uint8_t frames;
+};
+
+class Mtc {
+	public:
+		static const char* rateNames[MTC_RATES];
+		static const char* modeNames[MTC_MODES];
+		static const uint16_t quarterThirds[MTC_RATES];		// a quarter frame, in thirds of a us
+
+		// frames since 00:00:00:00 and the time code they're numbered, drop
+		// frame leaves out frames 0 and 1 of every minute but each tenth
+		static Timecode timecode(uint32_t frames, int rate);
+		static uint32_t frames(const Timecode& tc, int rate);
+
+		static uint64_t quarterMicros(uint64_t quarters, int rate) { return quarters * quarterThirds[rate] / 3; }
+		static uint32_t frameMicros(int rate) { return 4 * quarterThirds[rate] / 3; }
+};
+
+class MtcOut {
+	public:
+		uint8_t rate;
+
+		MtcOut();
+		void start(uint32_t at);		// carries on from where it stopped, or from locate(). at can be a little ahead
+		void stop(uint32_t at);
+		bool running() { return on; }
+		void locate(uint64_t micros);	// while stopped, 0 is 00:00:00:00
+		uint64_t position(uint32_t at);	// us from 00:00:00:00
+
+	private:
+		IntervalTimer timer;
+		bool on;
+		uint64_t startPosition;
+		uint32_t startAt;
+		volatile uint32_t quarter;		// the next one to send
+		uint32_t remainder;				// thirds of a us the periods so far are short of the true time
+		Timecode tc;					// what the eight quarter frames going out carry
+
+		uint32_t nextPeriod();
+		void send();
+		static void onTimer();
+};
+
+class MtcIn {
+	public:
+		uint8_t rate;					// the incoming time code's
+
+		MtcIn();
+		void quarterFrame(uint8_t data, uint32_t at);
+		bool fullFrame(const uint8_t* data, uint16_t length, uint32_t at);		// false if it isn't one
+		bool running(uint32_t at);		// quarter frames coming in
+		uint64_t position(uint32_t at);	// us from 00:00:00:00, where the time code is now
+
+	private:
+		static const uint32_t timeout = 100000;		// us without a quarter frame and it's stopped
+
+		uint8_t nibbles[8];
+		uint8_t got;					// bit n set = nibbles[n] is from this run of eight
+		uint8_t expect;					// the next piece in order
+		bool known;						// position has been set
+		uint64_t anchor;				// where the time code was at anchorAt
+		uint32_t anchorAt;
+		uint32_t heardAt;				// the last quarter frame
+		bool heard;
+};
+
+extern MtcOut mtcOut;
+extern MtcIn mtcIn;
@@ -3,15 +3,19 @@
 #include <Arduino.h>
 #include "consts.h"
 #include "MM.h"
+#include "trace.h"
 
 
 PendingNoteOffs::PendingNoteOffs() {
 	for (int i = 0; i < queueSize; ++i)
 		queue[i].inUse = false;
+	used = 0;
+	peakUsed = 0;
+	drops = 0;
 }
 
 
-bool PendingNoteOffs::insert(int note, int channel, uint32_t time, bool sendCV) {
+bool PendingNoteOffs::insert(int note, int channel, uint32_t time, bool sendCV, int pattern) {
 	for (int i = 0; i < queueSize; ++i) {
 		if (queue[i].inUse) continue;
 		queue[i].inUse = true;
@@ -19,8 +23,11 @@ bool PendingNoteOffs::insert(int note, int channel, uint32_t time, bool sendCV)
 		queue[i].time = time;
 		queue[i].channel = channel;
 		queue[i].sendCV = sendCV;
+		queue[i].pattern = pattern;
+		if (++used > peakUsed) peakUsed = used;
 		return true;
 	}
+	drops++;
 	return false; // couldn't find room!
 }
 
@@ -28,11 +35,13 @@ void PendingNoteOffs::play(uint32_t now) {
 	for (int i = 0; i < queueSize; ++i) {
 		if (queue[i].inUse && queue[i].time <= now) {
 			MM::sendNoteOff(queue[i].note, 0, queue[i].channel);
+			TRACE_EVENT(TRACE_NOTE_OFF, queue[i].time, micros(), queue[i].pattern, queue[i].note, queue[i].channel);
 //	 		analogWrite(CVPITCH_PIN, 0);
 			if (queue[i].sendCV) {
 				digitalWrite(CVGATE_PIN, LOW);
 			}
 		queue[i].inUse = false;
+		used--;
 		}
 	}
 }
@@ -41,6 +50,12 @@ void PendingNoteOffs::allOff() {
 	play(UINT32_MAX);
 }
 
+void PendingNoteOffs::retime(const TempoChange& change) {
+	for (int i = 0; i < queueSize; ++i) {
+		if (queue[i].inUse) queue[i].time = change.map(queue[i].time);
+	}
+}
+
 PendingNoteOffs pendingNoteOffs;
 
 ///
@@ -48,9 +63,12 @@ PendingNoteOffs pendingNoteOffs;
 PendingNoteOns::PendingNoteOns() {
 	for (int i = 0; i < queueSize; ++i)
 		queue[i].inUse = false;
+	used = 0;
+	peakUsed = 0;
+	drops = 0;
 }
 
-bool PendingNoteOns::insert(int note, int velocity, int channel, uint32_t time, bool sendCV) {
+bool PendingNoteOns::insert(int note, int velocity, int channel, uint32_t time, bool sendCV, int pattern) {
 	for (int i = 0; i < queueSize; ++i) {
 		if (queue[i].inUse) continue;
 		queue[i].inUse = true;
@@ -59,8 +77,11 @@ bool PendingNoteOns::insert(int note, int velocity, int channel, uint32_t time,
 		queue[i].channel = channel;
 		queue[i].velocity = velocity;
 		queue[i].sendCV = sendCV;
+		queue[i].pattern = pattern;
+		if (++used > peakUsed) peakUsed = used;
 		return true;
 	}
+	drops++;
 	return false; // couldn't find room!
 }
 
@@ -69,6 +90,7 @@ void PendingNoteOns::play(uint32_t now) {
 	for (int i = 0; i < queueSize; ++i) {
 		if (queue[i].inUse && queue[i].time <= now) {
 		MM::sendNoteOn(queue[i].note, queue[i].velocity, queue[i].channel);
+		TRACE_EVENT(TRACE_NOTE_ON, queue[i].time, micros(), queue[i].pattern, queue[i].note, queue[i].channel);
 
 		if (queue[i].sendCV){
 			if (queue[i].note>=midiLowestNote && queue[i].note <midiHightestNote){
@@ -78,8 +100,56 @@ void PendingNoteOns::play(uint32_t now) {
 			}
 		}
 		queue[i].inUse = false;
+		used--;
 		}
 	}
 }
 
-PendingNoteOns pendingNoteOns;
\ No newline at end of file
+void PendingNoteOns::retime(const TempoChange& change) {
+	for (int i = 0; i < queueSize; ++i) {
+		if (queue[i].inUse) queue[i].time = change.map(queue[i].time);
+	}
+}
+
+PendingNoteOns pendingNoteOns;
+
+///
+
+PendingControlChanges::PendingControlChanges() {
+	clear();
+}
+
+bool PendingControlChanges::insert(int cc, int value, int channel, uint32_t time) {
+	for (int i = 0; i < queueSize; ++i) {
+		if (queue[i].inUse) continue;
+		queue[i].inUse = true;
+		queue[i].cc = cc;
+		queue[i].value = value;
+		queue[i].channel = channel;
+		queue[i].time = time;
+		return true;
+	}
+	return false; // couldn't find room!
+}
+
+void PendingControlChanges::play(uint32_t now) {
+	for (int i = 0; i < queueSize; ++i) {
+		if (queue[i].inUse && queue[i].time <= now) {
+			MM::sendControlChange(queue[i].cc, queue[i].value, queue[i].channel);
+			queue[i].inUse = false;
+		}
+	}
+}
+
+void PendingControlChanges::clear() {
+	for (int i = 0; i < queueSize; ++i)
+		queue[i].inUse = false;
+}
+
+void PendingControlChanges::retime(const TempoChange& change) {
+	for (int i = 0; i < queueSize; ++i) {
+		if (queue[i].inUse) queue[i].time = change.map(queue[i].time);
+	}
+}
+
+PendingControlChanges pendingControlChanges;
@@ -2,23 +2,42 @@
 
 #include <stdint.h>
 
+#include "dimensions.h"
+#include "tempo.h"
+
+// The note queues hold what a step schedules ahead of time: its note, or all
+// of a ratcheted step's hits (up to 8, see ratchet.h) for every pattern, with
+// room for a swung step's hits still waiting when the next step's come in.
+// An insert that finds the queue full is dropped and counted. Entries keep the
+// pattern that queued them (TRACE_NO_PATTERN for MIDI mode) for the timing
+// trace, see trace.h.
+
 class PendingNoteOffs {
 	public:
+		static const int queueSize = 24 * NUM_PATTERNS;		// two steps of hits, and long notes still held
+
 		PendingNoteOffs();
-		bool insert(int note, int channel, uint32_t time, bool sendCV);
+		bool insert(int note, int channel, uint32_t time, bool sendCV, int pattern);
 		void play(uint32_t time);
 		void allOff();
+		void retime(const TempoChange& change);
+
+		int peak() { return peakUsed; }
+		long dropped() { return drops; }
 
 	private:    
-		struct Entry {
-			bool inUse;
-			int note;
-			int channel;
-			bool sendCV;
+		struct Entry {				// 8 bytes
 			uint32_t time;
+			uint8_t note;
+			uint8_t pattern;
+			uint8_t channel : 5;	// 1 - 16
+			bool inUse : 1;
+			bool sendCV : 1;
 		};
-		static const int queueSize = 32;
 		Entry queue[queueSize];
+		int used;
+		int peakUsed;
+		long drops;
 };
 
 extern PendingNoteOffs pendingNoteOffs;
@@ -26,24 +45,55 @@ extern PendingNoteOffs pendingNoteOffs;
 
 class PendingNoteOns {
 	public:
+		static const int queueSize = 16 * NUM_PATTERNS;		// two steps of hits
+
 		PendingNoteOns();
-		bool insert(int note, int velocity, int channel, uint32_t time, bool sendCV);
+		bool insert(int note, int velocity, int channel, uint32_t time, bool sendCV, int pattern);
 		void play(uint32_t time);
+		void retime(const TempoChange& change);
+
+		int peak() { return peakUsed; }
+		long dropped() { return drops; }
 
 	private:    
-		struct Entry {
-			bool inUse;
-			int note;
-			int channel;
-			int velocity;
-			bool sendCV;
+		struct Entry {				// 8 bytes
 			uint32_t time;
+			uint8_t note;
+			uint8_t velocity;
+			uint8_t pattern;
+			uint8_t channel : 5;	// 1 - 16
+			bool inUse : 1;
+			bool sendCV : 1;
 		};
-		static const int queueSize = 32;
 		Entry queue[queueSize];
+		int used;
+		int peakUsed;
+		long drops;
 };
 
 extern PendingNoteOns pendingNoteOns;
 
 
-		
+// CC values sent at a set time, for the automation lanes (see cclanes.h) and
+// supersteps (see superstep.h)
+class PendingControlChanges {
+	public:
+		PendingControlChanges();
+		bool insert(int cc, int value, int channel, uint32_t time);
+		void play(uint32_t time);
+		void clear();
+		void retime(const TempoChange& change);
+
+	private:
+		struct Entry {
+			bool inUse;
+			uint8_t cc;
+			uint8_t value;
+			uint8_t channel;
+			uint32_t time;
+		};
+		static const int queueSize = 8 * NUM_PATTERNS;		// a step's values, 4 each from a lane and a superstep
+		Entry queue[queueSize];
+};
+
+extern PendingControlChanges pendingControlChanges;
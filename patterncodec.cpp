@@ -0,0 +1,205 @@
+#include "patterncodec.h"
+
+#include <string.h>
+
+void PatternEncoder::begin(const PatternBanks::Image& image, int pattern) {
+	stepSize = image.stepSize;
+	settingsSize = image.settingsSize;
+	stepCount = image.stepCount;
+	steps = image.steps + pattern * stepCount * stepSize;
+	settings = image.settings + pattern * settingsSize;
+	stepDefault = image.stepDefaults + pattern * stepSize;
+	settingsDefault = image.settingsDefaults + pattern * settingsSize;
+	raw = false;
+
+	// size it up first, plain records if compacting doesn't save anything
+	next = -1;
+	int compact = 1;
+	while (fill()) compact += pendingLen;
+	raw = compact > maxSize(image);
+
+	next = -2;
+	pendingLen = 0;
+	pendingPos = 0;
+}
+
+int PatternEncoder::read(uint8_t* buf, int len) {
+	int out = 0;
+	while (out < len) {
+		if (pendingPos == pendingLen && !fill()) break;
+		int n = pendingLen - pendingPos;
+		if (n > len - out) n = len - out;
+		memcpy(buf + out, pending + pendingPos, n);
+		pendingPos += n;
+		out += n;
+	}
+	return out;
+}
+
+int PatternEncoder::size(const PatternBanks::Image& image, int pattern) {
+	PatternEncoder e;
+	e.begin(image, pattern);
+	uint8_t buf[32];
+	int total = 0;
+	int n;
+	while ((n = e.read(buf, sizeof(buf))) > 0) total += n;
+	return total;
+}
+
+// encode the next record or run of default steps into pending
+bool PatternEncoder::fill() {
+	if (next >= stepCount) return false;
+
+	if (next == -2) {
+		pending[0] = raw ? 1 : 0;
+		pendingLen = 1;
+		pendingPos = 0;
+		next = -1;
+		return true;
+	}
+
+	const uint8_t* record;
+	const uint8_t* def;
+	int size;
+	if (next < 0) {
+		record = settings;
+		def = settingsDefault;
+		size = settingsSize;
+	} else {
+		record = steps + next * stepSize;
+		def = stepDefault;
+		size = stepSize;
+	}
+
+	if (raw) {
+		memcpy(pending, record, size);
+		pendingLen = size;
+		pendingPos = 0;
+		next++;
+		return true;
+	}
+
+	uint32_t mask = diff(record, def, size);
+	int n = putVarint(0, mask);
+	if (mask == 0 && next >= 0) {
+		int run = 1;
+		while (next + run < stepCount && diff(steps + (next + run) * stepSize, def, size) == 0) run++;
+		n = putVarint(n, run);
+		next += run;
+	} else {
+		for (int i = 0; i < size; ++i) {
+			if (mask & (1UL << i)) pending[n++] = record[i];
+		}
+		next++;
+	}
+	pendingLen = n;
+	pendingPos = 0;
+	return true;
+}
+
+int PatternEncoder::putVarint(int at, uint32_t v) {
+	while (v >= 0x80) {
+		pending[at++] = (v & 0x7F) | 0x80;
+		v >>= 7;
+	}
+	pending[at++] = v;
+	return at;
+}
+
+uint32_t PatternEncoder::diff(const uint8_t* record, const uint8_t* def, int size) {
+	uint32_t mask = 0;
+	for (int i = 0; i < size; ++i) {
+		if (record[i] != def[i]) mask |= 1UL << i;
+	}
+	return mask;
+}
+
+
+void PatternDecoder::begin(const PatternBanks::Image& image, int pattern) {
+	stepSize = image.stepSize;
+	settingsSize = image.settingsSize;
+	stepCount = image.stepCount;
+	steps = image.steps + pattern * stepCount * stepSize;
+	settings = image.settings + pattern * settingsSize;
+	stepDefault = image.stepDefaults + pattern * stepSize;
+	settingsDefault = image.settingsDefaults + pattern * settingsSize;
+	next = -1;
+	state = FORMAT;
+}
+
+void PatternDecoder::startRecord() {
+	memcpy(record(), next < 0 ? settingsDefault : stepDefault, recordSize());
+	byteAt = 0;
+	if (raw) {
+		state = RAW;
+		return;
+	}
+	state = MASK;
+	value = 0;
+	shift = 0;
+}
+
+void PatternDecoder::endRecord() {
+	next++;
+	if (next >= stepCount) {
+		state = DONE;
+	} else {
+		startRecord();
+	}
+}
+
+bool PatternDecoder::put(uint8_t b) {
+	switch (state) {
+		case FORMAT:
+			if (b > 1) return fail();		// a newer format
+			raw = b;
+			startRecord();
+			return true;
+
+		case RAW:
+			record()[byteAt++] = b;
+			if (byteAt == recordSize()) endRecord();
+			return true;
+
+		case MASK:
+		case RUN:
+			if (shift > 28) return fail();
+			value |= (uint32_t)(b & 0x7F) << shift;
+			shift += 7;
+			if (b & 0x80) return true;
+
+			if (state == RUN) {
+				if (value == 0 || next + (int)value > stepCount) return fail();
+				for (uint32_t i = 1; i < value; ++i) {
+					memcpy(steps + (next + i) * stepSize, stepDefault, stepSize);
+				}
+				next += value - 1;
+				endRecord();
+			} else if (recordSize() < 32 && (value >> recordSize()) != 0) {
+				return fail();		// bytes past the end of the record
+			} else if (value != 0) {
+				state = DATA;
+				while (!(value & (1UL << byteAt))) byteAt++;
+			} else if (next >= 0) {
+				state = RUN;
+				value = 0;
+				shift = 0;
+			} else {
+				endRecord();		// default settings
+			}
+			return true;
+
+		case DATA:
+			record()[byteAt] = b;
+			value &= ~(1UL << byteAt);
+			if (value == 0) {
+				endRecord();
+			} else {
+				while (!(value & (1UL << byteAt))) byteAt++;
+			}
+			return true;
+
+		default:
+			return fail();		// more data than the pattern holds
+	}
+}
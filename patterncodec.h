@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include "banks.h"
+
+// Compact pattern format for bank files and SysEx transfers. Most of a
+// pattern is whatever a blank pattern holds (no p-locks, default note,
+// velocity and probability), so each record is stored as the bytes that
+// differ from the pattern's default record (Image::stepDefaults /
+// settingsDefaults):
+//
+//   pattern  0, settings record, then step records until stepCount steps
+//   record   varint mask of the bytes that differ, then those bytes in order
+//   step     as a record, except a zero mask is followed by a varint count of
+//            default steps in a row
+//
+// Varints are 7 bits a byte, low bits first, top bit set on all but the last.
+// A blank pattern is 4 bytes, a pattern with one byte changed on every step
+// 2 bytes a step. A pattern that would come out bigger than its records is
+// stored as 1 then the settings and steps as they are, so the worst case is
+// the plain image plus a byte. The encoder hands out bytes as asked for and
+// the decoder takes them one at a time straight into the image, so neither
+// needs a copy of the encoded pattern.
+
+class PatternEncoder {
+	public:
+		static const uint8_t format = 1;		// bumped when the encoding changes
+		static const int maxRecord = 32;		// bytes, one mask bit each
+
+		void begin(const PatternBanks::Image& image, int pattern);
+		int read(uint8_t* buf, int len);		// next len bytes at most, 0 once done
+
+		static int size(const PatternBanks::Image& image, int pattern);
+		static int maxSize(const PatternBanks::Image& image) { return 1 + image.settingsSize + image.stepCount * image.stepSize; }
+
+	private:
+		const uint8_t* steps;
+		const uint8_t* settings;
+		const uint8_t* stepDefault;
+		const uint8_t* settingsDefault;
+		int stepSize;
+		int settingsSize;
+		int stepCount;
+		bool raw;				// plain records, the compact form didn't pay
+		int next;				// next step to encode, -1 = settings, -2 = the format byte
+		uint8_t pending[5 + maxRecord];		// one encoded record or run
+		int pendingLen;
+		int pendingPos;
+
+		bool fill();
+		int putVarint(int at, uint32_t v);
+		uint32_t diff(const uint8_t* record, const uint8_t* def, int size);
+};
+
+class PatternDecoder {
+	public:
+		void begin(const PatternBanks::Image& image, int pattern);
+		bool put(uint8_t b);		// false if the data is bad, the pattern is then part written
+		bool done() { return state == DONE; }
+
+	private:
+		enum State { FORMAT, MASK, DATA, RUN, RAW, DONE, FAILED };
+
+		uint8_t* steps;
+		uint8_t* settings;
+		const uint8_t* stepDefault;
+		const uint8_t* settingsDefault;
+		int stepSize;
+		int settingsSize;
+		int stepCount;
+		State state;
+		int next;				// step being decoded, -1 = settings
+		uint32_t value;			// varint so far, then the mask left to fill
+		int shift;
+		int byteAt;				// next record byte to fill
+		bool raw;
+
+		uint8_t* record() { return next < 0 ? settings : steps + next * stepSize; }
+		int recordSize() { return next < 0 ? settingsSize : stepSize; }
+		void startRecord();
+		void endRecord();
+		bool fail() { state = FAILED; return false; }
+};
@@ -0,0 +1,108 @@
+#include "profiler.h"
+
+#if PROFILE_LOOP
+
+#include <string.h>
+
+namespace {
+	const char* sectionNames[NUM_PROF_SECTIONS] = {
+		"LOOP", "KEYPAD", "KEYS", "CLOCK", "DOSTEP", "PLAYNOTE", "SWAP", "LANES", "POTS",
+		"ENCODER", "MODES", "DISPLAY", "LEDS", "STORAGE", "MIDI", "CLKOUT", "REPLAY"
+	};
+
+	uint32_t toMicros(uint32_t cycles) {
+		return cycles / (F_CPU / 1000000);
+	}
+}
+
+LoopProfiler::LoopProfiler() {
+	reset();
+}
+
+void LoopProfiler::begin() {
+	ARM_DEMCR |= ARM_DEMCR_TRCENA;
+	ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+}
+
+void LoopProfiler::reset() {
+	memset(sections, 0, sizeof(sections));
+	for (int i = 0; i < NUM_PROF_SECTIONS; ++i) {
+		sections[i].min = UINT32_MAX;
+	}
+}
+
+int LoopProfiler::bucket(uint32_t cycles) {
+	uint32_t v = cycles >> 4;
+	if (v < 4) return v;
+	int msb = 31 - __builtin_clz(v);
+	int b = (msb - 1) * 4 + ((v >> (msb - 2)) & 3);
+	return b < numBuckets ? b : numBuckets - 1;
+}
+
+uint32_t LoopProfiler::bucketTop(int b) {
+	if (b < 4) return (b + 1) << 4;
+	int msb = b / 4 + 1;
+	return ((5 + b % 4) << (msb - 2)) << 4;
+}
+
+void LoopProfiler::record(int section, uint32_t cycles) {
+	Section& s = sections[section];
+	s.count++;
+	s.total += cycles;
+	if (cycles < s.min) s.min = cycles;
+	if (cycles > s.max) s.max = cycles;
+
+	int b = bucket(cycles);
+	if (s.buckets[b] == UINT16_MAX) {
+		// halve the histogram rather than saturate, older samples fade out
+		for (int i = 0; i < numBuckets; ++i) {
+			s.buckets[i] >>= 1;
+		}
+	}
+	s.buckets[b]++;
+}
+
+void LoopProfiler::stats(int section, Stats& out) {
+	Section& s = sections[section];
+	out.count = s.count;
+	if (s.count == 0) {
+		out.min = out.avg = out.p99 = out.max = 0;
+		return;
+	}
+	out.min = toMicros(s.min);
+	out.avg = toMicros(s.total / s.count);
+	out.max = toMicros(s.max);
+
+	uint32_t inHistogram = 0;
+	for (int i = 0; i < numBuckets; ++i) {
+		inHistogram += s.buckets[i];
+	}
+	uint32_t target = inHistogram - inHistogram / 100;
+	uint32_t seen = 0;
+	int b = 0;
+	for (; b < numBuckets - 1; ++b) {
+		seen += s.buckets[b];
+		if (seen >= target) break;
+	}
+	out.p99 = toMicros(bucketTop(b));
+	if (out.p99 > out.max) out.p99 = out.max;
+}
+
+const char* LoopProfiler::name(int section) {
+	return sectionNames[section];
+}
+
+void LoopProfiler::dump() {
+	Serial.println("section       count     min     avg     p99     max (us)");
+	for (int i = 0; i < NUM_PROF_SECTIONS; ++i) {
+		Stats st;
+		stats(i, st);
+		Serial.printf("%-8s %10lu %7lu %7lu %7lu %7lu\n", name(i),
+			(unsigned long)st.count, (unsigned long)st.min, (unsigned long)st.avg,
+			(unsigned long)st.p99, (unsigned long)st.max);
+	}
+}
+
+LoopProfiler loopProfiler;
+
+#endif
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+
+// Loop section profiler. Sections of loop() are wrapped in
+//   PROFILE_BEGIN(PROF_POTS); ... PROFILE_END(PROF_POTS);
+// or, for whole functions with early returns, PROFILE_SCOPE(PROF_DOSTEP);
+// Timing comes from the Cortex-M4 DWT cycle counter, so a probe is two
+// register reads and a histogram bump.
+//
+// Build with PROFILE_LOOP 1 to turn it on. Left at 0 the macros expand to
+// nothing and none of the tables are compiled in.
+//
+// Stats are shown on a hidden OLED page (long press the encoder while on the
+// mode select screen) and printed over Serial when 'p' is received.
+
+#ifndef PROFILE_LOOP
+#define PROFILE_LOOP 0
+#endif
+
+enum ProfileSection {
+	PROF_LOOP = 0,		// whole pass through loop()
+	PROF_KEYPAD,		// keypad scan
+	PROF_KEYS,			// key handling + long presses
+	PROF_CLOCK,			// advanceClock / advanceSteps
+	PROF_DOSTEP,
+	PROF_PLAYNOTE,
+	PROF_SWAP,			// song mode slot change - bank copy and replan
+	PROF_LANES,			// CC automation lanes scheduled for a step
+	PROF_POTS,
+	PROF_ENCODER,		// encoder + encoder switch
+	PROF_MODES,			// the big mode switch (LEDs and display drawing)
+	PROF_DISPLAY,		// display.display()
+	PROF_LEDS,			// strip.show()
+	PROF_STORAGE,		// journal, banks, SysEx
+	PROF_MIDI,			// draining MIDI input
+	PROF_CLOCKOUT,		// not a section - how late each MIDI clock went out, see clockout.h
+	PROF_REPLAY,		// not a section - the pattern journal replay at boot, see journal.h
+
+	NUM_PROF_SECTIONS
+};
+
+#if PROFILE_LOOP
+
+#include <Arduino.h>
+
+inline uint32_t profileCycles() {
+	return ARM_DWT_CYCCNT;
+}
+
+class LoopProfiler {
+	public:
+		struct Stats {
+			uint32_t count;
+			uint32_t min;		// microseconds
+			uint32_t avg;
+			uint32_t p99;		// upper edge of the bucket holding the 99th percentile
+			uint32_t max;
+		};
+
+		LoopProfiler();
+		void begin();			// start the cycle counter
+		void reset();
+
+		void record(int section, uint32_t cycles);
+		void stats(int section, Stats& out);
+		const char* name(int section);
+
+		void dump();			// all sections over Serial
+
+	private:
+		// log-linear buckets: four per power of two, 16 cycle resolution at the
+		// bottom, tops out around 20ms at 96MHz
+		static const int numBuckets = 64;
+
+		struct Section {
+			uint32_t count;
+			uint64_t total;
+			uint32_t min;
+			uint32_t max;
+			uint16_t buckets[numBuckets];
+		};
+		Section sections[NUM_PROF_SECTIONS];
+
+		static int bucket(uint32_t cycles);
+		static uint32_t bucketTop(int b);
+};
+
+extern LoopProfiler loopProfiler;
+
+class ProfileScope {
+	public:
+		ProfileScope(int s) : section(s), start(profileCycles()) {}
+		~ProfileScope() { loopProfiler.record(section, profileCycles() - start); }
+
+	private:
+		int section;
+		uint32_t start;
+};
+
+#define PROFILE_BEGIN(s)	uint32_t profileStart_##s = profileCycles()
+#define PROFILE_END(s)		loopProfiler.record(s, profileCycles() - profileStart_##s)
+#define PROFILE_SCOPE(s)	ProfileScope profileScope_##s(s)
+
+#else
+
+#define PROFILE_BEGIN(s)
+#define PROFILE_END(s)
+#define PROFILE_SCOPE(s)
+
+#endif
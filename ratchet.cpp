@@ -0,0 +1,47 @@
+#include "ratchet.h"
+
+const char* Ratchets::velocityNames[RATCHET_VELOCITIES] = { "FLAT", "UP", "DN", "ACC" };
+const char* Ratchets::spacingNames[RATCHET_SPACINGS] = { "EVEN", "FAST", "SLOW", "SWNG" };
+
+int Ratchets::expand(int hits, int velocityCurve, int spacing, int velocity, int stepTicks, Hit* out) {
+	int n = hits < maxHits ? hits : maxHits;
+	if (n > stepTicks / 2) n = stepTicks / 2;
+	if (n < 1) n = 1;
+
+	// where each hit falls, 0 - 255 through the step
+	int last = -2;
+	for (int i = 0; i < n; ++i) {
+		int x = i * 256 / n;
+		if (spacing == RATCHET_FASTER) {
+			x = 256 - (256 - x) * (256 - x) / 256;
+		} else if (spacing == RATCHET_SLOWER) {
+			x = x * x / 256;
+		} else if (spacing == RATCHET_SWUNG && (i & 1)) {
+			x += 256 / (3 * n);
+		}
+
+		// on the tick grid, 2 ticks apart with room left for the rest
+		int tick = x * stepTicks / 256;
+		if (tick < last + 2) tick = last + 2;
+		if (tick > stepTicks - 2 * (n - i)) tick = stepTicks - 2 * (n - i);
+		out[i].on = tick;
+		last = tick;
+
+		int v = velocity;
+		if (velocityCurve == RATCHET_UP) {
+			v = velocity * (i + 1) / n;
+		} else if (velocityCurve == RATCHET_DOWN) {
+			v = velocity * (n - i) / n;
+		} else if (velocityCurve == RATCHET_ACCENT && i > 0) {
+			v = velocity / 2;
+		}
+		out[i].velocity = v < 1 ? 1 : v;
+	}
+
+	for (int i = 0; i < n; ++i) {
+		int next = i + 1 < n ? out[i + 1].on : stepTicks;
+		int length = (next - out[i].on) / 2;
+		out[i].length = length < 2 ? 2 : length;
+	}
+	return n;
+}
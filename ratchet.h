@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+// Ratchets: a step's note played up to 8 times within the step. Stored in the
+// step's ratchet bits (see StepNote) as the extra hits, a velocity curve and
+// a spacing, and expanded into hits on the PPQ tick grid when the step plays,
+// which playNote() queues on pendingNoteOns / pendingNoteOffs.
+//
+// Each hit is at least 2 ticks after the one before and sounds for half the
+// time to the next, but at least 2 ticks: a step's first hit is queued at the
+// step's own time and can go out a tick late, and its note off mustn't go out
+// with it. A hit's note off is at the latest in the tick of the next hit's
+// note on, and the note offs go first (see advanceSteps()). A step too short
+// for that many hits gets as many as fit.
+
+enum RatchetVelocity {
+	RATCHET_FLAT = 0,		// every hit at the step's velocity
+	RATCHET_UP,				// rising to it
+	RATCHET_DOWN,			// falling from it
+	RATCHET_ACCENT,			// the first hit at it, the rest half
+
+	RATCHET_VELOCITIES
+};
+
+enum RatchetSpacing {
+	RATCHET_EVEN = 0,
+	RATCHET_FASTER,			// hits closer together towards the end of the step
+	RATCHET_SLOWER,			// further apart
+	RATCHET_SWUNG,			// every other hit a third late
+
+	RATCHET_SPACINGS
+};
+
+class Ratchets {
+	public:
+		static const int maxHits = 8;
+		static const char* velocityNames[RATCHET_VELOCITIES];
+		static const char* spacingNames[RATCHET_SPACINGS];
+
+		struct Hit {
+			uint16_t on;			// ticks into the step
+			uint16_t length;		// ticks
+			uint8_t velocity;
+		};
+
+		// hits into out (maxHits of them), returns how many
+		static int expand(int hits, int velocityCurve, int spacing, int velocity, int stepTicks, Hit* out);
+};
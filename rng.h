@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+// Small fast random numbers for the generative features (probability, random
+// step types, random reset steps, drunken swing). Each pattern gets its own
+// stream so a pattern's choices only depend on its own steps, and a stream can
+// be restarted from a seed to play the same choices again.
+//
+// xorshift32 for the bits; range() scales with a 32x32->64 multiply instead of
+// %, rejecting the few values that would bias the result (Lemire's method), so
+// it's a multiply and a compare in the common case.
+
+class Rng {
+	public:
+		// same seed and stream, same numbers
+		void seed(uint32_t seed, uint32_t stream) {
+			// murmur3 finalizer, so neighbouring seeds / streams don't start out alike
+			uint32_t z = seed + 0x9E3779B9UL * (stream + 1);
+			z = (z ^ (z >> 16)) * 0x85EBCA6BUL;
+			z = (z ^ (z >> 13)) * 0xC2B2AE35UL;
+			z ^= z >> 16;
+			state = z ? z : 0x6D2B79F5UL;		// xorshift never leaves 0
+		}
+
+		uint32_t next() {
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		// 0 .. n-1, without modulo bias
+		uint32_t range(uint32_t n) {
+			uint64_t m = (uint64_t)next() * n;
+			uint32_t low = (uint32_t)m;
+			if (low < n) {
+				uint32_t threshold = (0 - n) % n;		// 2^32 mod n
+				while (low < threshold) {
+					m = (uint64_t)next() * n;
+					low = (uint32_t)m;
+				}
+			}
+			return m >> 32;
+		}
+
+		// true percent times in 100, always takes one number so editing a
+		// probability doesn't shift the choices that follow
+		bool chance(int percent) {
+			return (int)range(100) < percent;
+		}
+
+	private:
+		uint32_t state = 1;
+};
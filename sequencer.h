@@ -1,5 +1,4 @@
-#define NUM_PATTERNS 8
-#define NUM_STEPS 16
+#include "dimensions.h"
 
 // the MIDI channel number to send messages
 int midiChannel = 1;
@@ -10,8 +9,10 @@ bool playing = 0;         // Are we playing?
 bool paused = 0;          // Are we paused?
 bool stopped = 1;         // Are we stopped? (Must init to 1)
 byte songPosition = 0;    // A place to store the current MIDI song position
-int playingPattern = 0;  // The currently playing pattern, 0-7
+int playingPattern = 0;  // The currently playing pattern, 0 - NUM_PATTERNS-1
 bool seqResetFlag = 1;    // for autoreset functionality
+int patternSeed = 0;      // 1 - 99 plays the same random choices after every reset, 0 = new ones every boot
+uint32_t bootSeed = 0;    // ADC noise read at power on
 using Micros = unsigned long; // for tracking time per pattern
 int clockDivMult = 0;  // TODO: per pattern setting
 
@@ -20,11 +21,12 @@ int seq_velocity = 100;
 int seq_acc_velocity = 127;
 
 int seqPos[NUM_PATTERNS] = {0, 0, 0, 0, 0, 0, 0, 0};				// What position in the sequence are we in?
+int stepPage = 0;         // page of NUM_STEP_KEYS steps shown on the step keys
 bool cvPattern[NUM_PATTERNS] = {1, 0, 0, 0, 0, 0, 0, 0};
 
 // int patternStart[NUM_PATTERNS] = {0, 0, 0, 0, 0, 0, 0, 0};
 
-int patternDefaultNoteMap[NUM_PATTERNS] = {36, 38, 37, 39, 42, 46, 49, 51}; // default to GM Drum Map for now
+int patternDefaultNoteMap[NUM_PATTERN_KEYS] = {36, 38, 37, 39, 42, 46, 49, 51}; // default to GM Drum Map for now, repeats for every 8 patterns
 
 enum StepType {
   STEPTYPE_NONE = 0,
@@ -46,20 +48,21 @@ enum TrigType {
 };
 
 struct PatternSettings {  // ?? bytes
-  uint8_t len : 4;    // 0 - 15, maps to 1 - 16
+  uint8_t len : STEP_BITS;    // 0 - NUM_STEPS-1, maps to 1 - NUM_STEPS
   uint8_t channel : 4;    // 0 - 15 , maps to channels 1 - 16
-  uint8_t startstep : 4; // step to begin pattern. must be < patternlength-1
-  uint8_t autoresetstep : 4;  // step to reset on / 0 = off
+  uint8_t startstep : STEP_BITS; // step to begin pattern. must be < patternlength-1
+  uint8_t autoresetstep : STEP_BITS;  // step to reset on / 0 = off
   uint8_t autoresetfreq : 4; // tracking reset iteration if enabled / ie Freq of autoreset. should be renamed
-  uint8_t current_cycle : 4; // tracking current cycle of autoreset counter / start it at 1
-  uint8_t rndstep : 4; // for random autostep functionality
+  uint8_t current_cycle : 4; // unused, kept for the EEPROM layout - see currentCycleP
+  uint8_t rndstep : 4; // unused, kept for the EEPROM layout - see rndstepP
   uint8_t clockDivMultP : 4;
   uint8_t autoresetprob : 7; // probability of autoreset - 1 is always and totally random if autoreset is 0
   uint8_t swing : 7;
   bool reverse : 1;
   bool mute : 1;
-  bool autoreset : 1; // whether autoreset is enabled
+  bool autoreset : 1; // unused, kept for the EEPROM layout - see autoresetP
   bool solo : 1;
+  uint8_t groove : 3;		// Grooves::table, 0 = off. Fits in solo's byte
 }; // ? bytes
 
 PatternSettings patternSettings[NUM_PATTERNS] = { 
@@ -73,25 +76,24 @@ PatternSettings patternSettings[NUM_PATTERNS] = {
   { 15, 7, 0, 0, 0, 0, 1, 3, 1, 0, false, false, false, false }
 };
 
-struct TimePerPattern {
-  Micros lastProcessTimeP : 32;
-  Micros nextStepTimeP : 32;
-  Micros lastStepTimeP : 32;
-  int lastPosP : 16;
-};
-
-TimePerPattern timePerPattern[NUM_PATTERNS] = {
-  { 0, 0, 0 },
-  { 0, 0, 0 },
-  { 0, 0, 0 },
-  { 0, 0, 0 },
-  { 0, 0, 0 },
-  { 0, 0, 0 },
-  { 0, 0, 0 },
-  { 0, 0, 0 }
-};
+// Playback state, one plain array per field so the S2 sweep reads and writes
+// whole words instead of read-modify-writing packed bitfields. The settings the
+// user edits stay in patternSettings.
+Micros nextStepTimeP[NUM_PATTERNS];      // when each pattern's next step is due
+Micros lastStepTimeP[NUM_PATTERNS];
+int playedStepP[NUM_PATTERNS];           // step each pattern played last, CC lanes are timed from it
+int8_t ccLaneSent[NUM_PATTERNS][NUM_CC_POTS];  // value each lane sent last, -1 = none yet
+Micros nextStepDue = 0;                  // never later than the earliest nextStepTimeP, S2 skips the sweep until then
+uint8_t currentCycleP[NUM_PATTERNS];     // autoreset cycle count, 0 - 15, start it at 1
+uint8_t rndstepP[NUM_PATTERNS];          // random autoreset step for this cycle, 1 - pattern length
+bool autoresetP[NUM_PATTERNS];           // reset early this cycle
+
+// probability, random step types, random reset steps and drunken swing draw
+// from their pattern's own stream (see seedPatternStreams())
+Rng patternRng[NUM_PATTERNS];
 
 // Helpers to deal with 1-16 values for pattern length and channel when they're stored as 0-15
+// (length is 1 - NUM_STEPS stored as 0 - NUM_STEPS-1)
 uint8_t PatternLength( int pattern ) {
   return patternSettings[pattern].len + 1;
 }
@@ -114,11 +116,52 @@ struct StepNote {           // ?? bytes
   uint8_t prob : 7;			// 0 - 100
   uint8_t condition : 6;			// 0 - 36
   StepType stepType : 3;	// can be 2 bits as long as StepType has 4 values or fewer
-}; // {note, vel, len, TRIG_TYPE, {params0, params1, params2, params3}, prob, cond, STEP_TYPE}
+  uint8_t ratchet : 3;		// extra hits, 0 - 7 (see ratchet.h). These share stepType's last byte, so the step
+  uint8_t ratchetVel : 2;	// is no bigger for them
+  uint8_t ratchetSpace : 2;
+  int8_t nudge;				// microtiming, -12 - 12 ticks of 24 to a step (see groove.h). Was padding
+}; // {note, vel, len, TRIG_TYPE, {params0, params1, params2, params3}, prob, cond, STEP_TYPE, RATCHET, RATCHET_VEL, RATCHET_SPACE, NUDGE}
 
 // default to GM Drum Map for now
 StepNote stepNoteP[NUM_PATTERNS][NUM_STEPS];
 
+// Playback plans - what doStep() / playNote() need from stepNoteP and
+// patternSettings, unpacked ahead of time so the step doesn't redo it. Kept up
+// to date by the updatePlan*() calls wherever a pattern is edited.
+enum PlanFlags {
+  PLAN_PLAY = 1 << 0,       // trig is TRIGTYPE_PLAY
+  PLAN_SWING = 1 << 1,      // even step, note-on is swung
+  PLAN_SUPERSTEP = 1 << 2,  // params[4] holds a superstep LFO (see superstep.h)
+  PLAN_RATCHET = 1 << 3     // more than one hit, see ratchets
+};
+
+struct PlanStep {           // 8 bytes, there's one for every step
+  uint8_t note;
+  uint8_t vel;
+  uint8_t prob;             // 0 - 100
+  uint8_t condition;        // A:B condition, index into trigConditionsAB
+  uint8_t stepType : 3;     // StepType
+  uint8_t flags : 5;        // PlanFlags
+  uint8_t plocks : 4;       // bit q set = the step's params[q] is locked
+  uint8_t len : 4;          // note length in 16ths - 1, PPQ ticks from planLengthTicks()
+  uint8_t ratchet : 3;      // extra hits, as StepNote
+  uint8_t ratchetVel : 2;
+  uint8_t ratchetSpace : 2;
+  int8_t offsetTicks;       // nudge and groove, PPQ ticks - is early. See planOffset()
+};
+
+struct PatternPlan {
+  uint8_t channel;          // 1 - 16
+  uint8_t swing;            // 0 - 99, 99 = drunken
+  Micros stepMicros;        // step length at the pattern's clock div/mult
+  Micros tickMicros;        // a PPQ tick of it, for nudge and groove
+  Micros swingMicros;       // note-on delay of a swung step
+  float swingUnit;          // one point of swing, for drunken swing
+};
+
+PlanStep patternPlanSteps[NUM_PATTERNS][NUM_STEPS];
+PatternPlan patternPlans[NUM_PATTERNS];
+
 uint8_t lastNote[NUM_PATTERNS][NUM_STEPS] = {
 	{0},{0},{0},{0},{0},{0},{0},{0}
 };
@@ -144,7 +187,18 @@ StepNote copyPatternBuffer[NUM_STEPS] = {
   {0, 0, 0, TRIGTYPE_MUTE, { -1, -1, -1, -1, -1}, 100, 0, STEPTYPE_NONE } 
 };
 
-int loopCount[NUM_PATTERNS][NUM_STEPS] = {
+// next bank is read in here while the current one plays, then swapped in on a bar (see swapBank)
+StepNote bankStepNoteP[NUM_PATTERNS][NUM_STEPS];
+PatternSettings bankPatternSettings[NUM_PATTERNS];
+
+// what a blank pattern holds, bank files and SysEx store what differs from it (see patterncodec.h)
+StepNote defaultStepP[NUM_PATTERNS];
+PatternSettings defaultSettingsP[NUM_PATTERNS];
+int currentBank = 0;
+bool barStart = false;    // set by the clock on the first tick of each bar
+Micros nextBarTime = 0;   // when the clock's next bar starts, song mode changes slot there
+
+uint8_t loopCount[NUM_PATTERNS][NUM_STEPS] = {		// A:B condition counters, up to 8
 	{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
 	{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
 	{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
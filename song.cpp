@@ -0,0 +1,51 @@
+#include "song.h"
+
+Song::Song() {
+	for (int i = 0; i < maxSlots; ++i) {
+		slots[i] = { 0, 0, 0 };
+	}
+	on = false;
+	pos = -1;
+	left = 0;
+	late = 0;
+}
+
+void Song::enable(bool enable) {
+	if (enable && !on) {
+		start();
+	}
+	on = enable;
+}
+
+int Song::length() {
+	int n = 0;
+	while (n < maxSlots && slots[n].bars > 0) n++;
+	return n;
+}
+
+void Song::start() {
+	pos = -1;
+	left = 0;
+}
+
+bool Song::bar(bool upcomingReady) {
+	if (left > 1) {
+		left--;
+		return false;
+	}
+	if (!upcomingReady) {
+		left = 1;
+		late++;
+		return false;
+	}
+	pos = nextPosition();
+	left = slots[pos].bars;
+	return true;
+}
+
+int Song::nextPosition() {
+	int n = length();
+	return (pos + 1 < n) ? pos + 1 : 0;
+}
+
+Song song;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+// Song mode: an ordered list of slots, each a bank and a pattern played for a
+// number of bars. The song loops back to the first slot after the last one, a
+// slot with 0 bars ends the list.
+//
+// Slots only change on a bar boundary. While a slot plays, the next slot's bank
+// is read into the bank shadow copy in the background (see PatternBanks::load),
+// so the change itself is a copy of the shadow and a replan, never a wait on
+// flash. If the next bank isn't in yet the current slot plays another bar.
+//
+// The pattern is the one S1 plays and the one shown and edited in S2, where
+// every pattern of the bank plays.
+
+class Song {
+	public:
+		static const int maxSlots = 16;
+
+		struct Slot {
+			uint8_t bank;
+			uint8_t pattern;
+			uint8_t bars;		// 0 = end of the song
+		};
+
+		Song();
+
+		bool enabled() { return on; }
+		void enable(bool enable);
+		int length();					// slots up to the first one with 0 bars
+		Slot& slot(int i) { return slots[i]; }
+
+		// from the top, the first slot starts on the next bar()
+		void start();
+		bool playing() { return on && length() > 0; }
+		int position() { return pos; }		// slot playing, -1 before the first bar
+		int barsLeft() { return left; }
+		const Slot& upcoming() { return slots[nextPosition()]; }
+		int lateBars() { return late; }		// bars a slot was held waiting for its bank
+
+		// a bar went by - true if upcoming() starts now, which the caller only
+		// lets happen once the slot is ready to play
+		bool bar(bool upcomingReady);
+
+	private:
+		Slot slots[maxSlots];
+		bool on;
+		int pos;
+		int left;
+		int late;
+
+		int nextPosition();
+};
+
+extern Song song;
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "dimensions.h"
+#include "rng.h"
+
+// Supersteps: an LFO on a step. While the step's note plays, one of the p-lock
+// pots' CCs follows a waveform, from 0 up to the step's p-lock on that pot (all
+// the way up without one). The rate is a number of cycles a step at the
+// pattern's clock div/mult, so it follows the pattern and the tempo.
+//
+// The waves are fixed-point tables, a cycle in 256 steps of 0 - 255 indexed by
+// the top of a 16 bit phase; sample and hold takes a new value from the
+// pattern's own random stream each cycle, so a seeded pattern repeats it.
+//
+// Values are worked out a step ahead and queued on pendingControlChanges, one
+// every outMicros - the destination's CC rate - and only when they change, so
+// the loop only sends them.
+//
+// Kept in the step's otherwise unused params[4]: -1 is off, else
+//   bits 0-2 wave, bits 3-4 rate, bits 5-6 destination pot (0 - 3)
+
+enum LfoWave {
+	LFO_SINE = 0,
+	LFO_TRI,
+	LFO_SAW,
+	LFO_SQUARE,
+	LFO_SH,
+
+	LFO_WAVES
+};
+
+class SuperSteps {
+	public:
+		static const int rates = 4;
+		static const char* waveNames[LFO_WAVES];
+		static const char* rateNames[rates];		// cycles a step
+
+		// the params[4] setting
+		static int8_t encode(int wave, int rate, int dest) { return wave | (rate << 3) | (dest << 5); }
+		static int wave(int8_t setting) { return setting & 7; }
+		static int rate(int8_t setting) { return (setting >> 3) & 3; }
+		static int dest(int8_t setting) { return (setting >> 5) & 3; }
+
+		SuperSteps();
+		void seed(int pattern, uint32_t seed);		// with the pattern's own stream, see seedPatternStreams()
+
+		// the step's note starts at start and plays for length
+		void start(int pattern, int8_t setting, int depth, int cc, int channel,
+			uint32_t start, uint32_t length, uint32_t stepMicros, uint32_t outMicros);
+		void stop(int pattern);
+		void clear();
+		bool active(int pattern) { return voices[pattern].on; }
+
+		// queues the pattern's values due from from until until, passing over
+		// any before from. false if the queue was full.
+		bool schedule(int pattern, uint32_t from, uint32_t until);
+
+		static uint8_t sample(int wave, uint16_t phase);		// 0 - 255, not for LFO_SH
+
+	private:
+		struct Voice {
+			bool on;
+			uint8_t wave;
+			uint8_t depth;
+			uint8_t cc;
+			uint8_t channel;
+			int16_t last;			// value sent last, -1 = none yet
+			uint8_t held;			// sample and hold value
+			uint16_t phase;
+			uint16_t increment;		// phase per value
+			uint32_t next;			// when the next value is due
+			uint32_t end;
+			uint32_t outMicros;
+		};
+
+		Voice voices[NUM_PATTERNS];
+		Rng rng[NUM_PATTERNS];
+};
+
+extern SuperSteps superSteps;
@@ -0,0 +1,238 @@
+#include "sysex.h"
+
+#include "crc.h"
+#include "MM.h"
+
+PatternSysEx::PatternSysEx() {
+	wantDump = false;
+	ready = false;
+	loading = false;
+	received = 0;
+	decoding = -1;
+	headerLen = 0;
+	rawCount = -1;
+}
+
+void PatternSysEx::begin(const PatternBanks::Image& shadow) {
+	image = shadow;
+}
+
+void PatternSysEx::receive(const uint8_t* data, int len, bool complete) {
+	for (int i = 0; i < len; ++i) {
+		uint8_t b = data[i];
+		if (b == 0xF0) {
+			start();
+		} else if (b == 0xF7) {
+			finish();
+		} else if (b & 0x80) {
+			rawCount = -1;		// not ours, drop the message
+		} else if (rawCount >= 0) {
+			raw(b);
+		}
+	}
+	if (complete && rawCount >= 0) {
+		finish();
+	}
+}
+
+void PatternSysEx::start() {
+	rawCount = 0;
+	heldCount = 0;
+	group = 0;
+	highBits = 0;
+	dataCount = 0;
+	crc = 0xFF;
+	overflow = false;
+}
+
+void PatternSysEx::raw(uint8_t b) {
+	int n = rawCount++;
+	if (n == 0) {
+		if (b != manufacturer) rawCount = -1;
+		return;
+	}
+	if (n == 1) {
+		if (b != device) rawCount = -1;
+		return;
+	}
+	if (n == 2) {
+		cmd = b;
+		return;
+	}
+	if (n == 3) {
+		seq = b;
+		if (cmd == SYSEX_PATTERN && loading && seq < image.patterns) {
+			if (seq != decoding) {
+				decoder.begin(image, seq);
+				decoding = seq;
+			}
+			chunkStart = decoder;
+		}
+		return;
+	}
+
+	// the last two bytes before F7 are the crc, so data runs two bytes behind
+	if (heldCount == 2) {
+		uint8_t d = held[0];
+		held[0] = held[1];
+		held[1] = b;
+		if (group == 0) {
+			highBits = d;
+		} else {
+			unpacked(d | (((highBits >> (group - 1)) & 1) << 7));
+		}
+		group = (group + 1) % 8;
+	} else {
+		held[heldCount++] = b;
+	}
+}
+
+void PatternSysEx::unpacked(uint8_t b) {
+	crc = crc8(crc, b);
+
+	if (cmd == SYSEX_HEADER) {
+		if (dataCount < maxHeader) {
+			header[dataCount] = b;
+		} else {
+			overflow = true;
+		}
+	} else if (cmd == SYSEX_PATTERN) {
+		if (!loading || seq != decoding || !decoder.put(b)) {
+			overflow = true;
+		}
+	}
+	dataCount++;
+}
+
+void PatternSysEx::finish() {
+	if (rawCount < 4 || heldCount < 2) {
+		rawCount = -1;
+		return;
+	}
+	rawCount = -1;
+	bool crcOk = ((held[0] << 7) | held[1]) == crc;
+
+	switch (cmd) {
+		case SYSEX_DUMP_REQUEST:
+			wantDump = true;
+			break;
+
+		case SYSEX_HEADER:
+			ready = false;
+			if (!crcOk) {
+				ack(SYSEX_BAD_CRC);
+			} else if (overflow || dataCount < layoutSize
+					|| header[0] < image.oldestVersion || header[0] > image.version
+					|| header[1] != image.stepSize
+					|| header[2] != image.settingsSize
+					|| header[3] != image.patterns
+					|| header[4] != image.stepCount
+					|| header[5] != PatternEncoder::format) {
+				loading = false;
+				ack(SYSEX_BAD_LAYOUT);
+			} else {
+				headerLen = dataCount;
+				received = 0;
+				decoding = -1;
+				loading = true;
+				ack(SYSEX_OK);
+			}
+			break;
+
+		case SYSEX_PATTERN:
+			if (!crcOk) {
+				if (seq == decoding) decoder = chunkStart;
+				ack(SYSEX_BAD_CRC);		// host resends this chunk
+			} else if (overflow) {
+				decoding = -1;			// start that pattern over
+				ack(SYSEX_BAD_CHUNK);
+			} else {
+				if (decoder.done()) {
+					received |= 1UL << seq;
+					decoding = -1;
+				}
+				ack(SYSEX_OK);
+			}
+			break;
+
+		case SYSEX_END:
+			if (loading && received == (1UL << image.patterns) - 1) {
+				loading = false;
+				ready = true;
+				ack(SYSEX_OK);
+			} else {
+				ack(SYSEX_INCOMPLETE);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+void PatternSysEx::ack(uint8_t status) {
+	send(SYSEX_ACK, seq, &status, 1, nullptr, 0);
+}
+
+void PatternSysEx::sendDump(const PatternBanks::Image& live, const uint8_t* unitHeader, int unitHeaderLen) {
+	wantDump = false;
+
+	uint8_t layout[layoutSize] = {
+		live.version,
+		(uint8_t)live.stepSize,
+		(uint8_t)live.settingsSize,
+		(uint8_t)live.patterns,
+		(uint8_t)live.stepCount,
+		PatternEncoder::format
+	};
+	send(SYSEX_HEADER, 0, layout, layoutSize, unitHeader, unitHeaderLen);
+
+	PatternEncoder encoder;
+	uint8_t piece[maxPiece];
+	for (int p = 0; p < live.patterns; ++p) {
+		encoder.begin(live, p);
+		int n;
+		while ((n = encoder.read(piece, maxPiece)) > 0) {
+			send(SYSEX_PATTERN, p, piece, n, nullptr, 0);
+		}
+	}
+
+	send(SYSEX_END, live.patterns, nullptr, 0, nullptr, 0);
+}
+
+// one chunk, data is a followed by b - refused if it won't fit in one
+void PatternSysEx::send(uint8_t command, uint8_t sequence, const uint8_t* a, int aLen, const uint8_t* b, int bLen) {
+	static_assert(packedSize(maxPiece) <= maxMessage, "a pattern piece must fit one chunk");
+	static_assert(packedSize(maxHeader) <= maxMessage, "the header must fit one chunk");
+	if (aLen < 0 || bLen < 0 || packedSize(aLen + bLen) > maxMessage) {
+		return;
+	}
+	uint8_t msg[maxMessage];
+	int n = 0;
+	msg[n++] = 0xF0;
+	msg[n++] = manufacturer;
+	msg[n++] = device;
+	msg[n++] = command;
+	msg[n++] = sequence;
+
+	uint8_t c = 0xFF;
+	int total = aLen + bLen;
+	for (int i = 0; i < total; i += 7) {
+		int highAt = n++;
+		uint8_t high = 0;
+		for (int j = 0; j < 7 && i + j < total; ++j) {
+			uint8_t v = (i + j < aLen) ? a[i + j] : b[i + j - aLen];
+			c = crc8(c, v);
+			high |= (v >> 7) << j;
+			msg[n++] = v & 0x7F;
+		}
+		msg[highAt] = high;
+	}
+
+	msg[n++] = c >> 7;
+	msg[n++] = c & 0x7F;
+	msg[n++] = 0xF7;
+	MM::sendSysEx(n, msg);
+}
+
+PatternSysEx patternSysEx;
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include "banks.h"
+#include "patterncodec.h"
+
+// Bulk pattern dump / load over USB MIDI SysEx.
+//
+// Every message is one chunk:
+//   F0 7D 27 <cmd> <seq> <data ...> <crc hi> <crc lo> F7
+// 7D is the non-commercial manufacturer id, 27 is us. Data is 8-bit bytes
+// packed 7 to 8 (one byte of high bits, then the seven low 7-bit bytes), the
+// crc is crc8 of the unpacked data split into its top bit and low 7 bits.
+//
+//   SYSEX_DUMP_REQUEST  host asks for a dump, no data
+//   SYSEX_HEADER        layout (EEPROM_VERSION, step size, settings size, patterns,
+//                       steps per pattern, PatternEncoder::format) then the
+//                       unit header - starts a load
+//   SYSEX_PATTERN       seq = pattern, the next piece of it in the compact format
+//                       (see patterncodec.h), as many as it takes
+//   SYSEX_END           seq = number of patterns, commits a load
+//   SYSEX_ACK           unit -> host after each chunk of a load, seq echoed,
+//                       data is one status byte (SYSEX_OK etc)
+//
+// Incoming chunks are decoded a byte at a time straight into a shadow image,
+// so nothing bigger than one header is buffered. A chunk that fails its crc
+// rewinds the pattern decoder to where the chunk started, ready for the resend.
+// The load is only handed over once every pattern arrived whole.
+
+enum SysExCommand {
+	SYSEX_DUMP_REQUEST = 1,
+	SYSEX_HEADER,
+	SYSEX_PATTERN,
+	SYSEX_END,
+	SYSEX_ACK
+};
+
+enum SysExStatus {
+	SYSEX_OK = 0,
+	SYSEX_BAD_CRC,
+	SYSEX_BAD_LAYOUT,
+	SYSEX_BAD_CHUNK,
+	SYSEX_INCOMPLETE
+};
+
+class PatternSysEx {
+	public:
+		static const int maxHeader = 24;
+
+		PatternSysEx();
+		void begin(const PatternBanks::Image& shadow);
+
+		// feed SysEx as it arrives, in as many pieces as the USB stack likes
+		void receive(const uint8_t* data, int len, bool complete);
+
+		bool dumpRequested() { return wantDump; }
+		void sendDump(const PatternBanks::Image& live, const uint8_t* header, int headerLen);
+
+		bool loadInProgress() { return loading; }	// shadow image is being written
+		bool loadReady() { return ready; }		// shadow holds a complete, checked set
+		const uint8_t* loadHeader() { return header + layoutSize; }
+		int loadHeaderLength() { return headerLen - layoutSize; }
+		void loadApplied() { ready = false; }
+
+	private:
+		static const uint8_t manufacturer = 0x7D;
+		static const uint8_t device = 0x27;
+		static const int layoutSize = 6;
+		static const int maxMessage = 200;		// bytes in one chunk as sent, F0 to F7
+		static const int maxPiece = (maxMessage - 8) / 8 * 7;		// pattern bytes per chunk, the most that fits
+
+		// a chunk of n data bytes as sent: F0 7D 27 cmd seq, n packed 7 to 8, crc, F7
+		static constexpr int packedSize(int n) { return 5 + n + (n + 6) / 7 + 3; }
+
+		PatternBanks::Image image;
+		bool wantDump;
+		bool ready;
+		bool loading;
+		uint32_t received;		// patterns received whole this load
+		PatternDecoder decoder;
+		PatternDecoder chunkStart;		// decoder as it was before this chunk
+		int decoding;			// pattern the decoder is on, -1 = none
+
+		// parser state for the message in progress
+		int rawCount;			// bytes since F0
+		uint8_t cmd;
+		uint8_t seq;
+		uint8_t held[2];		// last two raw bytes might be the crc
+		int heldCount;
+		int group;				// position in the 7-in-8 group
+		uint8_t highBits;
+		int dataCount;			// unpacked bytes
+		uint8_t crc;
+		bool overflow;
+
+		uint8_t header[maxHeader];
+		int headerLen;
+
+		void start();
+		void raw(uint8_t b);
+		void unpacked(uint8_t b);
+		void finish();
+		void ack(uint8_t status);
+		void send(uint8_t command, uint8_t sequence, const uint8_t* a, int aLen, const uint8_t* b, int bLen);
+};
+
+extern PatternSysEx patternSysEx;
@@ -0,0 +1,22 @@
+#include "tempo.h"
+
+TempoRamp::TempoRamp() {
+	target = 120;
+	bars = 4;
+	startBpm = 120;
+	total = 0;
+	left = 0;
+}
+
+void TempoRamp::start(float from) {
+	startBpm = from;
+	total = bars * ticksPerBar;
+	left = total;
+}
+
+float TempoRamp::tick() {
+	if (left > 0) left--;
+	return startBpm + (target - startBpm) * (total - left) / total;
+}
+
+TempoRamp tempoRamp;
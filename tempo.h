@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+// Tempo changes land on a MIDI clock tick. Everything already scheduled after
+// that tick - the next clock, every pattern's next step, the song's next bar
+// and the queued notes and CCs - moves to the new tempo keeping its place in
+// the beat, so steps stay on the clock's ticks through a change. What's due
+// before the tick stays where it is.
+
+struct TempoChange {
+	uint32_t from;			// the clock tick the new tempo starts on
+	uint32_t oldTick;		// PPQ interval before and after, us
+	uint32_t newTick;
+
+	// where something scheduled for time goes
+	uint32_t map(uint32_t time) const {
+		int32_t after = (int32_t)(time - from);
+		if (after <= 0) return time;
+		return from + (uint32_t)((uint64_t)after * newTick / oldTick);
+	}
+};
+
+// A tempo ramp, accelerando or ritardando: from one tempo to another over a
+// number of bars, a step in tempo on every MIDI clock tick of them.
+class TempoRamp {
+	public:
+		static const int ticksPerBar = 24 * 4;		// MIDI clocks, 4/4
+
+		uint16_t target;		// BPM
+		uint8_t bars;			// 1 - 16
+
+		TempoRamp();
+		void start(float from);		// to target over bars
+		void stop() { left = 0; }
+		bool active() { return left > 0; }
+
+		// a clock tick went by while active(), the tempo from it on
+		float tick();
+
+	private:
+		float startBpm;
+		int total;				// clock ticks
+		int left;
+};
+
+extern TempoRamp tempoRamp;
@@ -0,0 +1,29 @@
+#pragma once
+
+// Host keypad - key events are queued by host::pressKey() / host::releaseKey()
+
+#include <Arduino.h>
+
+#define KEY_JUST_RELEASED 0
+#define KEY_JUST_PRESSED 1
+
+#define makeKeymap(x) ((char*)x)
+
+union keypadEvent {
+	struct {
+		uint8_t KEY : 8;
+		uint8_t EVENT : 8;
+		uint8_t ROW : 8;
+		uint8_t COL : 8;
+	} bit;
+	uint32_t reg;
+};
+
+class Adafruit_Keypad {
+	public:
+		Adafruit_Keypad(char*, byte*, byte*, int, int) {}
+		void begin() {}
+		void tick() {}
+		bool available();
+		keypadEvent read();
+};
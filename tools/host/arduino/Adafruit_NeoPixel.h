@@ -0,0 +1,32 @@
+#pragma once
+
+// Host LED strip - keeps the colors so a test can look at them, show() does nothing
+
+#include <Arduino.h>
+
+#define NEO_GRB 0x52
+#define NEO_KHZ800 0x0000
+
+class Adafruit_NeoPixel {
+	public:
+		Adafruit_NeoPixel(uint16_t n, int16_t, int) : count(n < maxPixels ? n : maxPixels) { memset(pixels, 0, sizeof(pixels)); }
+		void begin() {}
+		void show() {}
+		void setBrightness(uint8_t) {}
+		void setPixelColor(uint16_t n, uint32_t c) { if (n < count) pixels[n] = c; }
+		uint32_t getPixelColor(uint16_t n) const { return n < count ? pixels[n] : 0; }
+		void fill(uint32_t c = 0, uint16_t first = 0, uint16_t n = 0) {
+			for (uint16_t i = first; i < count && (n == 0 || i < first + n); ++i) pixels[i] = c;
+		}
+		uint16_t numPixels() const { return count; }
+		bool canShow() { return true; }
+
+		static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+		static uint32_t ColorHSV(uint16_t hue, uint8_t = 255, uint8_t = 255) { return hue; }
+		static uint32_t gamma32(uint32_t c) { return c; }
+
+	private:
+		static const uint16_t maxPixels = 64;
+		uint16_t count;
+		uint32_t pixels[maxPixels];
+};
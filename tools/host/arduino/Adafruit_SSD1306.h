@@ -0,0 +1,39 @@
+#pragma once
+
+// Host OLED - drawing calls are accepted and dropped
+
+#include <Arduino.h>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define BLACK SSD1306_BLACK
+#define WHITE SSD1306_WHITE
+#define INVERSE SSD1306_INVERSE
+#define SSD1306_SWITCHCAPVCC 0x02
+
+class Adafruit_SSD1306 : public Print {
+	public:
+		bool begin(uint8_t = SSD1306_SWITCHCAPVCC, uint8_t = 0) { return true; }
+		void clearDisplay() {}
+		void display() {}
+		void cp437(bool = true) {}
+		void setRotation(uint8_t) {}
+		void fillRect(int16_t, int16_t, int16_t, int16_t, uint16_t) {}
+		void drawRect(int16_t, int16_t, int16_t, int16_t, uint16_t) {}
+		void drawFastVLine(int16_t, int16_t, int16_t, uint16_t) {}
+		void drawFastHLine(int16_t, int16_t, int16_t, uint16_t) {}
+		void drawPixel(int16_t, int16_t, uint16_t) {}
+		void setCursor(int16_t, int16_t) {}
+		void setTextSize(uint8_t) {}
+		void setTextColor(uint16_t) {}
+		void setTextWrap(bool) {}
+		void setFont(const void* = nullptr) {}
+		void invertDisplay(bool) {}
+		void dim(bool) {}
+		int16_t width() const { return 128; }
+		int16_t height() const { return 32; }
+
+		size_t write(uint8_t) { return 1; }
+		using Print::write;
+};
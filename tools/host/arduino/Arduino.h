@@ -0,0 +1,134 @@
+#pragma once
+
+// Host stand-in for the parts of the Teensy core the sketch uses, so the
+// firmware can run on Linux against a virtual clock (see host.h).
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define A10 34
+#define A14 40
+
+#define F_CPU 96000000
+
+#define __disable_irq()
+#define __enable_irq()
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(int pin, int mode);
+int digitalRead(int pin);
+void digitalWrite(int pin, int value);
+int analogRead(int pin);
+void analogWrite(int pin, int value);
+void analogReadResolution(int bits);
+void analogWriteResolution(int bits);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+template<class T, class A, class B>
+T constrain(T x, A lo, B hi) { return x < lo ? lo : (x > hi ? hi : x); }
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+char* itoa(int value, char* buf, int radix);
+
+
+class Print {
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t b) = 0;
+		virtual size_t write(const uint8_t* buf, size_t len);
+		size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+		size_t print(const char* s) { return write(s); }
+		size_t print(char c) { return write((uint8_t)c); }
+		size_t print(int n) { return printf("%d", n); }
+		size_t print(unsigned int n) { return printf("%u", n); }
+		size_t print(long n) { return printf("%ld", n); }
+		size_t print(unsigned long n) { return printf("%lu", n); }
+		size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+
+		size_t println() { return write("\r\n"); }
+		template<class T> size_t println(T v) { size_t n = print(v); return n + println(); }
+		size_t println(double v, int digits) { size_t n = print(v, digits); return n + println(); }
+
+		size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+		void flush() {}
+};
+
+class Stream : public Print {
+	public:
+		virtual int available() = 0;
+		virtual int read() = 0;
+};
+
+// USB serial - output is collected by the host, input is whatever the host queued
+class usb_serial_class : public Stream {
+	public:
+		void begin(long) {}
+		operator bool();
+		size_t write(uint8_t b);
+		size_t write(const uint8_t* buf, size_t len);
+		using Print::write;
+		int available();
+		int read();
+		int availableForWrite() { return 4096; }
+};
+
+extern usb_serial_class Serial;
+
+
+// elapsedMillis / elapsedMicros as in the Teensy core, running on host time
+class elapsedMillis {
+	public:
+		elapsedMillis(unsigned long v = 0) { ms = millis() - v; }
+		operator unsigned long() const { return millis() - ms; }
+		elapsedMillis& operator=(unsigned long v) { ms = millis() - v; return *this; }
+		elapsedMillis& operator+=(unsigned long v) { ms -= v; return *this; }
+		elapsedMillis& operator-=(unsigned long v) { ms += v; return *this; }
+	private:
+		unsigned long ms;
+};
+
+class elapsedMicros {
+	public:
+		elapsedMicros(unsigned long v = 0) { us = micros() - v; }
+		operator unsigned long() const { return micros() - us; }
+		elapsedMicros& operator=(unsigned long v) { us = micros() - v; return *this; }
+		elapsedMicros& operator+=(unsigned long v) { us -= v; return *this; }
+		elapsedMicros& operator-=(unsigned long v) { us += v; return *this; }
+	private:
+		unsigned long us;
+};
+
+// callbacks fire from host::advance() when their time comes round
+class IntervalTimer {
+	public:
+		~IntervalTimer() { end(); }
+		bool begin(void (*callback)(), unsigned long microseconds);
+		bool begin(void (*callback)(), int microseconds) { return begin(callback, (unsigned long)microseconds); }
+		bool begin(void (*callback)(), float microseconds);
+		void update(unsigned long microseconds);
+		void update(float microseconds);
+		void end();
+		void priority(uint8_t) {}
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+// Host EEPROM - 2K of RAM, loaded from / saved to an image file by the host.
+// Like Teensy's, write() and update() both skip bytes that already hold the
+// value, and only the bytes actually programmed count towards
+// host::cutPowerAfter().
+
+#include <Arduino.h>
+#include "host.h"
+
+#define E2END 2047
+
+class EEPROMClass {
+	public:
+		EEPROMClass() { memset(data, 0xFF, sizeof(data)); }		// erased
+		uint8_t read(int address) { return data[address]; }
+		void write(int address, uint8_t value) {
+			if (data[address] == value) return;
+			if (writesLeft == 0) throw host::PowerCut();
+			if (writesLeft > 0) writesLeft--;
+			data[address] = value;
+			writes++;
+		}
+		void update(int address, uint8_t value) { write(address, value); }
+		uint16_t length() { return E2END + 1; }
+
+		template<class T> T& get(int address, T& t) {
+			memcpy(&t, data + address, sizeof(T));
+			return t;
+		}
+		template<class T> const T& put(int address, const T& t) {
+			const uint8_t* p = (const uint8_t*)&t;
+			for (size_t i = 0; i < sizeof(T); ++i) write(address + i, p[i]);
+			return t;
+		}
+
+		uint8_t data[E2END + 1];
+		long writes = 0;		// bytes programmed since power on
+		long writesLeft = -1;	// before the power goes, -1 = it stays on
+};
+
+extern EEPROMClass EEPROM;
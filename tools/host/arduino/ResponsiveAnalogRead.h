@@ -0,0 +1,17 @@
+#pragma once
+
+// Host pot smoothing - passes values straight through
+
+class ResponsiveAnalogRead {
+	public:
+		ResponsiveAnalogRead(int, bool, float = 0.01) : value(0), changed(false) {}
+		void update(int raw) { changed = raw != value; value = raw; }
+		int getValue() { return value; }
+		bool hasChanged() { return changed; }
+		void setAnalogResolution(int) {}
+		void setActivityThreshold(float) {}
+
+	private:
+		int value;
+		bool changed;
+};
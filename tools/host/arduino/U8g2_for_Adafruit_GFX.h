@@ -0,0 +1,27 @@
+#pragma once
+
+// Host u8g2 font renderer - text goes nowhere, widths are a fixed 6 pixels a glyph
+
+#include <Arduino.h>
+
+#define u8g2_font_5x8_tf 0
+#define u8g2_font_7x14B_tf 0
+#define u8g2_font_9x15_m_symbols 0
+#define u8g2_font_cu12_h_symbols 0
+#define u8g2_font_tenfatguys_tf 0
+#define u8g2_font_helvB18_tr 0
+
+class U8G2_FOR_ADAFRUIT_GFX : public Print {
+	public:
+		template<class Display> void begin(Display&) {}
+		void setFontMode(uint8_t) {}
+		void setFont(int) {}
+		void setCursor(int16_t, int16_t) {}
+		void setForegroundColor(uint8_t) {}
+		void setBackgroundColor(uint8_t) {}
+		int16_t getUTF8Width(const char* s) { return 6 * strlen(s); }
+		int8_t getFontAscent() { return 8; }
+
+		size_t write(uint8_t) { return 1; }
+		using Print::write;
+};
@@ -0,0 +1,1908 @@
+// Timing benchmark / regression suite for the step engine, on the host simulator.
+//
+//   omx_bench [--golden DIR] [--update] [--json results.json] [--patterns dump.syx] [scenario ...]
+//
+// Each scenario sets up patterns, plays them with loop() running every
+// loopMicros of virtual time, and reports:
+//  - dispatch error (sent - due) p50 / p99 / max per event type, from the
+//    firmware's own timing trace (built with TRACE_TIMING 1)
+//  - missed steps (steps that never came round), dropped notes (steps that
+//    played but sent no note on) and stuck notes (note ons never turned off)
+//  - whether the MIDI stream matches golden/<scenario>.txt
+//  - for seeded scenarios, whether a second pass after a reset plays the same
+//    notes again
+//  - host time and time stamp counter cycles per doStep() call over another bar, called 16 times per
+//    loopMicros so most calls find nothing due, as on the unit where loop()
+//    comes round every few microseconds (the S2 sweep without the UI)
+// and how fast the sketch's random numbers are next to rand() % n. Each
+// scenario's patterns, a blank set and any --patterns dumps (.syx files saved
+// from a unit with browser_test/sysex.html) are also run through the compact
+// bank / SysEx format for its size and encode / decode time. The pattern edit
+// journal is filled with saved edits and replayed at a reboot. A song of two
+// banks is played in S1 and S2 to check every slot starts on its bar with no
+// step lost or doubled, and to time a slot change. A SysEx load is sent
+// while a bank waits for the bar and while a song reads its next bank, and
+// must arrive whole with neither swapped in over it. Two grooved patterns with
+// nudged steps check every note lands on its step's time plus its offset,
+// early ones included. Patterns at five rates play through tempo ramps and a
+// tempo change between ticks, checking every step stays on the clock's tick
+// grid. MIDI time code goes out through stalls and back to zero on a reset,
+// and is chased through a jump, checking every quarter frame's time and every
+// chased note's step. The first line is what the build's pattern dimensions cost in RAM, EEPROM and bank
+// flash, build with -DNUM_PATTERNS / -DNUM_STEPS (make variants) to compare.
+// Results go to stdout and, with --json, to a file for tracking trends.
+// --update rewrites the golden files. Exit status is 1 if any stream changed,
+// a seeded scenario didn't repeat or the song or a SysEx load went wrong.
+//
+// Every scenario runs in a forked child, so each one starts from the sketch's
+// power-on state.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "host.h"
+#include "sketch_api.h"
+#include "../trace_decode/trace_reader.h"
+#include "../../rng.h"
+#include "../../groove.h"
+#include "../../mtc.h"
+
+#if !TRACE_TIMING
+#error omx_bench needs TRACE_TIMING 1
+#endif
+
+namespace {
+	const int PPQ = 96;
+	const int codecRepeats = 200;
+	const int MODE_MIDI = 0;
+	const int MODE_S1 = 1;
+	const int MODE_S2 = 2;
+	const int STEPTYPE_RANDSTEP = 5;
+	const float multValues[] = { .25, .5, 1, 2, 4, 8, 16 };		// as config.h
+
+	// the CPU's time stamp counter, which ticks at a fixed rate whatever the clock
+	uint64_t cycleCount() {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return 0;
+#endif
+	}
+
+	struct Scenario {
+		const char* name;
+		const char* description;
+		float bpm;
+		int bars;
+		uint32_t loopMicros;
+		int clockDiv;		// multValues index
+		int swing;
+		int noteLen;		// steps
+		bool plocks;		// every step locks all four params
+		int prob;			// every step's probability
+		bool randomSteps;	// every 4th step jumps to a random step
+		int seed;			// pattern seed, 0 = none
+		int ratchets;		// hits on every step, 1 = none
+	};
+
+	const Scenario scenarios[] = {
+		{ "all8_300bpm",  "8 patterns, every step, 1/16 at 300 BPM",        300, 2, 250, 2, 0,  0,  false, 100, false, 0, 1 },
+		{ "max_swing",    "8 patterns, swing 98",                           120, 2, 250, 2, 98, 0,  false, 100, false, 0, 1 },
+		{ "div_1_64",     "8 patterns at 1/64",                             120, 1, 250, 0, 0,  0,  false, 100, false, 0, 1 },
+		{ "long_notes",   "8 patterns, 16 step long notes",                 120, 2, 250, 2, 0,  15, false, 100, false, 0, 1 },
+		{ "plock_dense",  "8 patterns at 1/32, four p-locks on every step", 120, 1, 250, 1, 0,  0,  true,  100, false, 0, 1 },
+		{ "generative",   "8 patterns, 60% steps, random steps, drunken swing, seed 7", 120, 2, 250, 2, 99, 0, false, 60, true, 7, 1 },
+		{ "ratchet_x8",   "8 patterns, every step ratcheted x8, 1/16 at 300 BPM", 300, 2, 250, 2, 0, 0, false, 100, false, 0, 8 },
+	};
+
+	struct Percentiles {
+		long count = 0;
+		int32_t p50 = 0, p99 = 0, max = 0;
+	};
+
+	struct Result {
+		Percentiles dispatch[TRACE_CLOCK + 1];
+		long steps = 0;
+		long missedSteps = 0;
+		long droppedNotes = 0;
+		long stuckNotes = 0;
+		long misattributed = 0;		// note trace records not from the pattern on their channel
+		long traceLost = 0;
+		SketchQueueStats queues = {};
+		long midiEvents = 0;
+		double nsPerLoop = 0;
+		double nsPerStepCheck = 0;
+		double cyclesPerStepCheck = 0;		// time stamp counter, 0 where there isn't one
+		SketchCodecStats codec = {};
+		char golden[16] = "";		// match, differs, missing, updated
+		char repeats[8] = "";		// seeded scenarios: yes / no
+	};
+
+	Percentiles percentiles(std::vector<int32_t> v) {
+		Percentiles p;
+		p.count = v.size();
+		if (v.empty()) return p;
+		std::sort(v.begin(), v.end());
+		p.p50 = v[v.size() / 2];
+		p.p99 = v[v.size() - 1 - v.size() / 100];
+		p.max = v.back();
+		return p;
+	}
+
+	std::string midiText(const Scenario& s, uint64_t start) {
+		std::string text = std::string("# ") + s.name + ": " + s.description + "\n# micros since start, bytes\n";
+		char line[64];
+		for (const host::MidiEvent& e : host::midiOut()) {
+			int n = snprintf(line, sizeof(line), "%llu", (unsigned long long)(e.time - start));
+			for (int i = 0; i < e.size; ++i) n += snprintf(line + n, sizeof(line) - n, " %02X", e.data[i]);
+			text += line;
+			text += '\n';
+		}
+		return text;
+	}
+
+	bool readText(const std::string& path, std::string& text) {
+		FILE* f = fopen(path.c_str(), "rb");
+		if (!f) return false;
+		char buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+		fclose(f);
+		return true;
+	}
+
+	void compareGolden(const Scenario& s, const std::string& text, const std::string& dir, bool update, Result& r) {
+		std::string path = dir + "/" + s.name + ".txt";
+		std::string golden;
+		if (update) {
+			FILE* f = fopen(path.c_str(), "wb");
+			bool ok = f && fwrite(text.data(), 1, text.size(), f) == text.size();
+			if (f) fclose(f);
+			strcpy(r.golden, ok ? "updated" : "unwritable");
+		} else if (!readText(path, golden)) {
+			strcpy(r.golden, "missing");
+		} else if (golden == text) {
+			strcpy(r.golden, "match");
+		} else {
+			strcpy(r.golden, "differs");
+			size_t at = 0, line = 1;
+			while (at < golden.size() && at < text.size() && golden[at] == text[at]) {
+				if (golden[at++] == '\n') line++;
+			}
+			fprintf(stderr, "%s: MIDI stream differs from %s at line %zu\n", s.name, path.c_str(), line);
+		}
+	}
+
+	void run(const Scenario& s, const std::string& goldenDir, bool update, Result& r) {
+		host::seedRandom(1);
+		host::setSerialConnected(true);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_S2);
+		sketchSetTempo(s.bpm);
+		sketchSetSeed(s.seed);
+
+		for (int p = 0; p < sketchNumPatterns(); ++p) {
+			sketchSetPattern(p, { sketchNumSteps(), p + 1, s.swing, s.clockDiv, false });
+			for (int i = 0; i < sketchNumSteps(); ++i) {
+				SketchStep step = { 36 + p, 100, s.noteLen, true, { -1, -1, -1, -1 }, s.prob, 0, 0, s.ratchets, 0, 0 };
+				if (s.randomSteps) {
+					step.note = 36 + (p * 5 + i) % 24;
+					if (i % 4 == 3) step.stepType = STEPTYPE_RANDSTEP;
+				}
+				if (s.plocks) {
+					for (int q = 0; q < 4; ++q) step.params[q] = (i * 8 + q * 16 + p) & 0x7F;
+				}
+				sketchSetStep(p, i, step);
+			}
+		}
+
+		r.codec = sketchCodecStats(codecRepeats);
+
+		host::serialInput("t");		// start streaming the trace
+		sketchLoop();
+		host::serialOutput().clear();
+		host::midiOut().clear();
+
+		unsigned long ppq = sketchPpqInterval();
+		uint64_t stepMicros = (uint64_t)(ppq * (PPQ / 4) * multValues[s.clockDiv]);
+		uint64_t start = host::now();
+		uint64_t end = start + (uint64_t)s.bars * 4 * PPQ * ppq;
+		uint64_t drain = 4 * PPQ * ppq;		// one more bar for queued notes to go out
+		long loops = 0;
+
+		// play from now to until, then mute and let what's queued finish
+		auto play = [&](uint64_t until) {
+			for (int p = 0; p < sketchNumPatterns(); ++p) sketchSetMute(p, false);
+			sketchStart();
+			bool muted = false;
+			while (host::now() < until + drain) {
+				if (!muted && host::now() >= until) {
+					for (int p = 0; p < sketchNumPatterns(); ++p) sketchSetMute(p, true);
+					muted = true;
+				}
+				sketchLoop();
+				host::advance(s.loopMicros);
+				loops++;
+			}
+		};
+
+		auto wallStart = std::chrono::steady_clock::now();
+		play(end);
+		auto wallEnd = std::chrono::steady_clock::now();
+		r.nsPerLoop = std::chrono::duration<double, std::nano>(wallEnd - wallStart).count() / loops;
+		r.midiEvents = host::midiOut().size();
+
+		// notes still on before the stop's all notes off
+		int held[16][128] = {};
+		for (const host::MidiEvent& e : host::midiOut()) {
+			int kind = e.data[0] & 0xF0;
+			int ch = e.data[0] & 0x0F;
+			if (kind == 0x90 && e.data[2] > 0) held[ch][e.data[1]]++;
+			else if ((kind == 0x80 || kind == 0x90) && held[ch][e.data[1]] > 0) held[ch][e.data[1]]--;
+		}
+		long noteOns[16] = {};
+		for (const host::MidiEvent& e : host::midiOut()) {
+			if ((e.data[0] & 0xF0) == 0x90) noteOns[e.data[0] & 0x0F]++;
+		}
+		for (int ch = 0; ch < 16; ++ch)
+			for (int n = 0; n < 128; ++n) r.stuckNotes += held[ch][n];
+		r.queues = sketchQueueStats();
+
+		sketchStop();
+		sketchLoop();
+		size_t firstPass = host::midiOut().size();
+
+		if (s.seed) {
+			// a reset restarts the random streams, so the same notes should come out again
+			sketchReset();
+			play(host::now() + (end - start));
+			sketchStop();
+			sketchLoop();
+			// per channel, swing can reorder notes from different patterns against the clock,
+			// and a drunken swing can push a note past the next step's, so compare what
+			// was played rather than the order it went out in
+			std::vector<uint16_t> notes[2][16];
+			for (size_t i = 0; i < host::midiOut().size(); ++i) {
+				const host::MidiEvent& e = host::midiOut()[i];
+				if ((e.data[0] & 0xF0) == 0x90) notes[i >= firstPass][e.data[0] & 0x0F].push_back(e.data[1] << 8 | e.data[2]);
+			}
+			bool same = true;
+			for (int ch = 0; ch < 16; ++ch) {
+				std::sort(notes[0][ch].begin(), notes[0][ch].end());
+				std::sort(notes[1][ch].begin(), notes[1][ch].end());
+				if (notes[0][ch] != notes[1][ch]) same = false;
+			}
+			strcpy(r.repeats, same ? "yes" : "no");
+		}
+
+		TraceReader trace;
+		const std::string& serial = host::serialOutput();
+		trace.parse((const uint8_t*)serial.data(), serial.size());
+		r.traceLost = trace.lost;
+
+		std::vector<int32_t> late[TRACE_CLOCK + 1];
+		long steps[16] = {};
+		for (const TracedEvent& e : trace.events) {
+			if ((uint64_t)e.due < start || (uint64_t)e.due >= end + drain) continue;
+			if (e.event <= TRACE_CLOCK) late[e.event].push_back(e.late());
+			if (e.event == TRACE_STEP && (uint64_t)e.due < end && e.pattern < 16) steps[e.pattern]++;
+			if ((e.event == TRACE_NOTE_ON || e.event == TRACE_NOTE_OFF) && e.pattern != e.channel - 1) r.misattributed++;
+		}
+		for (int t = TRACE_STEP; t <= TRACE_CLOCK; ++t) r.dispatch[t] = percentiles(late[t]);
+
+		long expected = (end - start + stepMicros - 1) / stepMicros;
+		for (int p = 0; p < sketchNumPatterns(); ++p) {
+			r.steps += steps[p];
+			r.missedSteps += std::max(0L, expected - steps[p]);
+			if (s.prob == 100) {
+				r.droppedNotes += std::max(0L, steps[p] * s.ratchets - noteOns[p]);		// pattern p plays on channel p + 1
+			}
+		}
+
+		compareGolden(s, midiText(s, start), goldenDir, update, r);
+
+		const int checksPerTick = 16;
+		uint64_t sweepEnd = host::now() + 4 * PPQ * ppq;
+		long checks = 0;
+		sketchStart();
+		uint64_t cycles = 0;
+		auto sweepStart = std::chrono::steady_clock::now();
+		while (host::now() < sweepEnd) {
+			uint64_t c0 = cycleCount();
+			for (int i = 0; i < checksPerTick; ++i) sketchDoStep();
+			cycles += cycleCount() - c0;
+			checks += checksPerTick;
+			host::advance(s.loopMicros);
+		}
+		auto sweepStop = std::chrono::steady_clock::now();
+		r.nsPerStepCheck = std::chrono::duration<double, std::nano>(sweepStop - sweepStart).count() / checks;
+		r.cyclesPerStepCheck = (double)cycles / checks;
+	}
+
+	const char* typeNames[] = { "", "step", "note_on", "note_off", "clock" };
+
+	// ns per draw of a number below n, the sketch's generator against rand() % n
+	void rngSpeed(double& rng, double& libc) {
+		const int draws = 10000000;
+		volatile uint32_t sink = 0;
+		Rng r;
+		r.seed(1, 0);
+		auto t0 = std::chrono::steady_clock::now();
+		for (int i = 0; i < draws; ++i) sink = sink + r.range(16 + (i & 7));
+		auto t1 = std::chrono::steady_clock::now();
+		for (int i = 0; i < draws; ++i) sink = sink + rand() % (16 + (i & 7));
+		auto t2 = std::chrono::steady_clock::now();
+		rng = std::chrono::duration<double, std::nano>(t1 - t0).count() / draws;
+		libc = std::chrono::duration<double, std::nano>(t2 - t1).count() / draws;
+	}
+
+	// runs body in a forked child, so it starts from the sketch's power-on state
+	template <typename T, typename F>
+	bool inChild(T& out, F body) {
+		int fds[2];
+		if (pipe(fds) != 0) return false;
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(fds[0]);
+			T r;
+			bool ok = body(r);
+			ssize_t n = write(fds[1], &r, sizeof(r));
+			_exit(ok && n == sizeof(r) ? 0 : 1);
+		}
+		close(fds[1]);
+		ssize_t n = read(fds[0], &out, sizeof(T));
+		close(fds[0]);
+		int status = 0;
+		waitpid(pid, &status, 0);
+		return n == sizeof(T) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+
+	bool readFile(const char* path, std::vector<uint8_t>& data) {
+		FILE* f = fopen(path, "rb");
+		if (!f) return false;
+		uint8_t buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+		fclose(f);
+		return true;
+	}
+
+	// a blank set (path = nullptr) or a dump sent through the unit's SysEx loader
+	bool codecRun(const char* path, SketchCodecStats& c) {
+		host::seedRandom(1);
+		sketchSetup();
+		sketchEndBoot();
+		if (path) {
+			std::vector<uint8_t> data;
+			if (!readFile(path, data)) {
+				fprintf(stderr, "can't read %s\n", path);
+				return false;
+			}
+			size_t start = 0;
+			for (size_t i = 0; i < data.size(); ++i) {
+				if (data[i] == 0xF0) start = i;
+				if (data[i] == 0xF7) {
+					host::sysExIn(&data[start], i + 1 - start);
+					sketchLoop();
+				}
+			}
+			for (int i = 0; i < 10; ++i) sketchLoop();
+		}
+		c = sketchCodecStats(codecRepeats);
+		return true;
+	}
+
+	// the pattern edit journal filled a saved edit at a time, then a reboot:
+	// every edit comes back, and the boot's replay of the full journal is timed
+	const int journalRepeats = 2000;
+
+	struct JournalResult {
+		int saves;
+		int used;				// bytes of the journal
+		int capacity;
+		int records;			// replayed at boot
+		bool sameAfterBoot;
+		double nsReplay;		// host time
+		uint32_t checksum;		// the patterns as saved
+	};
+
+	bool journalFill(const char* dir, JournalResult& r) {
+		if (chdir(dir) != 0) return false;		// the save writes a bank file too
+		host::eraseEEPROM();
+		host::seedRandom(1);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSave();
+		r = {};
+		SketchJournalStats s = sketchJournalReplay(1);
+		r.capacity = s.capacity;
+		if (r.capacity == 0) return true;		// patterns in the bank files
+		int record = 0;
+		for (int used = s.used; ; ++r.saves) {
+			int p = r.saves % sketchNumPatterns();
+			int step = (r.saves / sketchNumPatterns()) % sketchNumSteps();
+			sketchSetStep(p, step, { 36 + r.saves % 61, 1 + r.saves % 127, r.saves % 16, true, { -1, r.saves % 128, -1, -1 }, 100, 0, 0 });
+			sketchSave();
+			s = sketchJournalReplay(1);
+			if (s.used < used) return false;		// it folded, the journal was full already
+			record = std::max(record, s.used - used);
+			used = s.used;
+			if (used + record > s.capacity) break;
+		}
+		r.saves++;
+		r.used = s.used;
+		r.checksum = sketchPatternChecksum();
+		return host::saveEEPROM("eeprom.bin");
+	}
+
+	bool journalBoot(const char* dir, JournalResult& r) {
+		if (chdir(dir) != 0 || !host::loadEEPROM("eeprom.bin")) return false;
+		host::seedRandom(1);
+		sketchSetup();
+		r.sameAfterBoot = sketchPatternChecksum() == r.checksum;
+		SketchJournalStats s = sketchJournalReplay(journalRepeats);
+		r.records = s.records;
+		r.nsReplay = s.nsReplay;
+		return true;
+	}
+
+	bool journalRun(JournalResult& r) {
+		char dir[] = "/tmp/omx_bench_XXXXXX";
+		if (!mkdtemp(dir)) return false;
+		if (!inChild(r, [&](JournalResult& f) { return journalFill(dir, f); })) return false;
+		if (r.capacity == 0) return true;
+		JournalResult booted;
+		if (!inChild(booted, [&](JournalResult& b) { b = r; return journalBoot(dir, b); })) return false;
+		r = booted;
+		return true;
+	}
+
+	bool journalOk(const JournalResult& r) {
+		return r.capacity == 0 || (r.sameAfterBoot && r.records >= r.saves && r.used * 10 >= r.capacity * 9);
+	}
+
+	void printJournal(const JournalResult& r) {
+		if (r.capacity == 0) {
+			printf("journal      not used, the patterns are in the bank files\n");
+			return;
+		}
+		printf("journal      %d saves fill %d of %d bytes  boot replays %d records in %.1f us (host)  %s%s\n",
+			r.saves, r.used, r.capacity, r.records, r.nsReplay / 1000, r.sameAfterBoot ? "all back after reboot" : "DIFFERENT after reboot",
+			journalOk(r) ? "" : "  WRONG");
+	}
+
+	// song mode over two bank files, pattern p plays note base + p on channel p + 1
+	struct SongSlot {
+		int bank, pattern, bars;
+	};
+	const SongSlot songSlots[] = { { 0, 0, 2 }, { 0, 1, 1 }, { 1, 1, 1 }, { 1, 0, 2 } };
+	const int songBars = 12;		// twice through
+	const int bankNote[2] = { 36, 60 };
+
+	struct SongResult {
+		long notes;
+		long wrong;			// not the slot's pattern or bank
+		long missing;		// steps the slot's patterns didn't play
+		long doubled;
+		long stuck;			// note ons not turned off within two steps
+		int lateBars;		// slots held back waiting for a bank
+		double nsSwap;		// bank changing slot change, host time
+	};
+
+	bool songRun(int mode, SongResult& r) {
+		// bank files go in the working directory, keep them out of the tree
+		char dir[] = "/tmp/omx_bench_XXXXXX";
+		if (!mkdtemp(dir) || chdir(dir) != 0) return false;
+
+		host::seedRandom(1);
+		host::setSerialConnected(true);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(mode);
+		sketchSetTempo(120);
+		int steps = 16;
+		for (int bank = 0; bank < 2; ++bank) {
+			for (int p = 0; p < sketchNumPatterns(); ++p) {
+				sketchSetPattern(p, { steps, p + 1, 0, 2, false });
+				for (int i = 0; i < sketchNumSteps(); ++i) {
+					sketchSetStep(p, i, { bankNote[bank] + p, 100, 0, true, { -1, -1, -1, -1 }, 100, 0, 0 });
+				}
+			}
+			sketchSaveBank(bank);
+		}
+		int slots = sizeof(songSlots) / sizeof(songSlots[0]);
+		std::vector<const SongSlot*> barSlot;
+		for (int i = 0; i < slots; ++i) {
+			sketchSetSongSlot(i, songSlots[i].bank, songSlots[i].pattern, songSlots[i].bars);
+			for (int b = 0; b < songSlots[i].bars; ++b) barSlot.push_back(&songSlots[i]);
+		}
+		sketchSongEnable(true);
+		sketchLoop();
+		host::midiOut().clear();
+
+		unsigned long ppq = sketchPpqInterval();
+		uint64_t stepMicros = ppq * (PPQ / 4);
+		uint64_t barMicros = stepMicros * steps;
+		uint64_t start = host::now();
+		uint64_t end = start + songBars * barMicros;
+		sketchStart();
+		while (host::now() < end + 2 * stepMicros) {
+			sketchLoop();
+			host::advance(250);
+		}
+
+		// (bar, step, channel) -> note ons
+		std::vector<int> played(songBars * steps * 16);
+		std::vector<host::MidiEvent>& out = host::midiOut();
+		r = {};
+		for (size_t i = 0; i < out.size(); ++i) {
+			const host::MidiEvent& e = out[i];
+			if ((e.data[0] & 0xF0) != 0x90 || e.data[2] == 0 || e.time >= end) continue;
+			int ch = e.data[0] & 0x0F;
+			int bar = (e.time - start) / barMicros;
+			int step = (e.time - start) % barMicros / stepMicros;
+			const SongSlot* slot = barSlot[bar % barSlot.size()];
+			bool expected = mode == MODE_S2 || ch == slot->pattern;
+			if (!expected || e.data[1] != bankNote[slot->bank] + ch) r.wrong++;
+			played[(bar * steps + step) * 16 + ch]++;
+			r.notes++;
+
+			bool off = false;
+			for (size_t j = i + 1; j < out.size() && out[j].time <= e.time + 2 * stepMicros && !off; ++j) {
+				off = (out[j].data[0] & 0x0F) == ch && out[j].data[1] == e.data[1]
+					&& ((out[j].data[0] & 0xF0) == 0x80 || ((out[j].data[0] & 0xF0) == 0x90 && out[j].data[2] == 0));
+			}
+			if (!off) r.stuck++;
+		}
+		for (int bar = 0; bar < songBars; ++bar) {
+			const SongSlot* slot = barSlot[bar % barSlot.size()];
+			for (int step = 0; step < steps; ++step) {
+				for (int ch = 0; ch < sketchNumPatterns(); ++ch) {
+					int n = played[(bar * steps + step) * 16 + ch];
+					bool expected = mode == MODE_S2 || ch == slot->pattern;
+					if (expected && n == 0) r.missing++;
+					if (n > 1) r.doubled += n - 1;
+				}
+			}
+		}
+		r.lateBars = sketchSongLateBars();
+		sketchStop();
+		r.nsSwap = sketchSongSwapNs(codecRepeats);
+
+		unlink("bank00.omx");
+		unlink("bank01.omx");
+		rmdir(dir);
+		return true;
+	}
+
+	bool songOk(const SongResult& r) {
+		return r.wrong == 0 && r.missing == 0 && r.doubled == 0 && r.stuck == 0 && r.lateBars == 0;
+	}
+
+	void printSong(int mode, const SongResult& r) {
+		printf("song %s      notes %4ld wrong %ld missing %ld doubled %ld stuck %ld late bars %d  slot change %.0f ns%s\n",
+			mode == MODE_S1 ? "S1" : "S2", r.notes, r.wrong, r.missing, r.doubled, r.stuck, r.lateBars, r.nsSwap,
+			songOk(r) ? "" : "  WRONG");
+	}
+
+	// A SysEx load sent while a bank waits in the shadow copy for the bar, then
+	// again while a song reads the next slot's bank. One message goes a bar, in
+	// the last loop pass before the bar starts, where a bank change would land
+	// on it. The load must come through whole and no bank may be swapped in
+	// over it. The dump is every step set, and different, and the unit's side
+	// of a dump and a load is timed
+	const int sysExNote[3] = { 36, 60, 84 };		// bank 0, bank 1, the dump
+
+	struct SysExResult {
+		int messages;
+		long bytes;
+		bool loaded[2];		// the live patterns were the dump's once it was in
+		long wrong;			// notes from neither bank nor the dump, or from bank 1 in the first load
+		int ackPasses;		// most loop passes from a message coming in to its answer going out
+		double nsDump;		// host time
+		double nsMessage;	// a load's, per message
+	};
+
+	// the dump as sent, a message each
+	std::vector<std::vector<uint8_t>> sysExMessages(const std::vector<uint8_t>& data) {
+		std::vector<std::vector<uint8_t>> messages;
+		size_t start = 0;
+		for (size_t i = 0; i < data.size(); ++i) {
+			if (data[i] == 0xF0) start = i;
+			if (data[i] == 0xF7) messages.emplace_back(data.begin() + start, data.begin() + i + 1);
+		}
+		return messages;
+	}
+
+	void sysExPlay(uint64_t micros) {
+		uint64_t end = host::now() + micros;
+		while (host::now() < end) {
+			sketchLoop();
+			host::advance(250);
+		}
+	}
+
+	// sends the load a message a bar from playing at start, then plays until it's in
+	bool sysExLoad(const std::vector<std::vector<uint8_t>>& messages, uint64_t start, uint64_t barMicros, uint32_t expected, SysExResult& r) {
+		for (const std::vector<uint8_t>& m : messages) {
+			uint64_t bar = start + ((host::now() - start) / barMicros + 1) * barMicros;
+			sysExPlay(bar - 250 - host::now());
+			host::sysExIn(m.data(), m.size());
+			size_t sent = host::sysExOut().size();
+			int passes = 0;
+			while (host::sysExOut().size() == sent && passes < 100) {
+				sketchLoop();
+				host::advance(250);
+				passes++;
+			}
+			r.ackPasses = std::max(r.ackPasses, passes);
+		}
+		// taken between steps, look before the song's next bar can change it
+		for (uint64_t end = host::now() + barMicros; host::now() < end; host::advance(250)) {
+			sketchLoop();
+			if (sketchPatternChecksum() == expected) return true;
+		}
+		return false;
+	}
+
+	bool sysExRun(SysExResult& r) {
+		char dir[] = "/tmp/omx_bench_XXXXXX";
+		if (!mkdtemp(dir) || chdir(dir) != 0) return false;
+
+		host::seedRandom(1);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_S2);
+		sketchSetTempo(120);
+		int steps = 16;
+		for (int set = 0; set < 3; ++set) {
+			for (int p = 0; p < sketchNumPatterns(); ++p) {
+				sketchSetPattern(p, { steps, p + 1, 0, 2, false });
+				for (int i = 0; i < sketchNumSteps(); ++i) {
+					SketchStep step = { sysExNote[set] + p, 100, 0, true, { -1, -1, -1, -1 }, 100, 0, 0 };
+					if (set == 2) {
+						int k = p * sketchNumSteps() + i;
+						step.vel = 1 + k * 37 % 127;
+						step.len = k % 16;
+						for (int q = 0; q < 4; ++q) step.params[q] = (k * 11 + q * 29) % 129 - 1;
+						step.nudge = k % 25 - 12;
+					}
+					sketchSetStep(p, i, step);
+				}
+			}
+			if (set < 2) sketchSaveBank(set);
+		}
+		host::sysExOut().clear();
+		sketchSendDump();
+		std::vector<std::vector<uint8_t>> messages = sysExMessages(host::sysExOut());
+		uint32_t expected = sketchPatternChecksum();
+		r = {};
+		r.messages = messages.size();
+		r.bytes = host::sysExOut().size();
+
+		uint64_t barMicros = sketchPpqInterval() * (PPQ / 4) * steps;
+		sketchSelectBank(0);
+		sysExPlay(barMicros / 4);		// stopped, so it's live as soon as it's read
+		host::midiOut().clear();
+
+		// bank 1 read and waiting for the bar when the load starts
+		uint64_t start = host::now();
+		sketchStart();
+		sketchSelectBank(1);
+		while (!sketchBankPending() && host::now() < barMicros) {
+			sketchLoop();
+			host::advance(250);
+		}
+		r.loaded[0] = sketchBankPending() && sysExLoad(messages, start, barMicros, expected, r);
+		sysExPlay(barMicros);
+		for (const host::MidiEvent& e : host::midiOut()) {
+			int ch = e.data[0] & 0x0F;
+			if ((e.data[0] & 0xF0) == 0x90 && e.data[2] > 0 && e.data[1] != sysExNote[0] + ch && e.data[1] != sysExNote[2] + ch) r.wrong++;
+		}
+		sketchStop();
+
+		// a song on both banks, its next slot's bank preloading on every bar
+		sketchSelectBank(1);
+		sysExPlay(barMicros / 4);
+		sketchSetSongSlot(0, 1, 0, 1);
+		sketchSetSongSlot(1, 0, 0, 1);
+		sketchSongEnable(true);
+		sketchLoop();
+		host::midiOut().clear();
+		start = host::now();
+		sketchStart();
+		sysExPlay(barMicros);
+		r.loaded[1] = sysExLoad(messages, start, barMicros, expected, r);
+		sketchStop();
+		for (const host::MidiEvent& e : host::midiOut()) {
+			int ch = e.data[0] & 0x0F;
+			bool known = false;
+			for (int note : sysExNote) known = known || e.data[1] == note + ch;
+			if ((e.data[0] & 0xF0) == 0x90 && e.data[2] > 0 && !known) r.wrong++;
+		}
+
+		std::vector<uint8_t> dump;
+		for (const std::vector<uint8_t>& m : messages) dump.insert(dump.end(), m.begin(), m.end());
+		r.nsDump = sketchDumpNs(codecRepeats);
+		r.nsMessage = sketchLoadNs(dump.data(), dump.size(), codecRepeats);
+
+		unlink("bank00.omx");
+		unlink("bank01.omx");
+		rmdir(dir);
+		return true;
+	}
+
+	bool sysExOk(const SysExResult& r) {
+		return r.messages > 0 && r.loaded[0] && r.loaded[1] && r.wrong == 0 && r.ackPasses == 1;
+	}
+
+	void printSysEx(const SysExResult& r) {
+		printf("sysex load   %d messages %ld bytes, over a bank switch %s, over a song %s, wrong notes %ld%s\n",
+			r.messages, r.bytes, r.loaded[0] ? "ok" : "LOST", r.loaded[1] ? "ok" : "LOST", r.wrong,
+			sysExOk(r) ? "" : "  WRONG");
+		printf("sysex time   dump %.1f us (%.1f MB/s), load %.2f us/message (%.1f MB/s), answered within %d loop pass%s (host)\n",
+			r.nsDump / 1000, r.bytes / r.nsDump * 1000, r.nsMessage / 1000, r.bytes / (r.nsMessage * r.messages) * 1000,
+			r.ackPasses, r.ackPasses == 1 ? "" : "es");
+	}
+
+	// CC automation: pot 0 swept over the first bar and pot 1 over the second
+	// while recording, then both lanes played back for two bars. The lane
+	// values are checked against the CCs the pots sent live at the same place
+	// in the bar.
+	const int laneBars = 4;
+
+	struct LaneResult {
+		SketchLaneStats stats;
+		long recorded;		// CCs the pots sent while recording
+		long played;		// CCs the lanes sent
+		int maxError;		// against the live value at the same point in the bar
+		double meanError;
+	};
+
+	int laneSweep(int pot, double phase) {
+		double v = pot == 0 ? 1 - fabs(2 * phase - 1) : 0.5 - 0.5 * cos(2 * M_PI * phase);
+		return (int)(v * 8190);
+	}
+
+	bool laneRun(LaneResult& r) {
+		host::seedRandom(1);
+		host::setSerialConnected(true);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_S1);
+		sketchSetTempo(120);
+		int steps = 16;
+		sketchSetPattern(0, { steps, 1, 0, 2, false });
+		sketchLoop();
+		host::midiOut().clear();
+
+		unsigned long ppq = sketchPpqInterval();
+		uint64_t stepMicros = ppq * (PPQ / 4);
+		uint64_t barMicros = stepMicros * steps;
+		uint64_t start = host::now();
+		uint64_t end = start + laneBars * barMicros;
+		sketchStart();
+		for (int pot = 0; pot < 2; ++pot) {
+			sketchSetCCRecord(true);
+			while (host::now() < start + (pot + 1) * barMicros - stepMicros / 2) {
+				double phase = (double)((host::now() - start) % barMicros) / barMicros;
+				host::setAnalog(sketchPotPin(pot), laneSweep(pot, phase));
+				sketchLoop();
+				host::advance(250);
+			}
+			sketchSetCCRecord(false);
+			while (host::now() < start + (pot + 1) * barMicros) {
+				sketchLoop();
+				host::advance(250);
+			}
+		}
+		while (host::now() < end) {
+			sketchLoop();
+			host::advance(250);
+		}
+
+		// live values by time into the bar, then what the lanes played against them
+		std::vector<host::MidiEvent>& out = host::midiOut();
+		std::vector<std::pair<uint64_t, int>> live[2];
+		r = {};
+		long errorSum = 0;
+		for (int pass = 0; pass < 2; ++pass) {
+			for (const host::MidiEvent& e : out) {
+				if ((e.data[0] & 0xF0) != 0xB0 || e.time >= end) continue;
+				int pot = e.data[1] == sketchPotCC(0) ? 0 : e.data[1] == sketchPotCC(1) ? 1 : -1;
+				if (pot < 0) continue;
+				int bar = (e.time - start) / barMicros;
+				uint64_t into = (e.time - start) % barMicros;
+				if (pass == 0 && bar == pot) {
+					live[pot].push_back({ into, e.data[2] });
+					r.recorded++;
+				} else if (pass == 1 && bar > pot) {
+					int expected = live[pot].empty() ? 0 : live[pot][0].second;
+					for (const auto& l : live[pot]) {
+						if (l.first <= into) expected = l.second;
+					}
+					int error = abs(e.data[2] - expected);
+					if (error > r.maxError) r.maxError = error;
+					errorSum += error;
+					r.played++;
+				}
+			}
+		}
+		r.meanError = r.played ? (double)errorSum / r.played : 0;
+		sketchStop();
+		r.stats = sketchLaneStats(0, codecRepeats);
+		return true;
+	}
+
+	// a step's lane values are a quarter step apart, so a fast sweep can be
+	// a few values off between them
+	bool laneOk(const LaneResult& r) {
+		return r.stats.lanes == 2 && r.played > 0 && r.maxError <= 8;
+	}
+
+	void printLanes(const LaneResult& r) {
+		printf("cc lanes     %d lanes, %d points in %d bytes (pool %d of %d)  recorded %ld played %ld  error max %d mean %.1f  %.0f ns/step%s\n",
+			r.stats.lanes, r.stats.points, r.stats.bytes, r.stats.poolUsed, r.stats.poolSize, r.recorded, r.played,
+			r.maxError, r.meanError, r.stats.nsPerStep, laneOk(r) ? "" : "  WRONG");
+	}
+
+	// supersteps: a 4 step note on the first step of the bar with a sine on
+	// pot 1 at a cycle a step, up to its p-lock. The values are checked against
+	// the sine at their place on the destination's CC rate grid.
+	const int superDepth = 100;
+
+	struct SuperStepResult {
+		long values;
+		long crowded;			// values closer than the destination's CC rate
+		int maxError;
+		double nsPerStep;
+	};
+
+	bool superStepRun(SuperStepResult& r) {
+		host::seedRandom(1);
+		host::setSerialConnected(true);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_S1);
+		sketchSetTempo(120);
+		int steps = 16;
+		sketchSetPattern(0, { steps, 1, 0, 2, false });
+		for (int i = 0; i < sketchNumSteps(); ++i) {
+			sketchSetStep(0, i, { 60, 100, 3, i == 0, { -1, superDepth, -1, -1 }, 100, 0, 0 });
+			sketchSetSuperStep(0, i, i == 0 ? 0 : -1, 2, 1);
+		}
+		sketchLoop();
+		host::midiOut().clear();
+
+		unsigned long ppq = sketchPpqInterval();
+		uint64_t stepMicros = ppq * (PPQ / 4);
+		uint64_t outMicros = sketchLfoTicks(1) * ppq;
+		uint64_t start = host::now();
+		uint64_t end = start + 2 * steps * stepMicros;
+		sketchStart();
+		while (host::now() < end) {
+			sketchLoop();
+			host::advance(250);
+		}
+
+		// the first of the pot's CCs each bar is the p-lock, sent as the step plays
+		r = {};
+		uint64_t barMicros = steps * stepMicros;
+		uint64_t lastGrid = 0;
+		int lockedBar = -1;
+		for (const host::MidiEvent& e : host::midiOut()) {
+			if ((e.data[0] & 0xF0) != 0xB0 || e.data[1] != sketchPotCC(1) || e.time < start) continue;
+			int bar = (e.time - start) / barMicros;
+			if (bar != lockedBar) {
+				lockedBar = bar;
+				continue;
+			}
+			uint64_t grid = ((e.time - start) % barMicros + outMicros / 2) / outMicros;
+			double ideal = (127.5 + 127.5 * sin(2 * M_PI * grid * outMicros / stepMicros)) * (superDepth + 1) / 256;
+			int error = (int)fabs(e.data[2] - ideal);
+			if (error > r.maxError) r.maxError = error;
+			if (r.values && grid == lastGrid) r.crowded++;
+			lastGrid = grid;
+			r.values++;
+		}
+		sketchStop();
+		r.nsPerStep = sketchSuperStepNs(codecRepeats);
+		return true;
+	}
+
+	// table steps are 1/256 of a cycle, and the value is truncated
+	bool superStepOk(const SuperStepResult& r) {
+		return r.values > 0 && r.crowded == 0 && r.maxError <= 1;
+	}
+
+	void printSuperSteps(const SuperStepResult& r) {
+		printf("supersteps   values %ld  crowded %ld (one per %d ticks)  error max %d  %.0f ns/step%s\n",
+			r.values, r.crowded, sketchLfoTicks(1), r.maxError, r.nsPerStep, superStepOk(r) ? "" : "  WRONG");
+	}
+
+	// MIDI mode arpeggiator: three keys held for two bars going up over two
+	// octaves, a fourth key added for a bar, then all let go
+	const int arpKeys[4] = { 11, 15, 18, 20 };
+
+	struct ArpResult {
+		long notes;
+		long wrong;				// out of order over the first two bars
+		long stuck;
+		long afterRelease;		// note ons more than a PPQ tick after the keys were let go
+		bool heardNewKey;
+		int maxLate;			// note on behind the arp's grid, us
+		int maxGateError;		// note length off the gate, us
+		double nsKeyChange;
+	};
+
+	bool arpRun(ArpResult& r) {
+		host::seedRandom(1);
+		host::setSerialConnected(true);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_MIDI);
+		sketchSetTempo(120);
+		sketchSetArp(true, 0, 2, 2, 50);		// up, 2 octaves, 1/16, half the step
+		sketchLoop();
+		host::midiOut().clear();
+
+		unsigned long ppq = sketchPpqInterval();
+		uint64_t stepMicros = ppq * (PPQ / 4);
+		uint64_t barMicros = 16 * stepMicros;
+		auto run = [&](uint64_t until) {
+			while (host::now() < until) {
+				sketchLoop();
+				host::advance(250);
+			}
+		};
+		uint64_t start = host::now();
+		for (int k = 0; k < 3; ++k) host::pressKey(arpKeys[k]);
+		run(start + 2 * barMicros + stepMicros / 3);
+		host::pressKey(arpKeys[3]);
+		run(start + 3 * barMicros);
+		for (int k = 0; k < 4; ++k) host::releaseKey(arpKeys[k]);
+		uint64_t released = host::now();
+		sketchLoop();
+		run(released + barMicros);
+
+		int held[6];
+		for (int k = 0; k < 3; ++k) held[k] = sketchKeyNote(arpKeys[k]);
+		std::sort(held, held + 3);
+		for (int k = 0; k < 3; ++k) held[k + 3] = held[k] + 12;
+
+		r = {};
+		std::vector<host::MidiEvent>& out = host::midiOut();
+		uint64_t first = 0;
+		for (size_t i = 0; i < out.size(); ++i) {
+			const host::MidiEvent& e = out[i];
+			if ((e.data[0] & 0xF0) != 0x90 || e.data[2] == 0) continue;
+			if (r.notes == 0) first = e.time;
+			uint64_t grid = first + r.notes * stepMicros;
+			int late = (int)(e.time - grid);
+			if (abs(late) > r.maxLate) r.maxLate = abs(late);
+			if (e.time < start + 2 * barMicros && e.data[1] != held[r.notes % 6]) r.wrong++;
+			if (e.data[1] == sketchKeyNote(arpKeys[3]) || e.data[1] == sketchKeyNote(arpKeys[3]) + 12) r.heardNewKey = true;
+			if (e.time > released + ppq) r.afterRelease++;
+			r.notes++;
+
+			bool off = false;
+			for (size_t j = i + 1; j < out.size() && !off; ++j) {
+				off = out[j].data[1] == e.data[1]
+					&& ((out[j].data[0] & 0xF0) == 0x80 || ((out[j].data[0] & 0xF0) == 0x90 && out[j].data[2] == 0));
+				if (off) {
+					int gateError = abs((int)(out[j].time - e.time) - (int)(stepMicros / 2));
+					if (gateError > r.maxGateError) r.maxGateError = gateError;
+				}
+			}
+			if (!off) r.stuck++;
+		}
+		r.nsKeyChange = sketchArpKeyNs(codecRepeats);
+		return true;
+	}
+
+	// notes go out on the first loop pass past their time, and a pass is 250 us
+	// here plus what the loop itself takes
+	bool arpOk(const ArpResult& r) {
+		return r.notes > 0 && r.wrong == 0 && r.stuck == 0 && r.afterRelease == 0 && r.heardNewKey
+			&& r.maxLate <= 1000 && r.maxGateError <= 1000;
+	}
+
+	void printArp(const ArpResult& r) {
+		printf("arp          notes %ld wrong %ld stuck %ld after release %ld new key %s  late max %d us  gate error max %d us  key change %.0f ns%s\n",
+			r.notes, r.wrong, r.stuck, r.afterRelease, r.heardNewKey ? "heard" : "missing", r.maxLate, r.maxGateError, r.nsKeyChange,
+			arpOk(r) ? "" : "  WRONG");
+	}
+
+	// echo at its heaviest: every pattern playing every step, each note
+	// echoed the most times at full feedback, then muted for three bars for the
+	// echoes to finish. An 1/8 apart on as many patterns as the pool is sized
+	// for, it holds them all; a 1/4 apart on every pattern needs at least twice
+	// the pool, so voices are stolen
+	const int echoBars = 2;
+	const int echoEighth = 3;		// multValues index
+	const int echoQuarter = 4;
+
+	struct EchoResult {
+		long notes;
+		long stuck;
+		double nsPerLoop;		// the whole loop() pass, host time
+		SketchEchoStats stats;
+	};
+
+	bool echoRun(int time, int echoing, EchoResult& r) {
+		host::seedRandom(1);
+		host::setSerialConnected(true);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_S2);
+		sketchSetTempo(120);
+		for (int p = 0; p < sketchNumPatterns(); ++p) {
+			sketchSetPattern(p, { 16, p + 1, 0, 2, false });
+			for (int i = 0; i < 16; ++i) {
+				sketchSetStep(p, i, { 36 + p, 100, 1, true, { -1, -1, -1, -1 }, 100, 0, 0 });
+			}
+			if (p < echoing) sketchSetEcho(p, 8, 100, time, 0);
+		}
+		sketchLoop();
+		host::midiOut().clear();
+
+		unsigned long ppq = sketchPpqInterval();
+		uint64_t barMicros = 4 * PPQ * ppq;
+		uint64_t start = host::now();
+		long loops = 0;
+		auto wallStart = std::chrono::steady_clock::now();
+		sketchStart();
+		bool muted = false;
+		while (host::now() < start + (echoBars + 3) * barMicros) {
+			if (!muted && host::now() >= start + echoBars * barMicros) {
+				for (int p = 0; p < sketchNumPatterns(); ++p) sketchSetMute(p, true);
+				muted = true;
+			}
+			sketchLoop();
+			host::advance(250);
+			loops++;
+		}
+		auto wallEnd = std::chrono::steady_clock::now();
+
+		r = {};
+		r.nsPerLoop = std::chrono::duration<double, std::nano>(wallEnd - wallStart).count() / loops;
+		std::vector<host::MidiEvent>& out = host::midiOut();
+		for (size_t i = 0; i < out.size(); ++i) {
+			const host::MidiEvent& e = out[i];
+			if ((e.data[0] & 0xF0) != 0x90 || e.data[2] == 0) continue;
+			r.notes++;
+			bool off = false;
+			for (size_t j = i + 1; j < out.size() && !off; ++j) {
+				off = out[j].data[1] == e.data[1] && (out[j].data[0] & 0x0F) == (e.data[0] & 0x0F)
+					&& ((out[j].data[0] & 0xF0) == 0x80 || ((out[j].data[0] & 0xF0) == 0x90 && out[j].data[2] == 0));
+			}
+			if (!off) r.stuck++;
+		}
+		r.stats = sketchEchoStats(codecRepeats);
+		sketchStop();
+		return true;
+	}
+
+	// an 1/8 apart every echo fits, a 1/4 apart the pool should fill and steal
+	// rather than drop or hang notes
+	bool echoOk(const EchoResult& r, bool overload) {
+		return r.notes > 0 && r.stuck == 0 && (overload
+			? r.stats.peak == r.stats.poolSize && r.stats.stolen > 0
+			: r.stats.peak <= r.stats.poolSize && r.stats.stolen == 0);
+	}
+
+	void printEcho(const char* name, const EchoResult& r, bool overload) {
+		printf("%-12s notes %ld stuck %ld  pool peak %d/%d stolen %ld  loop %.0f ns  play %.0f ns  add %.0f ns%s\n",
+			name, r.notes, r.stuck, r.stats.peak, r.stats.poolSize, r.stats.stolen, r.nsPerLoop, r.stats.nsPlay, r.stats.nsAdd,
+			echoOk(r, overload) ? "" : "  WRONG");
+	}
+
+	// grooves and nudges: a pattern on the PUSH groove and one on 71% swing,
+	// their steps nudged both ways, up to the half step a note can go early
+	const int grooveBars = 2;
+	const int grooveNudges[16] = { 0, -12, 4, -6, 12, -3, 0, -9, 0, -12, 8, -4, 2, -8, 0, -12 };
+	const int grooves[2] = { 6, 5 };
+
+	struct GrooveResult {
+		long notes;
+		long early;				// before their step's time
+		long wrongVelocity;
+		long stuck;
+		int minLate;			// behind step time + offset, us
+		int maxLate;
+	};
+
+	bool grooveRun(GrooveResult& r) {
+		host::seedRandom(1);
+		host::setSerialConnected(true);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_S2);
+		sketchSetTempo(120);
+		for (int p = 0; p < 2; ++p) {
+			sketchSetPattern(p, { 16, p + 1, 0, 2, false, grooves[p] });
+			for (int i = 0; i < 16; ++i) {
+				sketchSetStep(p, i, { 48 + i, 100, 0, true, { -1, -1, -1, -1 }, 100, 0, 0, 0, 0, 0,
+					p == 0 ? grooveNudges[i] : -grooveNudges[i] });
+			}
+		}
+		for (int p = 2; p < sketchNumPatterns(); ++p) sketchSetMute(p, true);
+		sketchLoop();
+		host::midiOut().clear();
+
+		unsigned long ppq = sketchPpqInterval();
+		uint64_t stepMicros = ppq * (PPQ / 4);
+		uint64_t barMicros = 16 * stepMicros;
+		uint64_t start = host::now();
+		sketchStart();
+		bool muted = false;
+		while (host::now() < start + (grooveBars + 1) * barMicros) {
+			if (!muted && host::now() >= start + grooveBars * barMicros - stepMicros / 2) {
+				sketchSetMute(0, true);
+				sketchSetMute(1, true);
+				muted = true;
+			}
+			sketchLoop();
+			host::advance(250);
+		}
+
+		r = {};
+		r.minLate = 1 << 30;
+		long played[2][16] = {};
+		std::vector<host::MidiEvent>& out = host::midiOut();
+		for (size_t i = 0; i < out.size(); ++i) {
+			const host::MidiEvent& e = out[i];
+			int p = e.data[0] & 0x0F;
+			int step = e.data[1] - 48;
+			if ((e.data[0] & 0xF0) != 0x90 || e.data[2] == 0 || p > 1 || step < 0 || step > 15) continue;
+			const Groove& g = Grooves::table[grooves[p]];
+			int ticks = (p == 0 ? grooveNudges[step] : -grooveNudges[step]) + g.offset[step];
+			if (ticks < -(PPQ / 8)) ticks = -(PPQ / 8);		// half a step at most
+			uint64_t boundary = start + (played[p][step]++ * 16 + step) * stepMicros;
+			int late = (int)((int64_t)e.time - (int64_t)(boundary + ticks * (int64_t)ppq));
+			if (late < r.minLate) r.minLate = late;
+			if (late > r.maxLate) r.maxLate = late;
+			if (e.time < boundary) r.early++;
+			int v = std::min(127, std::max(1, 100 + g.velocity[step]));
+			if (e.data[2] != v) r.wrongVelocity++;
+			r.notes++;
+
+			bool off = false;
+			for (size_t j = i + 1; j < out.size() && !off; ++j) {
+				off = out[j].data[1] == e.data[1] && (out[j].data[0] & 0x0F) == p
+					&& ((out[j].data[0] & 0xF0) == 0x80 || ((out[j].data[0] & 0xF0) == 0x90 && out[j].data[2] == 0));
+			}
+			if (!off) r.stuck++;
+		}
+		sketchStop();
+		return true;
+	}
+
+	// queued notes go out on the first PPQ tick pass past their time, and a
+	// loop pass is 250 us here
+	bool grooveOk(const GrooveResult& r) {
+		return r.notes == 2 * 16 * grooveBars && r.early > 0 && r.wrongVelocity == 0 && r.stuck == 0
+			&& r.minLate >= 0 && r.maxLate <= (int)(60000000 / (PPQ * 120)) + 500;
+	}
+
+	void printGroove(const GrooveResult& r) {
+		printf("groove       notes %ld early %ld wrong velocity %ld stuck %ld  late min %d us max %d us%s\n",
+			r.notes, r.early, r.wrongVelocity, r.stuck, r.minLate, r.maxLate, grooveOk(r) ? "" : "  WRONG");
+	}
+
+	// a step nudged half a step early while the step before it plays: the
+	// sequencer has to take it that much sooner than it had planned to
+	const int nudgeStep = 5;
+
+	struct NudgeResult {
+		bool played;
+		int late;				// behind the nudged step's time, us
+	};
+
+	bool nudgeRun(NudgeResult& r) {
+		host::seedRandom(1);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_S2);
+		sketchSetTempo(120);
+		for (int p = 0; p < sketchNumPatterns(); ++p) {
+			sketchSetPattern(p, { 16, p + 1, 0, 2, p != 0 });
+			for (int i = 0; i < 16; ++i) {
+				sketchSetStep(p, i, { 48 + i, 100, 0, true, { -1, -1, -1, -1 }, 100, 0, 0 });
+			}
+		}
+		sketchLoop();
+		host::midiOut().clear();
+
+		uint64_t stepMicros = sketchPpqInterval() * (PPQ / 4);
+		uint64_t start = host::now();
+		uint64_t nudgeAt = start + (nudgeStep - 1) * stepMicros + stepMicros / 4;
+		bool nudged = false;
+		sketchStart();
+		while (host::now() < start + 16 * stepMicros) {
+			if (!nudged && host::now() >= nudgeAt) {
+				sketchSetStep(0, nudgeStep, { 48 + nudgeStep, 100, 0, true, { -1, -1, -1, -1 }, 100, 0, 0, 0, 0, 0, -(PPQ / 8) });
+				nudged = true;
+			}
+			sketchLoop();
+			host::advance(250);
+		}
+		sketchStop();
+
+		r = {};
+		for (const host::MidiEvent& e : host::midiOut()) {
+			if (e.data[0] != 0x90 || e.data[1] != 48 + nudgeStep || e.data[2] == 0) continue;
+			r.played = true;
+			r.late = (int)((int64_t)e.time - (int64_t)(start + nudgeStep * stepMicros - stepMicros / 2));
+			break;
+		}
+		return true;
+	}
+
+	bool nudgeOk(const NudgeResult& r) {
+		return r.played && r.late >= 0 && r.late <= (int)(60000000 / (PPQ * 120)) + 500;
+	}
+
+	void printNudge(const NudgeResult& r) {
+		printf("nudge        step nudged half a step early while playing  late %d us%s\n",
+			r.late, nudgeOk(r) ? "" : "  WRONG");
+	}
+
+	// tempo changes: patterns from 1/64 to 1/4 through a ramp up, a change
+	// from the encoder halfway through a step and a ramp down. Each step's
+	// time is checked against the MIDI clock ticks around its place in the
+	// beat (a 1/64 step falls halfway between two), and when it was taken.
+	const int tempoRates[8] = { 2, 1, 0, 3, 2, 1, 4, 2 };		// multValues index
+
+	struct TempoResult {
+		long steps;
+		long clocks;
+		int maxOffGrid;			// step time against the clock's ticks, us
+		long early;				// steps taken before their place on the grid
+		long late;				// or more than a loop pass after it
+		long stuck;
+		float lowBpm;
+		float highBpm;
+	};
+
+	bool tempoRun(TempoResult& r) {
+		host::seedRandom(1);
+		host::setSerialConnected(true);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_S2);
+		sketchSetTempo(120);
+		for (int p = 0; p < sketchNumPatterns(); ++p) {
+			sketchSetPattern(p, { 16, p + 1, 0, tempoRates[p], false });
+			for (int i = 0; i < 16; ++i) {
+				sketchSetStep(p, i, { 36 + p, 100, 0, true, { -1, -1, -1, -1 }, 100, 0, 0 });
+			}
+		}
+		host::serialInput("t");		// start streaming the trace
+		sketchLoop();
+		host::serialOutput().clear();
+		host::midiOut().clear();
+
+		uint64_t barMicros = 4 * PPQ * sketchPpqInterval();
+		uint64_t start = host::now();
+		r = {};
+		r.lowBpm = r.highBpm = 120;
+		auto run = [&](uint64_t until) {
+			while (host::now() < until) {
+				sketchLoop();
+				host::advance(250);
+				r.lowBpm = std::min(r.lowBpm, sketchTempo());
+				r.highBpm = std::max(r.highBpm, sketchTempo());
+			}
+		};
+		sketchStart();
+		run(start + barMicros);
+		sketchTempoRamp(180, 2);
+		run(host::now() + 2 * barMicros * 120 / 150);		// about as long as the ramp takes
+		run(host::now() + barMicros / 16 / 2);
+		sketchSetTempo(95);
+		run(host::now() + barMicros);
+		sketchTempoRamp(140, 1);
+		run(host::now() + barMicros);
+		uint64_t end = host::now();
+		for (int p = 0; p < sketchNumPatterns(); ++p) sketchSetMute(p, true);
+		run(end + barMicros);
+
+		TraceReader trace;
+		const std::string& serial = host::serialOutput();
+		trace.parse((const uint8_t*)serial.data(), serial.size());
+		std::vector<int64_t> clocks;
+		for (const TracedEvent& e : trace.events) {
+			if (e.event == TRACE_CLOCK && (uint64_t)e.due >= start) clocks.push_back(e.due);
+		}
+		r.clocks = clocks.size();
+
+		long count[8] = {};
+		for (const TracedEvent& e : trace.events) {
+			if (e.event != TRACE_STEP || (uint64_t)e.due < start || (uint64_t)e.due >= end || e.pattern >= 8) continue;
+			int ticks = (int)(PPQ / 4 * multValues[tempoRates[e.pattern]]);
+			long at = count[e.pattern]++ * ticks;		// 96 PPQ ticks, a MIDI clock is 4
+			size_t k = at / 4;
+			if (k + 1 >= clocks.size()) continue;
+			int64_t grid = clocks[k] + (clocks[k + 1] - clocks[k]) * (at % 4) / 4;
+			int offGrid = (int)std::abs(e.due - grid);
+			if (offGrid > r.maxOffGrid) r.maxOffGrid = offGrid;
+			if (e.sent < grid - 1) r.early++;
+			if (e.sent - grid > 250) r.late++;
+			r.steps++;
+		}
+
+		int held[16][128] = {};
+		for (const host::MidiEvent& e : host::midiOut()) {
+			int kind = e.data[0] & 0xF0;
+			int ch = e.data[0] & 0x0F;
+			if (kind == 0x90 && e.data[2] > 0) held[ch][e.data[1]]++;
+			else if ((kind == 0x80 || kind == 0x90) && held[ch][e.data[1]] > 0) held[ch][e.data[1]]--;
+		}
+		for (int ch = 0; ch < 16; ++ch)
+			for (int n = 0; n < 128; ++n) r.stuck += held[ch][n];
+		sketchStop();
+		return true;
+	}
+
+	// integer micros per PPQ tick, a 1/64 step between two clocks can round by one
+	bool tempoOk(const TempoResult& r) {
+		return r.steps > 0 && r.maxOffGrid <= 1 && r.early == 0 && r.late == 0 && r.stuck == 0
+			&& r.lowBpm <= 95 && r.highBpm >= 180;
+	}
+
+	void printTempo(const TempoResult& r) {
+		printf("tempo        steps %ld clocks %ld  %.0f - %.0f BPM  off grid max %d us  early %ld late %ld stuck %ld%s\n",
+			r.steps, r.clocks, r.lowBpm, r.highBpm, r.maxOffGrid, r.early, r.late, r.stuck, tempoOk(r) ? "" : "  WRONG");
+	}
+
+	// clock out through stalled loop passes: the timer sends every clock on
+	// its deadline however long the loop is away, and never two together
+	const int clockStalls[4] = { 3000, 12000, 45000, 150000 };		// us, the longest is past the clock's history
+
+	struct ClockResult {
+		long clocks;
+		long expected;
+		long stalls;
+		int maxJitter;			// against the first clock + n periods, us
+		long bursts;			// clocks less than half a period apart
+		long late;				// trace: sent after their deadline
+	};
+
+	bool clockRun(ClockResult& r) {
+		host::seedRandom(1);
+		host::setSerialConnected(true);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_S2);
+		sketchSetTempo(150);
+		for (int p = 0; p < sketchNumPatterns(); ++p) {
+			sketchSetPattern(p, { 16, p + 1, 0, 2, false });
+			for (int i = 0; i < 16; ++i) {
+				sketchSetStep(p, i, { 36 + p, 100, 0, true, { -1, -1, -1, -1 }, 100, 0, 0 });
+			}
+		}
+		host::serialInput("t");
+		sketchLoop();
+		host::serialOutput().clear();
+		host::midiOut().clear();
+
+		uint64_t period = sketchPpqInterval() * (PPQ / 24);
+		uint64_t start = host::now();
+		uint64_t end = start + 4 * 24 * 4 * period;		// 4 bars
+		r = {};
+		sketchStart();
+		for (long pass = 1; host::now() < end; ++pass) {
+			sketchLoop();
+			if (pass % 40 == 0) {
+				host::advance(std::min<uint64_t>(clockStalls[r.stalls++ % 4], end - host::now()));
+			} else {
+				host::advance(250);
+			}
+		}
+		sketchStop();
+
+		std::vector<uint64_t> clocks;
+		for (const host::MidiEvent& e : host::midiOut()) {
+			if (e.data[0] == 0xF8 && e.time < end) clocks.push_back(e.time);
+		}
+		r.clocks = clocks.size();
+		r.expected = (end - start + period - 1) / period;
+		for (size_t k = 0; k < clocks.size(); ++k) {
+			int jitter = (int)std::abs((int64_t)(clocks[k] - clocks[0]) - (int64_t)(k * period));
+			if (jitter > r.maxJitter) r.maxJitter = jitter;
+			if (k > 0 && clocks[k] - clocks[k - 1] < period / 2) r.bursts++;
+		}
+
+		TraceReader trace;
+		const std::string& serial = host::serialOutput();
+		trace.parse((const uint8_t*)serial.data(), serial.size());
+		for (const TracedEvent& e : trace.events) {
+			if (e.event == TRACE_CLOCK && e.late() > 0) r.late++;
+		}
+		return true;
+	}
+
+	bool clockOk(const ClockResult& r) {
+		return r.clocks == r.expected && r.maxJitter == 0 && r.bursts == 0 && r.late == 0;
+	}
+
+	void printClock(const ClockResult& r) {
+		printf("clock out    clocks %ld of %ld through %ld stalls  jitter max %d us  bursts %ld  late %ld%s\n",
+			r.clocks, r.expected, r.stalls, r.maxJitter, r.bursts, r.late, clockOk(r) ? "" : "  WRONG");
+	}
+
+	// MTC out at 29.97 drop frame from just before a minute, through stalled
+	// loop passes: every quarter frame on time, none in a burst, the time codes
+	// in order with the minute's first two frames left out. Then chasing 25 fps
+	// time code from 00:00:10:00, a jump to 00:02:00:00 and a stop: every note
+	// the pattern plays once locked on is its step at the time code's position,
+	// within the PPQ tick the loop sends due notes by.
+	const uint32_t mtcOutFrom = 59 * 30 + 10;		// frames, 00:00:59:10 without drops
+	const uint32_t mtcChaseFrom[2] = { 10 * 25, 120 * 25 };		// 25 fps frames
+
+	struct MtcResult {
+		long quarters;
+		long expected;
+		int maxJitter;			// against the first + n quarter frames, us
+		long bursts;
+		long outOfOrder;		// pieces not in turn, or time codes not two frames on
+		bool droppedFrames;		// went from ;29 to 01:00;02
+		bool resetToZero;		// a reset while playing sent 00:00:00:00 next
+		int resetOffset;		// its first quarter frame against when the step the patterns started again on was due, us
+		long chaseNotes;		// pattern 0 note ons while chasing, both locates
+		long locks[2];			// notes after each
+		long wrongStep;
+		long early;				// before the step's time at the time code's position
+		int maxLate;			// us after it
+		int tick;				// the loop sends due notes a PPQ tick at a time
+		long stuck;
+		bool stopped;			// when the time code did
+		double nsSeekNear;		// seek to bar 2 and bar 5000, host time
+		double nsSeekFar;
+	};
+
+	bool mtcRun(MtcResult& r) {
+		host::seedRandom(1);
+		sketchSetup();
+		sketchEndBoot();
+		sketchSetMode(MODE_S2);
+		sketchSetTempo(120);
+		for (int p = 0; p < sketchNumPatterns(); ++p) {
+			sketchSetPattern(p, { 16, p + 1, 0, 2, p != 0 });
+			for (int i = 0; i < 16; ++i) {
+				sketchSetStep(p, i, { 40 + i, 100, 0, true, { -1, -1, -1, -1 }, 100, 0, 0 });
+			}
+		}
+		r = {};
+
+		// out, after a start and stop from the top so the locate holds
+		sketchSetMtc(MTC_MODE_OUT, MTC_30_DROP);
+		sketchStart();
+		sketchLoop();
+		sketchStop();
+		uint64_t located = Mtc::quarterMicros((uint64_t)mtcOutFrom * 4, MTC_30_DROP);
+		sketchMtcLocate(located);
+		host::midiOut().clear();
+		uint64_t start = host::now();
+		uint64_t end = start + 2000000;
+		sketchStart();
+		for (long pass = 1; host::now() < end; ++pass) {
+			sketchLoop();
+			host::advance(pass % 40 == 0 ? std::min<uint64_t>(clockStalls[(pass / 40) % 4], end - host::now()) : 250);
+		}
+		sketchStop();
+
+		std::vector<host::MidiEvent> quarters;
+		for (const host::MidiEvent& e : host::midiOut()) {
+			if (e.data[0] == 0xF1 && e.time < end) quarters.push_back(e);
+		}
+		double quarter = Mtc::quarterMicros(3000, MTC_30_DROP) / 3000.0;
+		uint64_t first = start + (uint64_t)ceil(Mtc::quarterMicros(((mtcOutFrom + 1) & ~1u) * 4, MTC_30_DROP) - located);
+		r.quarters = quarters.size();
+		r.expected = (long)((end - first - 1) / quarter) + 1;
+		uint8_t nibbles[8];
+		long frames = -1;
+		for (size_t k = 0; k < quarters.size(); ++k) {
+			int jitter = (int)std::abs((int64_t)(quarters[k].time - quarters[0].time) - (int64_t)llround(k * quarter));
+			if (jitter > r.maxJitter) r.maxJitter = jitter;
+			if (k > 0 && quarters[k].time - quarters[k - 1].time < quarter / 2) r.bursts++;
+			int piece = quarters[k].data[1] >> 4;
+			if (piece != (int)(k & 7)) {
+				r.outOfOrder++;
+				continue;
+			}
+			nibbles[piece] = quarters[k].data[1] & 0x0F;
+			if (piece < 7) continue;
+			Timecode tc = { (uint8_t)(nibbles[6] | (nibbles[7] & 1) << 4), (uint8_t)(nibbles[4] | nibbles[5] << 4),
+				(uint8_t)(nibbles[2] | nibbles[3] << 4), (uint8_t)(nibbles[0] | nibbles[1] << 4) };
+			long f = Mtc::frames(tc, MTC_30_DROP);
+			if (frames >= 0 && f != frames + 2) r.outOfOrder++;
+			if (tc.minutes == 1 && tc.seconds == 0 && tc.frames == 2) r.droppedFrames = frames >= 0;
+			frames = f;
+		}
+
+		// a reset while playing, time code starts again from 00:00:00:00 when the
+		// first step after it is due (from the firmware's trace, notes go out
+		// on the tick after)
+		host::midiOut().clear();
+		host::setSerialConnected(true);
+		host::serialInput("t");		// start streaming the trace
+		sketchStart();
+		uint64_t resetAt = host::now() + 500000;
+		while (host::now() < resetAt) {
+			sketchLoop();
+			host::advance(250);
+		}
+		sketchReset();
+		while (host::now() < resetAt + 500000) {
+			sketchLoop();
+			host::advance(250);
+		}
+		sketchStop();
+		TraceReader trace;
+		const std::string& serial = host::serialOutput();
+		trace.parse((const uint8_t*)serial.data(), serial.size());
+		uint64_t restart = 0;
+		for (const TracedEvent& e : trace.events) {
+			if (!restart && e.event == TRACE_STEP && e.pattern == 0 && (uint64_t)e.sent >= resetAt) restart = e.due;
+		}
+		std::vector<host::MidiEvent> afterReset;
+		for (const host::MidiEvent& e : host::midiOut()) {
+			if (e.time >= resetAt && e.data[0] == 0xF1 && afterReset.size() < 8) afterReset.push_back(e);
+		}
+		r.resetToZero = restart && afterReset.size() == 8;
+		for (size_t k = 0; k < afterReset.size(); ++k) {
+			int piece = afterReset[k].data[1] >> 4;
+			int nibble = afterReset[k].data[1] & 0x0F;
+			if (piece != (int)k || (piece < 7 ? nibble : nibble & 1) != 0) r.resetToZero = false;
+		}
+		r.resetOffset = r.resetToZero ? (int)((int64_t)afterReset[0].time - (int64_t)restart) : 0;
+
+		// chase, quarter frames fed in on time with a loop pass straight after each
+		sketchSetMtc(MTC_MODE_CHASE, MTC_25);
+		host::midiOut().clear();
+		const uint64_t qf = 10000;		// us at 25 fps
+		uint64_t notesFrom[2];
+		uint64_t sourceAt[2];
+		for (int l = 0; l < 2; ++l) {
+			uint64_t q = (uint64_t)mtcChaseFrom[l] * 4;
+			sourceAt[l] = host::now();
+			Timecode tc = {};
+			for (uint64_t at = sourceAt[l]; at < sourceAt[l] + 2000000; at += qf, ++q) {
+				while (host::now() + 250 < at) {
+					sketchLoop();
+					host::advance(250);
+				}
+				host::advance(at - host::now());
+				int piece = q & 7;
+				if (piece == 0) tc = Mtc::timecode(q / 4, MTC_25);
+				const uint8_t nibbles[8] = { (uint8_t)(tc.frames & 15), (uint8_t)(tc.frames >> 4), (uint8_t)(tc.seconds & 15), (uint8_t)(tc.seconds >> 4),
+					(uint8_t)(tc.minutes & 15), (uint8_t)(tc.minutes >> 4), (uint8_t)(tc.hours & 15), (uint8_t)((tc.hours >> 4) | MTC_25 << 1) };
+				const uint8_t msg[2] = { 0xF1, (uint8_t)(piece << 4 | nibbles[piece]) };
+				host::midiIn(msg, 2);
+				sketchLoop();
+				if (at == sourceAt[l] + 7 * qf) {
+					notesFrom[l] = host::midiOut().size();		// locked on, earlier notes are from before the jump
+				}
+			}
+		}
+		uint64_t quiet = host::now() + 300000;
+		while (host::now() < quiet) {
+			sketchLoop();
+			host::advance(250);
+		}
+		r.stopped = !sketchPlaying();
+
+		const std::vector<host::MidiEvent>& out = host::midiOut();
+		uint64_t stepMicros = sketchPpqInterval() * (PPQ / 4);
+		r.tick = sketchPpqInterval();
+		for (int l = 0; l < 2; ++l) {
+			size_t to = l == 0 ? notesFrom[1] : out.size();
+			for (size_t i = notesFrom[l]; i < to; ++i) {
+				const host::MidiEvent& e = out[i];
+				if (e.data[0] != 0x90 || e.data[2] == 0) continue;
+				uint64_t position = Mtc::quarterMicros((uint64_t)mtcChaseFrom[l] * 4, MTC_25) + (e.time - sourceAt[l]);
+				uint64_t step = (position + stepMicros / 2) / stepMicros;
+				int64_t late = (int64_t)(position - step * stepMicros);
+				if (late < 0) r.early++;
+				if (late > r.maxLate) r.maxLate = (int)late;
+				if (e.data[1] != 40 + step % 16) r.wrongStep++;
+				r.locks[l]++;
+				r.chaseNotes++;
+			}
+		}
+		int held[16][128] = {};
+		for (const host::MidiEvent& e : out) {
+			int kind = e.data[0] & 0xF0;
+			int ch = e.data[0] & 0x0F;
+			if (kind == 0x90 && e.data[2] > 0) held[ch][e.data[1]]++;
+			else if ((kind == 0x80 || kind == 0x90) && held[ch][e.data[1]] > 0) held[ch][e.data[1]]--;
+		}
+		for (int ch = 0; ch < 16; ++ch)
+			for (int n = 0; n < 128; ++n) r.stuck += held[ch][n];
+
+		r.nsSeekNear = sketchSeekNs(PPQ * 4, 2000);
+		r.nsSeekFar = sketchSeekNs(PPQ * 4 * 5000, 2000);
+		return true;
+	}
+
+	// a quarter frame is a whole number of thirds of a us, each can be a third early or late
+	bool mtcOk(const MtcResult& r) {
+		return r.quarters == r.expected && r.maxJitter <= 1 && r.bursts == 0 && r.outOfOrder == 0 && r.droppedFrames
+			&& r.resetToZero && std::abs(r.resetOffset) <= 250
+			&& r.locks[0] > 0 && r.locks[1] > 0 && r.wrongStep == 0 && r.early == 0 && r.maxLate <= r.tick + 250 && r.stuck == 0 && r.stopped;
+	}
+
+	void printMtc(const MtcResult& r) {
+		printf("mtc out      quarter frames %ld of %ld  jitter max %d us  bursts %ld  out of order %ld  drop frame %s  reset to zero %s (%+d us)%s\n",
+			r.quarters, r.expected, r.maxJitter, r.bursts, r.outOfOrder, r.droppedFrames ? "yes" : "no",
+			r.resetToZero ? "yes" : "no", r.resetOffset, mtcOk(r) ? "" : "  WRONG");
+		printf("mtc chase    notes %ld + %ld  wrong step %ld  early %ld  late max %d us  stuck %ld  stopped %s  seek %.0f / %.0f ns\n",
+			r.locks[0], r.locks[1], r.wrongStep, r.early, r.maxLate, r.stuck, r.stopped ? "yes" : "no", r.nsSeekNear, r.nsSeekFar);
+	}
+
+	void printCodec(const SketchCodecStats& c) {
+		printf("    storage   raw %5ld  compact %5ld (%.0f%%)  encode %.0f ns  decode %.0f ns per pattern%s\n",
+			c.rawBytes, c.compactBytes, 100.0 * c.compactBytes / c.rawBytes, c.nsEncode, c.nsDecode,
+			c.roundTrip ? "" : "  DOESN'T ROUND TRIP");
+	}
+
+	void printResult(const Scenario& s, const Result& r) {
+		printf("%-12s %-8s steps %5ld missed %ld dropped %ld stuck %ld  %.0f ns/loop  %.1f ns/doStep  %.0f cycles/doStep", s.name, r.golden,
+			r.steps, r.missedSteps, r.droppedNotes, r.stuckNotes, r.nsPerLoop, r.nsPerStepCheck, r.cyclesPerStepCheck);
+		if (r.misattributed) printf("  %ld notes traced to the wrong pattern", r.misattributed);
+		if (r.repeats[0]) printf("  repeats after reset: %s", r.repeats);
+		printf("\n");
+		for (int t = TRACE_STEP; t <= TRACE_CLOCK; ++t) {
+			const Percentiles& p = r.dispatch[t];
+			printf("    %-9s %6ld  late us p50 %5d  p99 %5d  max %5d\n", typeNames[t], p.count, p.p50, p.p99, p.max);
+		}
+		const SketchQueueStats& q = r.queues;
+		printf("    queues    note on peak %3d/%d dropped %ld  note off peak %3d/%d dropped %ld\n",
+			q.onPeak, q.onSize, q.onDropped, q.offPeak, q.offSize, q.offDropped);
+		printCodec(r.codec);
+	}
+
+	void writeJson(FILE* f, const Scenario& s, const Result& r, bool last) {
+		fprintf(f, "  {\"name\": \"%s\", \"bpm\": %g, \"bars\": %d, \"loop_us\": %u,\n", s.name, s.bpm, s.bars, s.loopMicros);
+		fprintf(f, "   \"steps\": %ld, \"missed_steps\": %ld, \"dropped_notes\": %ld, \"stuck_notes\": %ld, \"misattributed_notes\": %ld, \"trace_lost\": %ld,\n",
+			r.steps, r.missedSteps, r.droppedNotes, r.stuckNotes, r.misattributed, r.traceLost);
+		fprintf(f, "   \"midi_events\": %ld, \"host_ns_per_loop\": %.1f, \"host_ns_per_dostep\": %.2f, \"host_cycles_per_dostep\": %.1f, \"golden\": \"%s\", \"repeats\": \"%s\",\n",
+			r.midiEvents, r.nsPerLoop, r.nsPerStepCheck, r.cyclesPerStepCheck, r.golden, r.repeats);
+		fprintf(f, "   \"dispatch_us\": {");
+		for (int t = TRACE_STEP; t <= TRACE_CLOCK; ++t) {
+			const Percentiles& p = r.dispatch[t];
+			fprintf(f, "%s\"%s\": {\"count\": %ld, \"p50\": %d, \"p99\": %d, \"max\": %d}",
+				t == TRACE_STEP ? "" : ", ", typeNames[t], p.count, p.p50, p.p99, p.max);
+		}
+		fprintf(f, "},\n   \"queues\": {\"note_on_peak\": %d, \"note_on_size\": %d, \"note_on_dropped\": %ld, \"note_off_peak\": %d, \"note_off_size\": %d, \"note_off_dropped\": %ld",
+			r.queues.onPeak, r.queues.onSize, r.queues.onDropped, r.queues.offPeak, r.queues.offSize, r.queues.offDropped);
+		fprintf(f, "},\n   \"storage\": {\"raw\": %ld, \"compact\": %ld, \"encode_ns\": %.0f, \"decode_ns\": %.0f}}%s\n",
+			r.codec.rawBytes, r.codec.compactBytes, r.codec.nsEncode, r.codec.nsDecode, last ? "" : ",");
+	}
+}
+
+int main(int argc, char** argv) {
+	std::string goldenDir = "golden";
+	const char* json = nullptr;
+	bool update = false;
+	std::vector<const Scenario*> chosen;
+	std::vector<const char*> dumps;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--golden") && i + 1 < argc) {
+			goldenDir = argv[++i];
+		} else if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+			json = argv[++i];
+		} else if (!strcmp(argv[i], "--patterns") && i + 1 < argc) {
+			dumps.push_back(argv[++i]);
+		} else if (!strcmp(argv[i], "--update")) {
+			update = true;
+		} else {
+			const Scenario* found = nullptr;
+			for (const Scenario& s : scenarios) {
+				if (!strcmp(s.name, argv[i])) found = &s;
+			}
+			if (!found) {
+				fprintf(stderr, "usage: %s [--golden DIR] [--update] [--json results.json] [--patterns dump.syx] [scenario ...]\nscenarios:", argv[0]);
+				for (const Scenario& s : scenarios) fprintf(stderr, " %s", s.name);
+				fprintf(stderr, "\n");
+				return 2;
+			}
+			chosen.push_back(found);
+		}
+	}
+	if (chosen.empty()) {
+		for (const Scenario& s : scenarios) chosen.push_back(&s);
+	}
+
+	SketchBudget budget = sketchBudget();
+	bool ramFits = budget.staticRam >= 0 && budget.staticRam + budget.ramReserve <= budget.ramSize;
+	printf("%d x %d steps: RAM %ld (patterns %ld) + %ld reserve of %ld%s, EEPROM %ld of %ld%s, banks %d x %ld of %ld flash%s\n",
+		sketchNumPatterns(), sketchNumSteps(), budget.staticRam, budget.patternRam, budget.ramReserve, budget.ramSize,
+		budget.staticRam < 0 ? " - CAN'T MEASURE" : ramFits ? "" : " - DOESN'T FIT",
+		budget.eepromUsed, budget.eepromSize,
+		budget.patternsInEeprom ? "" : " (patterns in banks)", budget.banks, budget.bankFile, budget.bankFlash,
+		budget.banks * budget.bankFile > budget.bankFlash ? " - DOESN'T FIT" : "");
+
+	std::vector<Result> results(chosen.size());
+	for (size_t i = 0; i < chosen.size(); ++i) {
+		if (!inChild(results[i], [&](Result& r) { run(*chosen[i], goldenDir, update, r); return true; })) {
+			fprintf(stderr, "%s: scenario crashed\n", chosen[i]->name);
+			return 1;
+		}
+		printResult(*chosen[i], results[i]);
+	}
+
+	dumps.insert(dumps.begin(), nullptr);		// blank patterns first
+	for (const char* path : dumps) {
+		SketchCodecStats c;
+		if (!inChild(c, [&](SketchCodecStats& r) { return codecRun(path, r); })) {
+			fprintf(stderr, "%s: couldn't load the patterns\n", path ? path : "blank");
+			return 1;
+		}
+		printf("%s\n", path ? path : "blank");
+		printCodec(c);
+	}
+
+	JournalResult journal;
+	if (!journalRun(journal)) {
+		fprintf(stderr, "journal: couldn't run\n");
+		return 1;
+	}
+	printJournal(journal);
+
+	const int songModes[2] = { MODE_S1, MODE_S2 };
+	SongResult songs[2];
+	for (int m = 0; m < 2; ++m) {
+		if (!inChild(songs[m], [&](SongResult& r) { return songRun(songModes[m], r); })) {
+			fprintf(stderr, "song: couldn't run\n");
+			return 1;
+		}
+		printSong(songModes[m], songs[m]);
+	}
+
+	SysExResult sysExResult;
+	if (!inChild(sysExResult, [&](SysExResult& r) { return sysExRun(r); })) {
+		fprintf(stderr, "sysex: couldn't run\n");
+		return 1;
+	}
+	printSysEx(sysExResult);
+
+	LaneResult lanes;
+	if (!inChild(lanes, [&](LaneResult& r) { return laneRun(r); })) {
+		fprintf(stderr, "cc lanes: couldn't run\n");
+		return 1;
+	}
+	printLanes(lanes);
+
+	SuperStepResult supers;
+	if (!inChild(supers, [&](SuperStepResult& r) { return superStepRun(r); })) {
+		fprintf(stderr, "supersteps: couldn't run\n");
+		return 1;
+	}
+	printSuperSteps(supers);
+
+	ArpResult arps;
+	if (!inChild(arps, [&](ArpResult& r) { return arpRun(r); })) {
+		fprintf(stderr, "arp: couldn't run\n");
+		return 1;
+	}
+	printArp(arps);
+
+	EchoResult echoes, overloaded;
+	if (!inChild(echoes, [&](EchoResult& r) { return echoRun(echoEighth, sketchEchoPatterns(), r); })
+		|| !inChild(overloaded, [&](EchoResult& r) { return echoRun(echoQuarter, sketchNumPatterns(), r); })) {
+		fprintf(stderr, "echo: couldn't run\n");
+		return 1;
+	}
+	printEcho("echo 1/8", echoes, false);
+	printEcho("echo 1/4", overloaded, true);
+
+	GrooveResult grooveResult;
+	if (!inChild(grooveResult, [&](GrooveResult& r) { return grooveRun(r); })) {
+		fprintf(stderr, "groove: couldn't run\n");
+		return 1;
+	}
+	printGroove(grooveResult);
+
+	NudgeResult nudgeResult;
+	if (!inChild(nudgeResult, [&](NudgeResult& r) { return nudgeRun(r); })) {
+		fprintf(stderr, "nudge: couldn't run\n");
+		return 1;
+	}
+	printNudge(nudgeResult);
+
+	TempoResult tempoResult;
+	if (!inChild(tempoResult, [&](TempoResult& r) { return tempoRun(r); })) {
+		fprintf(stderr, "tempo: couldn't run\n");
+		return 1;
+	}
+	printTempo(tempoResult);
+
+	ClockResult clockResult;
+	if (!inChild(clockResult, [&](ClockResult& r) { return clockRun(r); })) {
+		fprintf(stderr, "clock out: couldn't run\n");
+		return 1;
+	}
+	printClock(clockResult);
+
+	MtcResult mtcResult;
+	if (!inChild(mtcResult, [&](MtcResult& r) { return mtcRun(r); })) {
+		fprintf(stderr, "mtc: couldn't run\n");
+		return 1;
+	}
+	printMtc(mtcResult);
+
+	double rngNs, randNs;
+	rngSpeed(rngNs, randNs);
+	printf("random numbers: %.2f ns/draw, rand() %% n %.2f ns/draw (host)\n", rngNs, randNs);
+
+	if (json) {
+		FILE* f = fopen(json, "w");
+		if (!f) {
+			fprintf(stderr, "can't write %s\n", json);
+			return 1;
+		}
+		fprintf(f, "{\"patterns\": %d, \"steps\": %d, \"static_ram\": %ld, \"pattern_ram\": %ld, \"ram_reserve\": %ld, \"ram_size\": %ld, \"eeprom_used\": %ld, \"bank_file\": %ld, \"banks\": %d,\n",
+			sketchNumPatterns(), sketchNumSteps(), budget.staticRam, budget.patternRam, budget.ramReserve, budget.ramSize, budget.eepromUsed, budget.bankFile, budget.banks);
+		fprintf(f, " \"rng_ns_per_draw\": %.2f, \"rand_ns_per_draw\": %.2f,\n", rngNs, randNs);
+		fprintf(f, " \"journal\": {\"saves\": %d, \"used\": %d, \"capacity\": %d, \"records\": %d, \"same_after_boot\": %s, \"replay_ns\": %.0f},\n",
+			journal.saves, journal.used, journal.capacity, journal.records, journal.sameAfterBoot ? "true" : "false", journal.nsReplay);
+		fprintf(f, " \"song\": [");
+		for (int m = 0; m < 2; ++m) {
+			const SongResult& r = songs[m];
+			fprintf(f, "%s{\"mode\": \"%s\", \"notes\": %ld, \"wrong\": %ld, \"missing\": %ld, \"doubled\": %ld, \"stuck\": %ld, \"late_bars\": %d, \"slot_change_ns\": %.0f}",
+				m ? ", " : "", songModes[m] == MODE_S1 ? "S1" : "S2", r.notes, r.wrong, r.missing, r.doubled, r.stuck, r.lateBars, r.nsSwap);
+		}
+		fprintf(f, "],\n \"sysex\": {\"messages\": %d, \"bytes\": %ld, \"over_bank_switch\": %s, \"over_song\": %s, \"wrong\": %ld, \"ack_passes\": %d, \"dump_ns\": %.0f, \"load_ns_per_message\": %.0f},\n",
+			sysExResult.messages, sysExResult.bytes, sysExResult.loaded[0] ? "true" : "false", sysExResult.loaded[1] ? "true" : "false", sysExResult.wrong,
+			sysExResult.ackPasses, sysExResult.nsDump, sysExResult.nsMessage);
+		fprintf(f, " \"cc_lanes\": {\"lanes\": %d, \"points\": %d, \"bytes\": %d, \"pool_used\": %d, \"pool_size\": %d, \"recorded\": %ld, \"played\": %ld, \"max_error\": %d, \"mean_error\": %.2f, \"ns_per_step\": %.0f},\n",
+			lanes.stats.lanes, lanes.stats.points, lanes.stats.bytes, lanes.stats.poolUsed, lanes.stats.poolSize,
+			lanes.recorded, lanes.played, lanes.maxError, lanes.meanError, lanes.stats.nsPerStep);
+		fprintf(f, " \"supersteps\": {\"values\": %ld, \"crowded\": %ld, \"max_error\": %d, \"ns_per_step\": %.0f},\n",
+			supers.values, supers.crowded, supers.maxError, supers.nsPerStep);
+		fprintf(f, " \"arp\": {\"notes\": %ld, \"wrong\": %ld, \"stuck\": %ld, \"after_release\": %ld, \"heard_new_key\": %s, \"max_late_us\": %d, \"max_gate_error_us\": %d, \"key_change_ns\": %.0f},\n",
+			arps.notes, arps.wrong, arps.stuck, arps.afterRelease, arps.heardNewKey ? "true" : "false", arps.maxLate, arps.maxGateError, arps.nsKeyChange);
+		fprintf(f, " \"echo\": {\"notes\": %ld, \"stuck\": %ld, \"pool_peak\": %d, \"pool_size\": %d, \"stolen\": %ld, \"loop_ns\": %.0f, \"play_ns\": %.0f, \"add_ns\": %.0f},\n",
+			echoes.notes, echoes.stuck, echoes.stats.peak, echoes.stats.poolSize, echoes.stats.stolen, echoes.nsPerLoop, echoes.stats.nsPlay, echoes.stats.nsAdd);
+		fprintf(f, " \"echo_overload\": {\"notes\": %ld, \"stuck\": %ld, \"pool_peak\": %d, \"pool_size\": %d, \"stolen\": %ld, \"loop_ns\": %.0f},\n",
+			overloaded.notes, overloaded.stuck, overloaded.stats.peak, overloaded.stats.poolSize, overloaded.stats.stolen, overloaded.nsPerLoop);
+		fprintf(f, " \"groove\": {\"notes\": %ld, \"early\": %ld, \"wrong_velocity\": %ld, \"stuck\": %ld, \"min_late_us\": %d, \"max_late_us\": %d},\n",
+			grooveResult.notes, grooveResult.early, grooveResult.wrongVelocity, grooveResult.stuck, grooveResult.minLate, grooveResult.maxLate);
+		fprintf(f, " \"nudge\": {\"played\": %s, \"late_us\": %d},\n", nudgeResult.played ? "true" : "false", nudgeResult.late);
+		fprintf(f, " \"tempo\": {\"steps\": %ld, \"clocks\": %ld, \"low_bpm\": %.1f, \"high_bpm\": %.1f, \"max_off_grid_us\": %d, \"early\": %ld, \"late\": %ld, \"stuck\": %ld},\n",
+			tempoResult.steps, tempoResult.clocks, tempoResult.lowBpm, tempoResult.highBpm, tempoResult.maxOffGrid, tempoResult.early, tempoResult.late, tempoResult.stuck);
+		fprintf(f, " \"clock_out\": {\"clocks\": %ld, \"expected\": %ld, \"stalls\": %ld, \"max_jitter_us\": %d, \"bursts\": %ld, \"late\": %ld},\n",
+			clockResult.clocks, clockResult.expected, clockResult.stalls, clockResult.maxJitter, clockResult.bursts, clockResult.late);
+		fprintf(f, " \"mtc\": {\"quarters\": %ld, \"expected\": %ld, \"max_jitter_us\": %d, \"bursts\": %ld, \"out_of_order\": %ld, \"reset_to_zero\": %s, \"reset_offset_us\": %d, \"chase_notes\": %ld, \"wrong_step\": %ld, \"early\": %ld, \"max_late_us\": %d, \"stuck\": %ld, \"seek_near_ns\": %.0f, \"seek_far_ns\": %.0f},\n",
+			mtcResult.quarters, mtcResult.expected, mtcResult.maxJitter, mtcResult.bursts, mtcResult.outOfOrder, mtcResult.resetToZero ? "true" : "false", mtcResult.resetOffset, mtcResult.chaseNotes,
+			mtcResult.wrongStep, mtcResult.early, mtcResult.maxLate, mtcResult.stuck, mtcResult.nsSeekNear, mtcResult.nsSeekFar);
+		fprintf(f, " \"scenarios\": [\n");
+		for (size_t i = 0; i < chosen.size(); ++i) writeJson(f, *chosen[i], results[i], i + 1 == chosen.size());
+		fprintf(f, "]}\n");
+		fclose(f);
+	}
+
+	bool changed = !ramFits || !journalOk(journal) || !songOk(songs[0]) || !songOk(songs[1]) || !sysExOk(sysExResult) || !laneOk(lanes) || !superStepOk(supers) || !arpOk(arps) || !echoOk(echoes, false) || !echoOk(overloaded, true)
+		|| !grooveOk(grooveResult) || !nudgeOk(nudgeResult) || !tempoOk(tempoResult) || !clockOk(clockResult) || !mtcOk(mtcResult);
+	for (const Result& r : results) {
+		if (!strcmp(r.golden, "differs") || !strcmp(r.golden, "missing") || !strcmp(r.repeats, "no") || !r.codec.roundTrip) changed = true;
+		if (r.queues.onDropped || r.queues.offDropped || r.misattributed) changed = true;
+	}
+	return changed ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+# Writes the EEPROM images omx_upgrade checks the version upgrades against (see
+# upgrade.cpp), for the default 8 pattern x 16 step build:
+#   vN.bin          as firmware saving EEPROM_VERSION N would have left it
+#   vN_to_v9.bin    what booting the current firmware on vN.bin must leave
+# The expected images are worked out here from the layouts rather than by the
+# firmware, so a converter that drifts shows up as a difference.
+#   make_images.py [DIR]
+import os
+import random
+import sys
+
+NUM_PATTERNS = 8
+NUM_STEPS = 16
+STEP_SIZE = 12					# sizeof(StepNote), the same in v8
+SETTINGS_SIZE = 7				# sizeof(PatternSettings), likewise
+EEPROM_SIZE = 2048
+PATTERNS = 32					# EEPROM_PATTERN_ADDRESS
+SETTINGS = PATTERNS + NUM_PATTERNS * NUM_STEPS * STEP_SIZE
+JOURNAL = SETTINGS + NUM_PATTERNS * SETTINGS_SIZE
+UPGRADE = 16					# EEPROM_UPGRADE_ADDRESS, to the end of the header
+HEADER_END = 32
+SCRATCH = EEPROM_SIZE - 16		# UPGRADE_SCRATCH, to the end
+CURRENT = 9						# EEPROM_VERSION
+V8_SETTINGS = 1056				# where version 8 put the settings, over steps 85 - 89
+DEFAULT_NOTES = [36, 38, 37, 39, 42, 46, 49, 51]	# patternDefaultNoteMap
+
+
+def step(r, version):
+	# StepNote as GCC packs the bitfields, every field in its range. Bits a
+	# version didn't use yet get junk, as nothing promised to keep them clear
+	stepType = r.randrange(7)
+	s = bytearray(STEP_SIZE)
+	s[0] = r.randrange(128)							# note
+	s[1] = r.randrange(128)							# vel
+	s[2] = r.randrange(16) | r.randrange(2) << 4	# len, trig
+	for i in range(4):
+		s[3 + i] = r.choice([0xFF, r.randrange(128)])	# params, -1 = none
+	s[7] = 0xFF										# params[4], superstep off
+	s[8] = r.randrange(101)							# prob
+	s[9] = r.randrange(37) | (stepType & 3) << 6	# condition, stepType
+	s[10] = stepType >> 2
+	if version >= 9:
+		s[10] |= r.randrange(8) << 1 | r.randrange(4) << 4 | r.randrange(4) << 6	# ratchet, ratchetVel, ratchetSpace
+		s[11] = r.randrange(-12, 13) & 0xFF			# nudge
+	else:
+		s[10] |= r.randrange(128) << 1
+		s[11] = r.randrange(256)					# padding
+	return s
+
+
+def settings(r, version):
+	s = bytearray(SETTINGS_SIZE)
+	length = r.randrange(16)
+	s[0] = length | r.randrange(16) << 4			# len, channel
+	s[1] = r.randrange(length + 1)					# startstep, autoresetstep 0
+	s[2] = r.randrange(4)							# autoresetfreq
+	s[3] = r.randrange(7) << 4						# clockDivMultP
+	s[4] = r.randrange(101)							# autoresetprob
+	s[5] = r.randrange(100) | r.randrange(2) << 7	# swing, reverse
+	s[6] = r.randrange(2) | r.randrange(2) << 2		# mute, solo
+	s[6] |= r.randrange(8) << 3						# groove from v9, junk before
+	return s
+
+
+def default_step(pattern):
+	# defaultStepP, see initPatternDefaults()
+	return bytearray([DEFAULT_NOTES[pattern % 8], 100, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 100, 0, 0, 0])
+
+
+def upgrade_step(s, version):
+	s = bytearray(s)
+	if version < 9:
+		s[10] &= 0x01								# ratchet, ratchetVel, ratchetSpace
+		s[11] = 0									# nudge
+	return s
+
+
+def upgrade_settings(s, version):
+	s = bytearray(s)
+	if version < 9:
+		s[6] &= ~0x38 & 0xFF						# groove
+	return s
+
+
+def v8_image(seed):
+	# version 8 saved the header's first 9 bytes, the steps, then the settings
+	# at a fixed address inside the steps. Nothing past the steps was written
+	r = random.Random(seed)
+	e = bytearray([0xFF]) * EEPROM_SIZE
+	e[0:9] = bytes([8, 2, 3, 4, 21, 22, 23, 24, 25])
+	for i in range(NUM_PATTERNS * NUM_STEPS):
+		a = PATTERNS + i * STEP_SIZE
+		e[a:a + STEP_SIZE] = step(r, 8)
+	for i in range(NUM_PATTERNS):
+		a = V8_SETTINGS + i * SETTINGS_SIZE
+		e[a:a + SETTINGS_SIZE] = settings(r, 8)
+	return e
+
+
+def upgraded(old):
+	e = bytearray(old)
+	version = e[0]
+	if version == 8:
+		# the settings move out of the steps, the steps they were over are lost
+		e[SETTINGS:JOURNAL] = e[V8_SETTINGS:V8_SETTINGS + NUM_PATTERNS * SETTINGS_SIZE]
+		for i in range(NUM_PATTERNS * NUM_STEPS):
+			a = PATTERNS + i * STEP_SIZE
+			if a + STEP_SIZE > V8_SETTINGS and a < V8_SETTINGS + NUM_PATTERNS * SETTINGS_SIZE:
+				e[a:a + STEP_SIZE] = default_step(i // NUM_STEPS)
+		e[11:13] = bytes([NUM_PATTERNS, NUM_STEPS])	# the dimensions, from v9
+	for i in range(NUM_PATTERNS * NUM_STEPS):
+		a = PATTERNS + i * STEP_SIZE
+		e[a:a + STEP_SIZE] = upgrade_step(e[a:a + STEP_SIZE], version)
+	for i in range(NUM_PATTERNS):
+		a = SETTINGS + i * SETTINGS_SIZE
+		e[a:a + SETTINGS_SIZE] = upgrade_settings(e[a:a + SETTINGS_SIZE], version)
+	e[0] = CURRENT
+	e[UPGRADE:HEADER_END] = b'\xff' * (HEADER_END - UPGRADE)	# no upgrade under way
+	e[SCRATCH:] = b'\xff' * (EEPROM_SIZE - SCRATCH)
+	e[JOURNAL] = 0								# a fresh journal
+	e[JOURNAL + 1] = 0xFF
+	return e
+
+
+def main():
+	out = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+	images = {
+		8: v8_image(8),
+	}
+	for version, e in images.items():
+		with open(os.path.join(out, 'v%d.bin' % version), 'wb') as f:
+			f.write(e)
+		with open(os.path.join(out, 'v%d_to_v%d.bin' % (version, CURRENT)), 'wb') as f:
+			f.write(upgraded(e))
+
+
+main()
@@ -0,0 +1,29 @@
+#!/usr/bin/env python3
+# Turn OMX-27.ino into a C++ file the way the Arduino builder does: add
+# prototypes for every function ahead of the code, then append the host hooks.
+#   gen_sketch.py OMX-27.ino sketch_api.inc out.cpp
+import re
+import sys
+
+ino, hooks, out = sys.argv[1:4]
+src = open(ino).read()
+
+proto = re.compile(r'^((?:static\s+|inline\s+)?(?:unsigned\s+|const\s+)?[A-Za-z_][\w:<>]*\s*\*?\s+\*?[A-Za-z_]\w*\s*\([^;{)]*\))\s*\{', re.M)
+protos = []
+for m in proto.finditer(src):
+    sig = m.group(1)
+    if sig.split()[0] in ('else', 'return', 'if', 'while', 'for', 'switch', 'case'):
+        continue
+    protos.append(re.sub(r'\s*=\s*[^,)]+', '', sig) + ';')
+
+# prototypes go after the last #include at the top of the sketch
+last = [m.end() for m in re.finditer(r'^#include.*$', src, re.M)][-1]
+line = src.count('\n', 0, last) + 1
+with open(out, 'w') as f:
+    f.write('#include <Arduino.h>\n')
+    f.write('#line 1 "%s"\n' % ino)
+    f.write(src[:last])
+    f.write('\n' + '\n'.join(protos) + '\n')
+    f.write('#line %d "%s"\n' % (line + 1, ino))
+    f.write(src[last:])
+    f.write('\n#include "%s"\n' % hooks)
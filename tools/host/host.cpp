@@ -0,0 +1,313 @@
+#include "host.h"
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <Adafruit_Keypad.h>
+#include <stdarg.h>
+#include <deque>
+#include <map>
+#include <limits.h>
+#include <unistd.h>
+
+namespace {
+	uint64_t hostClock = 0;
+
+	// pins are pulled up, so only remember the ones held low
+	const int numPins = 64;
+	bool pinLow[numPins];
+	int analogValues[numPins];
+
+	std::deque<keypadEvent> keyEvents;
+
+	std::string serialOut;
+	std::deque<uint8_t> serialIn;
+	bool serialConnected = false;
+
+	uint32_t randomState = 1;
+	uint32_t randomSalt = 0;
+
+	struct Timer {
+		IntervalTimer* owner;
+		void (*callback)();
+		uint64_t period;
+		uint64_t next;
+	};
+	std::vector<Timer> timers;
+
+	void queueKey(int key, int event) {
+		keypadEvent e;
+		e.reg = 0;
+		e.bit.KEY = key;
+		e.bit.EVENT = event;
+		keyEvents.push_back(e);
+	}
+}
+
+usb_serial_class Serial;
+EEPROMClass EEPROM;
+
+namespace host {
+	uint64_t now() {
+		return hostClock;
+	}
+
+	void advance(uint64_t us) {
+		uint64_t until = hostClock + us;
+		for (;;) {
+			// fire timers in time order, each sees the clock at its own due time
+			Timer* due = nullptr;
+			for (Timer& t : timers) {
+				if (t.next <= until && (!due || t.next < due->next)) due = &t;
+			}
+			if (!due) break;
+			hostClock = due->next;
+			due->next += due->period;
+			due->callback();
+		}
+		hostClock = until;
+	}
+
+	void pressKey(int key) {
+		queueKey(key, KEY_JUST_PRESSED);
+	}
+	void releaseKey(int key) {
+		queueKey(key, KEY_JUST_RELEASED);
+	}
+	void setPin(int pin, bool high) {
+		if (pin >= 0 && pin < numPins) pinLow[pin] = !high;
+	}
+	void setAnalog(int pin, int value) {
+		if (pin >= 0 && pin < numPins) analogValues[pin] = value;
+	}
+	void serialInput(const std::string& text) {
+		serialIn.insert(serialIn.end(), text.begin(), text.end());
+	}
+	void setSerialConnected(bool connected) {
+		serialConnected = connected;
+	}
+	std::string& serialOutput() {
+		return serialOut;
+	}
+
+	bool loadEEPROM(const char* path) {
+		FILE* f = fopen(path, "rb");
+		if (!f) return false;
+		eraseEEPROM();
+		size_t n = fread(EEPROM.data, 1, sizeof(EEPROM.data), f);
+		fclose(f);
+		return n > 0;
+	}
+	bool saveEEPROM(const char* path) {
+		FILE* f = fopen(path, "wb");
+		if (!f) return false;
+		bool ok = fwrite(EEPROM.data, 1, sizeof(EEPROM.data), f) == sizeof(EEPROM.data);
+		return fclose(f) == 0 && ok;
+	}
+	void loadEEPROM(const uint8_t* data, size_t size) {
+		eraseEEPROM();
+		memcpy(EEPROM.data, data, std::min(size, sizeof(EEPROM.data)));
+	}
+	void eraseEEPROM() {
+		memset(EEPROM.data, 0xFF, sizeof(EEPROM.data));
+	}
+	void copyEEPROM(uint8_t* data, size_t size) {
+		memcpy(data, EEPROM.data, std::min(size, sizeof(EEPROM.data)));
+	}
+	void cutPowerAfter(long n) {
+		EEPROM.writesLeft = n;
+	}
+	long eepromWrites() {
+		return EEPROM.writes;
+	}
+
+	long firmwareRam() {
+		// /proc/self/exe would be nm itself once popen() runs it
+		char exe[PATH_MAX];
+		ssize_t length = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+		if (length <= 0) return -1;
+		exe[length] = 0;
+		std::string command = std::string("nm -S -l '") + exe + "' 2>/dev/null";
+		FILE* nm = popen(command.c_str(), "r");
+		if (!nm) return -1;
+
+		// size by source file, "dir/../" taken out of the paths
+		std::map<std::string, long> files;
+		char line[4096];
+		while (fgets(line, sizeof(line), nm)) {
+			unsigned long address, size;
+			char type;
+			int at;
+			if (sscanf(line, "%lx %lx %c %n", &address, &size, &type, &at) != 3 || !strchr("bBdD", type)) continue;
+			char* tab = strchr(line + at, '\t');
+			char* colon = tab ? strrchr(tab, ':') : nullptr;
+			if (!colon) continue;
+			std::string path(tab + 1, colon);
+			size_t up;
+			while ((up = path.find("/../")) != std::string::npos && up > 0) {
+				size_t dir = path.rfind('/', up - 1);
+				path.erase(dir == std::string::npos ? 0 : dir, up + 3 - (dir == std::string::npos ? 0 : dir));
+			}
+			files[path] += size;
+		}
+		if (pclose(nm) != 0) return -1;
+
+		std::string root;
+		for (const auto& f : files) {
+			size_t slash = f.first.rfind('/');
+			if (slash != std::string::npos && f.first.compare(slash, std::string::npos, "/OMX-27.ino") == 0) {
+				root = f.first.substr(0, slash + 1);
+			}
+		}
+		if (root.empty()) return -1;
+		long total = 0;
+		for (const auto& f : files) {
+			if (f.first.compare(0, root.size(), root) == 0 && f.first.find('/', root.size()) == std::string::npos) {
+				total += f.second;
+			}
+		}
+		return total;
+	}
+
+	void seedRandom(uint32_t seed) {
+		randomSalt = seed;
+		srand(seed);
+		analogValues[13] = seed & 0x1FFF;		// 13 bit ADC
+	}
+}
+
+// ---- Teensy core stand-ins
+
+unsigned long micros() {
+	return (unsigned long)(uint32_t)hostClock;
+}
+unsigned long millis() {
+	return (unsigned long)(uint32_t)(hostClock / 1000);
+}
+void delay(unsigned long ms) {
+	host::advance((uint64_t)ms * 1000);
+}
+void delayMicroseconds(unsigned int us) {
+	host::advance(us);
+}
+
+void pinMode(int, int) {}
+int digitalRead(int pin) {
+	return (pin >= 0 && pin < numPins && pinLow[pin]) ? LOW : HIGH;
+}
+void digitalWrite(int, int) {}
+int analogRead(int pin) {
+	return (pin >= 0 && pin < numPins) ? analogValues[pin] : 0;
+}
+void analogWrite(int, int) {}
+void analogReadResolution(int) {}
+void analogWriteResolution(int) {}
+
+void randomSeed(unsigned long seed) {
+	randomState = (uint32_t)seed ^ randomSalt;
+	if (randomState == 0) randomState = 1;
+}
+long random(long howbig) {
+	if (howbig <= 0) return 0;
+	// xorshift32
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState % howbig;
+}
+long random(long howsmall, long howbig) {
+	if (howsmall >= howbig) return howsmall;
+	return howsmall + random(howbig - howsmall);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+	return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+char* itoa(int value, char* buf, int radix) {
+	char digits[34];
+	int n = 0;
+	unsigned int v = (value < 0 && radix == 10) ? -value : value;
+	do {
+		int d = v % radix;
+		digits[n++] = d < 10 ? '0' + d : 'a' + d - 10;
+		v /= radix;
+	} while (v);
+	char* p = buf;
+	if (value < 0 && radix == 10) *p++ = '-';
+	while (n) *p++ = digits[--n];
+	*p = 0;
+	return buf;
+}
+
+size_t Print::write(const uint8_t* buf, size_t len) {
+	size_t n = 0;
+	while (len--) n += write(*buf++);
+	return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+	char buf[256];
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	if (n < 0) return 0;
+	return write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1));
+}
+
+usb_serial_class::operator bool() {
+	return serialConnected;
+}
+size_t usb_serial_class::write(uint8_t b) {
+	serialOut.push_back(b);
+	return 1;
+}
+size_t usb_serial_class::write(const uint8_t* buf, size_t len) {
+	serialOut.append((const char*)buf, len);
+	return len;
+}
+int usb_serial_class::available() {
+	return serialIn.size();
+}
+int usb_serial_class::read() {
+	if (serialIn.empty()) return -1;
+	int c = serialIn.front();
+	serialIn.pop_front();
+	return c;
+}
+
+bool Adafruit_Keypad::available() {
+	return !keyEvents.empty();
+}
+keypadEvent Adafruit_Keypad::read() {
+	keypadEvent e = keyEvents.front();
+	keyEvents.pop_front();
+	return e;
+}
+
+bool IntervalTimer::begin(void (*callback)(), unsigned long microseconds) {
+	end();
+	if (microseconds == 0) return false;
+	timers.push_back({ this, callback, microseconds, hostClock + microseconds });
+	return true;
+}
+bool IntervalTimer::begin(void (*callback)(), float microseconds) {
+	return begin(callback, (unsigned long)(microseconds + 0.5f));
+}
+void IntervalTimer::update(unsigned long microseconds) {
+	// like the hardware, the new period starts after the current one
+	for (Timer& t : timers) {
+		if (t.owner == this) t.period = microseconds;
+	}
+}
+void IntervalTimer::update(float microseconds) {
+	update((unsigned long)(microseconds + 0.5f));
+}
+void IntervalTimer::end() {
+	for (size_t i = 0; i < timers.size(); ++i) {
+		if (timers[i].owner == this) {
+			timers.erase(timers.begin() + i);
+			return;
+		}
+	}
+}
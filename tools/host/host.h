@@ -0,0 +1,67 @@
+#pragma once
+
+// Host simulator - runs the unmodified sketch on Linux.
+//
+// The sketch is built against the stand-ins in arduino/, with host_mm.cpp in
+// place of MM.cpp and host_input.cpp in place of ClearUI_Input.cpp. Time only moves when the driver calls host::advance(), so a
+// run is deterministic and can go as fast as the host CPU allows. Drivers talk
+// to the sketch through sketch_api.h and to the "hardware" through this file.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace host {
+	// virtual clock, in microseconds since power on
+	uint64_t now();
+	void advance(uint64_t us);		// fires IntervalTimer callbacks due on the way
+
+	// inputs
+	void pressKey(int key);
+	void releaseKey(int key);
+	void setPin(int pin, bool high);		// pins read HIGH (pulled up) by default
+	void setAnalog(int pin, int value);
+	void turnEncoder(int dir, int speedup);		// one detent, delivered by the next Encoder::update()
+	void encoderButton(int state);				// Button::State, delivered by the next Button::update()
+	void serialInput(const std::string& text);
+	void setSerialConnected(bool connected);
+
+	// outputs
+	std::string& serialOutput();
+
+	// EEPROM image
+	bool loadEEPROM(const char* path);
+	void loadEEPROM(const uint8_t* data, size_t size);
+	bool saveEEPROM(const char* path);
+	void eraseEEPROM();
+	void copyEEPROM(uint8_t* data, size_t size);		// the image as it is now
+
+	// power cuts: once n more EEPROM bytes have been programmed the next one
+	// throws PowerCut instead, leaving the image as it would be after a power
+	// pull there. -1 keeps the power on
+	struct PowerCut {};
+	void cutPowerAfter(long n);
+	long eepromWrites();		// bytes programmed since power on
+
+	// static RAM the firmware's globals take: the data and bss symbols of this
+	// executable whose debug line info puts them in the sketch's own sources,
+	// next to OMX-27.ino. Needs nm and a -g build, -1 if they can't be read
+	long firmwareRam();
+
+	// the sketch seeds its random streams from ADC noise on pin 13 at power on,
+	// this sets that reading (and seeds random() and rand() for good measure)
+	void seedRandom(uint32_t seed);
+
+	// MIDI out as sent through MM, USB and DIN see the same stream
+	struct MidiEvent {
+		uint64_t time;
+		uint8_t size;
+		uint8_t data[3];
+	};
+	std::vector<MidiEvent>& midiOut();
+	std::vector<uint8_t>& sysExOut();		// raw SysEx bytes sent with MM::sendSysEx
+
+	// MIDI in, delivered one message per MM::usbMidiRead() / midiRead()
+	void midiIn(const uint8_t* data, int len);
+	void sysExIn(const uint8_t* data, int len);
+}
@@ -0,0 +1,25 @@
+// ClearUI_Display for the host simulator - the display is a sink
+#include "ClearUI_Display.h"
+
+Adafruit_SSD1306 display;
+
+void initializeDisplay() {}
+void setRotationSideways() {}
+void setRotationNormal() {}
+
+void defaultText(int) {}
+void serifText(int) {}
+void mono9Text(int) {}
+void silkText(int) {}
+void liquidText(int) {}
+void sans9bText(int) {}
+void tomText(int) {}
+void picoText(int) {}
+void tinyText(int) {}
+void f5Text(int) {}
+
+void centerText(const char*, int16_t, int16_t, uint16_t, uint16_t) {}
+void centerNumber(unsigned int, uint16_t, uint16_t, uint16_t, uint16_t) {}
+
+bool updateSaver(bool) { return false; }
+void dumpDisplayPBM(Print&) {}
@@ -0,0 +1,85 @@
+// ClearUI input for the host simulator - replaces ClearUI_Input.cpp. The
+// encoder and its button report whatever the driver queued with
+// host::turnEncoder() / host::encoderButton(), one event per update(), rather
+// than decoding pins, so a recorded session replays exactly.
+
+#include "ClearUI_Input.h"
+#include "host.h"
+
+#include <Arduino.h>
+#include <deque>
+
+namespace {
+	struct Turn {
+		int16_t dir;
+		int16_t speedup;
+	};
+	std::deque<Turn> turns;
+	std::deque<Button::State> buttonEvents;
+}
+
+namespace host {
+	void turnEncoder(int dir, int speedup) {
+		turns.push_back({ (int16_t)dir, (int16_t)speedup });
+	}
+	void encoderButton(int state) {
+		buttonEvents.push_back((Button::State)state);
+	}
+}
+
+Encoder::Encoder(uint32_t pinA, uint32_t pinB)
+	: pinA(pinA), pinB(pinB)
+{
+	a = HIGH;
+	b = HIGH;
+	quads = 0;
+	lastUpdate = 0;
+}
+
+Encoder::Update Encoder::update() {
+	if (turns.empty()) return Update(0, 0);
+	Turn t = turns.front();
+	turns.pop_front();
+	lastUpdate = millis();
+	return Update(t.dir, t.speedup);
+}
+
+Button::Button(uint32_t pin)
+	: pin(pin)
+{
+	lastRead = HIGH;
+	validAtTime = 0;
+	state = Up;
+	longAtTime = 0;
+}
+
+Button::State Button::update() {
+	if (buttonEvents.empty()) return NoChange;
+	State next = buttonEvents.front();
+	buttonEvents.pop_front();
+	if (next == NoChange || next == state) return NoChange;
+	state = next;
+	return state;
+}
+
+
+IdleTimeout::IdleTimeout(unsigned long period)
+	: idle(true), period(period)
+	{ }
+
+void IdleTimeout::activity() {
+	idle = false;
+	idleAtTime = millis() + period;
+}
+
+bool IdleTimeout::update() {
+	if (idle)
+		return false;
+
+	if (millis() > idleAtTime) {
+		idle = true;
+		return true;
+	}
+
+	return false;
+}
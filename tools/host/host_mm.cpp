@@ -0,0 +1,125 @@
+// MM for the host simulator - replaces MM.cpp, MIDI out is collected for the
+// driver and MIDI in comes from host::midiIn() / host::sysExIn()
+
+#include "MM.h"
+#include "host.h"
+
+#include <Arduino.h>
+#include <deque>
+
+namespace {
+	std::vector<host::MidiEvent> out;
+	std::vector<uint8_t> sysExOut;
+
+	struct Incoming {
+		bool sysEx;
+		std::vector<uint8_t> data;
+	};
+	std::deque<Incoming> incoming;
+
+	void (*sysExHandler)(const uint8_t* data, uint16_t length, bool complete) = nullptr;
+	void (*realTimeSent)(uint8_t status, uint32_t micros) = nullptr;
+	void (*quarterFrameHandler)(uint8_t data) = nullptr;
+
+	uint32_t firstSend = 0;
+	uint32_t firstReceive = 0;
+
+	void send(uint8_t status, uint8_t d1, uint8_t d2, uint8_t size) {
+		if (!firstSend) firstSend = micros();
+		host::MidiEvent e;
+		e.time = host::now();
+		e.size = size;
+		e.data[0] = status;
+		e.data[1] = d1;
+		e.data[2] = d2;
+		out.push_back(e);
+	}
+
+	bool read() {
+		if (incoming.empty()) return false;
+		Incoming in = incoming.front();
+		incoming.pop_front();
+		if (!firstReceive) firstReceive = micros();
+		if (in.sysEx && sysExHandler) {
+			sysExHandler(in.data.data(), in.data.size(), true);
+		} else if (!in.sysEx && in.data.size() >= 2 && in.data[0] == 0xF1 && quarterFrameHandler) {
+			quarterFrameHandler(in.data[1]);
+		}
+		return true;
+	}
+}
+
+namespace host {
+	std::vector<MidiEvent>& midiOut() {
+		return out;
+	}
+	std::vector<uint8_t>& sysExOut() {
+		return ::sysExOut;
+	}
+	void midiIn(const uint8_t* data, int len) {
+		incoming.push_back({ false, std::vector<uint8_t>(data, data + len) });
+	}
+	void sysExIn(const uint8_t* data, int len) {
+		incoming.push_back({ true, std::vector<uint8_t>(data, data + len) });
+	}
+}
+
+namespace MM {
+	void begin() {
+	}
+	void sendNoteOn(int note, int velocity, int channel) {
+		send(0x90 | ((channel - 1) & 0x0F), note, velocity, 3);
+	}
+	void sendNoteOff(int note, int velocity, int channel) {
+		send(0x80 | ((channel - 1) & 0x0F), note, velocity, 3);
+	}
+	void sendControlChange(int control, int value, int channel) {
+		send(0xB0 | ((channel - 1) & 0x0F), control, value, 3);
+	}
+	void sendSysEx(int length, const uint8_t* data) {
+		if (!firstSend) firstSend = micros();
+		::sysExOut.insert(::sysExOut.end(), data, data + length);
+	}
+
+	void sendClock() {
+		send(0xF8, 0, 0, 1);
+	}
+	void startClock() {
+		send(0xFA, 0, 0, 1);
+	}
+	void continueClock() {
+		send(0xFB, 0, 0, 1);
+	}
+	void stopClock() {
+		send(0xFC, 0, 0, 1);
+	}
+
+	// timers only fire between loop() passes here, so never in the middle of a send
+	void sendRealTime(uint8_t status, uint8_t data) {
+		send(status, data, 0, status == 0xF1 ? 2 : 1);
+		if (realTimeSent) realTimeSent(status, micros());
+	}
+	void setHandleRealTimeSent(void (*handler)(uint8_t status, uint32_t micros)) {
+		realTimeSent = handler;
+	}
+
+	bool usbMidiRead() {
+		return read();
+	}
+	bool midiRead() {
+		return false;
+	}
+	void setHandleSysEx(void (*handler)(const uint8_t* data, uint16_t length, bool complete)) {
+		sysExHandler = handler;
+	}
+	void setHandleTimeCodeQuarterFrame(void (*handler)(uint8_t data)) {
+		quarterFrameHandler = handler;
+	}
+
+	uint32_t firstSendMicros() {
+		return firstSend;
+	}
+	uint32_t firstReceiveMicros() {
+		return firstReceive;
+	}
+}
@@ -0,0 +1,164 @@
+// Offline renderer: plays the sequencer on the host simulator as fast as the
+// CPU allows and writes what it sent as a Standard MIDI File.
+//
+//   omx_render [--eeprom image.bin | --syx dump.syx] [--mode S1|S2]
+//              [--bpm 120] [--seed 1] [--bars 8] [--loop-us 0] -o out.mid
+//
+// --eeprom takes a 2K EEPROM image, --syx a pattern dump saved with
+// browser_test/sysex.html. --seed stands in for the ADC noise the unit seeds
+// its random streams from, so probability, random step types, drunken swing and
+// auto reset render the same way every time (a stored pattern seed wins). With --loop-us 0 the simulated loop() runs once per
+// clock tick (PPQ 96), otherwise once every N microseconds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "host.h"
+#include "sketch_api.h"
+#include "smf.h"
+
+namespace {
+	const int PPQ = 96;
+	const int MODE_S1 = 1;
+	const int MODE_S2 = 2;
+
+	void usage(const char* name) {
+		fprintf(stderr, "usage: %s [--eeprom image.bin | --syx dump.syx] [--mode S1|S2] [--bpm 120]\n"
+			"          [--seed 1] [--bars 8] [--loop-us 0] -o out.mid\n", name);
+		exit(2);
+	}
+
+	bool readFile(const char* path, std::vector<uint8_t>& data) {
+		FILE* f = fopen(path, "rb");
+		if (!f) return false;
+		uint8_t buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+		fclose(f);
+		return true;
+	}
+
+	// send a dump through the unit's own SysEx loader, one chunk per loop
+	bool loadSysEx(const char* path) {
+		std::vector<uint8_t> data;
+		if (!readFile(path, data)) return false;
+
+		size_t start = 0;
+		int chunks = 0;
+		for (size_t i = 0; i < data.size(); ++i) {
+			if (data[i] == 0xF0) start = i;
+			if (data[i] == 0xF7) {
+				host::sysExIn(&data[start], i + 1 - start);
+				sketchLoop();
+				host::advance(1000);
+				chunks++;
+			}
+		}
+		// give the sketch a few loops to swap the load in
+		for (int i = 0; i < 10; ++i) {
+			sketchLoop();
+			host::advance(1000);
+		}
+
+		// every chunk is answered with F0 7D 27 05 seq <high bits> <status> ...
+		std::vector<uint8_t>& acks = host::sysExOut();
+		int good = 0;
+		for (size_t i = 0; i + 6 < acks.size(); ++i) {
+			if (acks[i] == 0xF0 && acks[i + 3] == 0x05) {
+				if (acks[i + 6] != 0) {
+					fprintf(stderr, "%s: chunk %d rejected, status %d\n", path, acks[i + 4], acks[i + 6]);
+					return false;
+				}
+				good++;
+			}
+		}
+		return chunks > 0 && good == chunks;
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* eeprom = nullptr;
+	const char* syx = nullptr;
+	const char* out = nullptr;
+	int mode = -1;
+	float bpm = 120;
+	uint32_t seed = 1;
+	int bars = 8;
+	uint32_t loopMicros = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value) usage(argv[0]);
+		if (!strcmp(arg, "--eeprom")) eeprom = value;
+		else if (!strcmp(arg, "--syx")) syx = value;
+		else if (!strcmp(arg, "-o")) out = value;
+		else if (!strcmp(arg, "--mode")) mode = !strcmp(value, "S1") ? MODE_S1 : MODE_S2;
+		else if (!strcmp(arg, "--bpm")) bpm = atof(value);
+		else if (!strcmp(arg, "--seed")) seed = strtoul(value, nullptr, 0);
+		else if (!strcmp(arg, "--bars")) bars = atoi(value);
+		else if (!strcmp(arg, "--loop-us")) loopMicros = strtoul(value, nullptr, 0);
+		else usage(argv[0]);
+		i++;
+	}
+	if (!out || bars <= 0 || bpm < 40 || bpm > 300) usage(argv[0]);
+
+	host::seedRandom(seed);
+	if (eeprom && !host::loadEEPROM(eeprom)) {
+		fprintf(stderr, "can't read %s\n", eeprom);
+		return 1;
+	}
+
+	auto wallStart = std::chrono::steady_clock::now();
+
+	sketchSetup();
+	sketchEndBoot();
+	if (syx && !loadSysEx(syx)) {
+		fprintf(stderr, "%s didn't load\n", syx);
+		return 1;
+	}
+
+	if (mode < 0) {
+		mode = sketchMode() == MODE_S1 ? MODE_S1 : MODE_S2;
+	}
+	sketchSetMode(mode);
+	sketchSetTempo(bpm);
+	unsigned long ppq = sketchPpqInterval();
+	uint64_t step = loopMicros ? loopMicros : ppq;
+
+	host::midiOut().clear();
+	uint64_t start = host::now();
+	uint64_t end = start + (uint64_t)bars * 4 * PPQ * ppq;
+	long loops = 0;
+
+	sketchStart();
+	while (host::now() < end) {
+		sketchLoop();
+		host::advance(step);
+		loops++;
+	}
+	sketchStop();		// all notes off land on the last tick
+
+	auto wallEnd = std::chrono::steady_clock::now();
+
+	SmfWriter smf(PPQ);
+	smf.tempo(0, ppq * PPQ);
+	for (const host::MidiEvent& e : host::midiOut()) {
+		if (e.data[0] >= 0xF0) continue;		// clock and transport don't go in a file
+		uint32_t tick = (e.time - start + ppq / 2) / ppq;
+		smf.event(tick, e.data, e.size);
+	}
+	if (!smf.save(out)) {
+		fprintf(stderr, "can't write %s\n", out);
+		return 1;
+	}
+
+	double wall = std::chrono::duration<double>(wallEnd - wallStart).count();
+	double simulated = (end - start) / 1e6;
+	printf("%d bars at %.1f BPM (%.1f s), %d events, %ld loops\n", bars, bpm, simulated, smf.events(), loops);
+	printf("%.3f s wall, %.0fx real time, %.0f events/s, %.0f loops/s\n",
+		wall, simulated / wall, host::midiOut().size() / wall, loops / wall);
+	return 0;
+}
@@ -0,0 +1,248 @@
+// Replays a session recorded by a unit built with INPUT_RECORD 1 (see
+// inputlog.h) on the host simulator.
+//
+//   stty -F /dev/ttyACM0 raw && cat /dev/ttyACM0 > session.bin &
+//   printf i > /dev/ttyACM0
+//
+//   omx_replay session.bin [--eeprom image.bin] [--loop-us 100] [--tail-ms 2000]
+//              [--text out.txt] [-o out.mid] [--trace trace.bin]
+//
+// The sketch boots from the EEPROM the unit booted from (or --eeprom), gets the
+// same random seed, and every logged input is delivered on a loop() pass at the
+// micros() the unit read it. Between inputs loop() runs every --loop-us.
+// --text writes what was sent as "micros bytes" lines, handy for diffing two
+// builds when bisecting; -o writes a Standard MIDI File at 1 tick per ms;
+// --trace saves the firmware's timing trace for tools/trace_decode.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "host.h"
+#include "sketch_api.h"
+#include "smf.h"
+#include "../../inputlog.h"
+
+namespace {
+	struct Input {
+		uint64_t micros;		// unwrapped
+		uint8_t event;
+		uint8_t a;
+		uint8_t b;
+		uint8_t c;
+	};
+
+	struct Capture {
+		std::vector<uint8_t> eeprom;
+		std::vector<Input> inputs;
+		long lost = 0;
+	};
+
+	void usage(const char* name) {
+		fprintf(stderr, "usage: %s session.bin [--eeprom image.bin] [--loop-us 100] [--tail-ms 2000]\n"
+			"          [--text out.txt] [-o out.mid] [--trace trace.bin]\n", name);
+		exit(2);
+	}
+
+	bool readFile(const char* path, std::vector<uint8_t>& data) {
+		FILE* f = fopen(path, "rb");
+		if (!f) return false;
+		uint8_t buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+		fclose(f);
+		return true;
+	}
+
+	// pick the input frames out of a serial capture, anything else is skipped
+	void parse(const std::vector<uint8_t>& data, Capture& cap) {
+		uint32_t last = 0;
+		uint64_t base = 0;
+		size_t i = 0;
+		while (i + INPUT_FRAME_HEADER <= data.size()) {
+			const uint8_t* f = &data[i];
+			bool eeprom = !memcmp(f, "OMXE", 4);
+			if ((!eeprom && memcmp(f, "OMXI", 4)) || f[4] != INPUT_FORMAT_VERSION) {
+				i++;
+				continue;
+			}
+			size_t size = INPUT_FRAME_HEADER + (eeprom ? f[5] : f[5] * INPUT_RECORD_SIZE);
+			if (i + size > data.size()) break;
+
+			if (eeprom) {
+				size_t offset = f[6] | (f[7] << 8);
+				if (cap.eeprom.size() < offset + f[5]) cap.eeprom.resize(offset + f[5], 0xFF);
+				memcpy(&cap.eeprom[offset], f + INPUT_FRAME_HEADER, f[5]);
+			} else {
+				cap.lost = f[6] | (f[7] << 8);
+				const uint8_t* r = f + INPUT_FRAME_HEADER;
+				for (int k = 0; k < f[5]; ++k, r += INPUT_RECORD_SIZE) {
+					uint32_t t = r[0] | (r[1] << 8) | (r[2] << 16) | ((uint32_t)r[3] << 24);
+					if (!cap.inputs.empty() && t < last && last - t > 0x80000000UL) base += 0x100000000ULL;
+					last = t;
+					cap.inputs.push_back({ base + t, r[4], r[5], r[6], r[7] });
+				}
+			}
+			i += size;
+		}
+	}
+
+	void deliver(const Input& in) {
+		switch (in.event) {
+			case INPUT_KEY:
+				if (in.b == 1) host::pressKey(in.a);		// KEY_JUST_PRESSED
+				else host::releaseKey(in.a);
+				break;
+			case INPUT_ENCODER:
+				host::turnEncoder((int8_t)in.a, in.b);
+				break;
+			case INPUT_BUTTON:
+				host::encoderButton(in.a);
+				break;
+			case INPUT_POT:
+				host::setAnalog(sketchPotPin(in.a), in.b | (in.c << 8));
+				break;
+			case INPUT_MIDI: {
+				uint8_t msg[3] = { in.a, in.b, in.c };
+				host::midiIn(msg, 3);
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	void runUntil(uint64_t until, uint64_t loopMicros, long& loops) {
+		while (host::now() < until) {
+			sketchLoop();
+			loops++;
+			host::advance(std::min(loopMicros, until - host::now()));
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* session = nullptr;
+	const char* eepromPath = nullptr;
+	const char* textPath = nullptr;
+	const char* midPath = nullptr;
+	const char* tracePath = nullptr;
+	uint64_t loopMicros = 100;
+	uint64_t tailMicros = 2000000;
+
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if (arg[0] != '-') {
+			if (session) usage(argv[0]);
+			session = arg;
+			continue;
+		}
+		const char* value = i + 1 < argc ? argv[++i] : nullptr;
+		if (!value) usage(argv[0]);
+		if (!strcmp(arg, "--eeprom")) eepromPath = value;
+		else if (!strcmp(arg, "--loop-us")) loopMicros = strtoul(value, nullptr, 0);
+		else if (!strcmp(arg, "--tail-ms")) tailMicros = strtoul(value, nullptr, 0) * 1000ULL;
+		else if (!strcmp(arg, "--text")) textPath = value;
+		else if (!strcmp(arg, "-o")) midPath = value;
+		else if (!strcmp(arg, "--trace")) tracePath = value;
+		else usage(argv[0]);
+	}
+	if (!session || loopMicros == 0) usage(argv[0]);
+
+	std::vector<uint8_t> data;
+	if (!readFile(session, data)) {
+		fprintf(stderr, "can't read %s\n", session);
+		return 1;
+	}
+	Capture cap;
+	parse(data, cap);
+	if (cap.inputs.empty() || cap.inputs[0].event != INPUT_BOOT) {
+		fprintf(stderr, "%s: no input log from boot (build with INPUT_RECORD 1 and send 'i')\n", session);
+		return 1;
+	}
+	if (cap.lost) {
+		fprintf(stderr, "%s: the unit dropped %ld inputs after its log filled up, the replay stops at the last one logged\n",
+			session, cap.lost);
+	}
+
+	if (eepromPath) {
+		if (!host::loadEEPROM(eepromPath)) {
+			fprintf(stderr, "can't read %s\n", eepromPath);
+			return 1;
+		}
+	} else if (!cap.eeprom.empty()) {
+		host::loadEEPROM(cap.eeprom.data(), cap.eeprom.size());
+	} else {
+		fprintf(stderr, "%s: no EEPROM image in the capture, booting blank\n", session);
+	}
+
+	// setup() ran at the boot record's micros, and read its seed there too
+	const uint64_t boot = cap.inputs[0].micros;
+	size_t next = 1;
+	host::seedRandom(0);
+	for (; next < cap.inputs.size() && cap.inputs[next].micros == boot; ++next) {
+		const Input& in = cap.inputs[next];
+		if (in.event == INPUT_SEED) host::setAnalog(13, in.b | (in.c << 8));
+	}
+	host::advance(boot);
+	host::setSerialConnected(true);
+	sketchSetup();
+	if (tracePath) host::serialInput("t");
+
+	long loops = 0;
+	while (next < cap.inputs.size()) {
+		uint64_t at = cap.inputs[next].micros;
+		runUntil(at, loopMicros, loops);
+		for (; next < cap.inputs.size() && cap.inputs[next].micros == at; ++next) {
+			deliver(cap.inputs[next]);
+		}
+		sketchLoop();		// the pass that read them
+		loops++;
+		uint64_t following = next < cap.inputs.size() ? cap.inputs[next].micros : at + loopMicros;
+		host::advance(std::min(loopMicros, following - at));
+	}
+	uint64_t end = host::now() + tailMicros;
+	runUntil(end, loopMicros, loops);
+
+	const std::vector<host::MidiEvent>& out = host::midiOut();
+	if (textPath) {
+		FILE* f = fopen(textPath, "w");
+		if (!f) {
+			fprintf(stderr, "can't write %s\n", textPath);
+			return 1;
+		}
+		for (const host::MidiEvent& e : out) {
+			fprintf(f, "%llu", (unsigned long long)e.time);
+			for (int i = 0; i < e.size; ++i) fprintf(f, " %02X", e.data[i]);
+			fprintf(f, "\n");
+		}
+		fclose(f);
+	}
+	if (midPath) {
+		SmfWriter smf(500);
+		smf.tempo(0, 500000);
+		for (const host::MidiEvent& e : out) {
+			if (e.data[0] >= 0xF0) continue;
+			smf.event((e.time - boot) / 1000, e.data, e.size);
+		}
+		if (!smf.save(midPath)) {
+			fprintf(stderr, "can't write %s\n", midPath);
+			return 1;
+		}
+	}
+	if (tracePath) {
+		const std::string& serial = host::serialOutput();
+		FILE* f = fopen(tracePath, "wb");
+		if (!f || fwrite(serial.data(), 1, serial.size(), f) != serial.size()) {
+			fprintf(stderr, "can't write %s\n", tracePath);
+			if (f) fclose(f);
+			return 1;
+		}
+		fclose(f);
+	}
+
+	printf("%zu inputs over %.1f s, %ld loops, %zu MIDI events out\n", cap.inputs.size(),
+		(end - boot) / 1e6, loops, out.size());
+	return 0;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+// Hooks into the sketch for host drivers, defined in sketch_api.inc which is
+// compiled as part of the sketch so it can reach the sketch's globals.
+
+#include <stdint.h>
+
+void sketchSetup();
+void sketchLoop();
+void sketchDoStep();						// just the sequencer's step check, as loop() calls it
+
+void sketchSetMode(int mode);			// OMXMode
+int sketchMode();
+void sketchSetTempo(float bpm);			// from the next MIDI clock tick while playing, see tempo.h
+void sketchTempoRamp(int bpm, int bars);	// from the tempo now to bpm over bars
+float sketchTempo();
+void sketchStart();
+void sketchStop();
+void sketchReset();						// back to the first step on the next step, as F1 + AUX
+void sketchSetSeed(int seed);			// pattern seed, 0 - 99
+bool sketchPlaying();
+unsigned long sketchPpqInterval();
+bool sketchBooting();
+void sketchEndBoot();
+
+// pattern data, in UI units rather than the packed EEPROM records
+struct SketchStep {
+	int note;
+	int vel;
+	int len;			// 0 - 15, in steps
+	bool play;
+	int params[4];		// p-lock CC values, -1 = none
+	int prob;			// 0 - 100
+	int condition;		// A:B condition, 0 = always
+	int stepType;		// StepType
+	int ratchets;		// hits, 0 or 1 = just the one
+	int ratchetVel;		// RatchetVelocity
+	int ratchetSpace;	// RatchetSpacing
+	int nudge;			// ticks, 24 to a step, - is early
+};
+
+struct SketchPattern {
+	int len;			// 1 - sketchNumSteps()
+	int channel;		// 1 - 16
+	int swing;			// 0 - 99
+	int clockDiv;		// index into multValues, 0 = 1/64 .. 6 = whole
+	bool mute;
+	int groove;			// Grooves::table, 0 = off
+};
+
+void sketchSetStep(int pattern, int step, const SketchStep& s);
+void sketchSetPattern(int pattern, const SketchPattern& p);
+void sketchSetMute(int pattern, bool mute);
+int sketchNumPatterns();
+int sketchNumSteps();
+
+// what the build's pattern dimensions (see dimensions.h) cost
+struct SketchBudget {
+	long patternRam;		// step data, plans, bank shadow copy, copy buffer and per-step counters
+	long staticRam;			// every global of the sketch and its modules, patternRam included (see host::firmwareRam())
+	long ramReserve;		// what the Teensy core, its libraries and the stack need on top
+	long ramSize;
+	long eepromUsed;		// header, and the fixed pattern image when the patterns are in EEPROM
+	long eepromSize;
+	long bankFile;			// one bank file
+	int banks;
+	long bankFlash;			// flash set aside for them
+	bool patternsInEeprom;
+};
+
+SketchBudget sketchBudget();
+
+// the pattern edit journal (see journal.h), unused when the patterns are in the bank files
+struct SketchJournalStats {
+	int used;				// bytes
+	int capacity;
+	int records;			// replay() applied
+	double nsReplay;		// host time
+};
+
+void sketchSave();						// as saving from the UI: header, journal and bank file
+SketchJournalStats sketchJournalReplay(int repeats);
+uint32_t sketchPatternChecksum();		// the live steps and settings
+
+// the live patterns in the compact bank / SysEx format (see patterncodec.h)
+struct SketchCodecStats {
+	long rawBytes;			// steps and settings records as they are
+	long compactBytes;
+	double nsEncode;		// per pattern, host time
+	double nsDecode;
+	bool roundTrip;			// decoded back to the same records
+};
+
+SketchCodecStats sketchCodecStats(int repeats);
+
+// song mode (see song.h)
+void sketchSaveBank(int bank);			// the live patterns to a bank file, which becomes the current bank
+void sketchSetSongSlot(int slot, int bank, int pattern, int bars);
+void sketchSongEnable(bool on);
+int sketchSongLateBars();
+double sketchSongSwapNs(int repeats);	// one slot change to another bank, host time
+void sketchSelectBank(int bank);		// as turning BANK, read in the background
+bool sketchBankPending();				// a bank is read and waits for the bar
+void sketchSendDump();					// as a dump request, the live patterns to host::sysExOut()
+double sketchDumpNs(int repeats);		// building and sending a full dump, host time
+double sketchLoadNs(const uint8_t* syx, int length, int repeats);	// the unit's side of a load, per message, host time
+
+int sketchPotPin(int pot);		// analog pin host::setAnalog() feeds pot 0 - 4 through
+int sketchPotCC(int pot);		// the CC it sends
+
+// CC automation lanes (see cclanes.h)
+struct SketchLaneStats {
+	int lanes;
+	int points;
+	int bytes;				// all lanes' points
+	int poolUsed;
+	int poolSize;
+	double nsPerStep;		// playLanes() for a pattern with lanes, host time
+};
+
+void sketchSetCCRecord(bool on);		// as F1 + F2 + AUX, off ends the take
+SketchLaneStats sketchLaneStats(int pattern, int repeats);
+
+// supersteps (see superstep.h)
+void sketchSetSuperStep(int pattern, int step, int wave, int rate, int dest);		// wave -1 = off
+int sketchLfoTicks(int dest);			// PPQ ticks between its values
+double sketchSuperStepNs(int repeats);	// starting and scheduling a step's values, host time
+
+// MIDI mode arpeggiator (see arp.h)
+void sketchSetArp(bool on, int mode, int octaves, int rate, int gate);		// rate indexes multValues, gate in percent
+int sketchKeyNote(int key);				// the note a key plays in MIDI mode
+double sketchArpKeyNs(int repeats);		// a press and a release with the arp full, host time
+
+// the pending note queues (see noteoffs.h)
+struct SketchQueueStats {
+	int onSize, onPeak;
+	long onDropped;
+	int offSize, offPeak;
+	long offDropped;
+};
+
+SketchQueueStats sketchQueueStats();
+
+// echo (see echo.h)
+struct SketchEchoStats {
+	int poolSize;
+	int peak;				// most voices in use at once
+	long stolen;
+	double nsPlay;			// play() over a full pool with nothing due, host time
+	double nsAdd;			// add() taking a voice from a full pool
+};
+
+void sketchSetEcho(int source, int repeats, int feedback, int time, int shift);		// source NUM_PATTERNS is MIDI mode
+SketchEchoStats sketchEchoStats(int repeats);
+int sketchEchoPatterns();		// patterns the pool holds at the heaviest 1/8 echo
+
+// MIDI time code (see mtc.h)
+void sketchSetMtc(int mode, int rate);			// MtcMode, and MtcRate out
+void sketchMtcLocate(uint64_t micros);			// where time code out starts, while stopped
+double sketchSeekNs(uint32_t ppqTicks, int repeats);	// every pattern to ppqTicks from the top, host time
@@ -0,0 +1,57 @@
+#include "smf.h"
+
+#include <stdio.h>
+
+SmfWriter::SmfWriter(int ticksPerQuarter) {
+	division = ticksPerQuarter;
+	lastTick = 0;
+	count = 0;
+}
+
+// variable length quantity
+void SmfWriter::delta(uint32_t tick) {
+	uint32_t d = tick > lastTick ? tick - lastTick : 0;
+	lastTick = tick > lastTick ? tick : lastTick;
+
+	uint8_t bytes[5];
+	int n = 0;
+	bytes[n++] = d & 0x7F;
+	while (d >>= 7) bytes[n++] = 0x80 | (d & 0x7F);
+	while (n--) track.push_back(bytes[n]);
+}
+
+void SmfWriter::tempo(uint32_t tick, uint32_t microsPerQuarter) {
+	delta(tick);
+	const uint8_t meta[] = { 0xFF, 0x51, 0x03,
+		(uint8_t)(microsPerQuarter >> 16), (uint8_t)(microsPerQuarter >> 8), (uint8_t)microsPerQuarter };
+	track.insert(track.end(), meta, meta + sizeof(meta));
+}
+
+void SmfWriter::event(uint32_t tick, const uint8_t* data, int len) {
+	delta(tick);
+	track.insert(track.end(), data, data + len);
+	count++;
+}
+
+bool SmfWriter::save(const char* path) {
+	std::vector<uint8_t> end = track;
+	end.push_back(0x00);
+	end.push_back(0xFF);
+	end.push_back(0x2F);
+	end.push_back(0x00);
+
+	const uint8_t header[] = {
+		'M', 'T', 'h', 'd', 0, 0, 0, 6,
+		0, 0,				// format 0
+		0, 1,				// one track
+		(uint8_t)(division >> 8), (uint8_t)division,
+		'M', 'T', 'r', 'k',
+		(uint8_t)(end.size() >> 24), (uint8_t)(end.size() >> 16), (uint8_t)(end.size() >> 8), (uint8_t)end.size()
+	};
+
+	FILE* f = fopen(path, "wb");
+	if (!f) return false;
+	bool ok = fwrite(header, 1, sizeof(header), f) == sizeof(header)
+		&& fwrite(end.data(), 1, end.size(), f) == end.size();
+	return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Minimal Standard MIDI File writer: format 0, one track, events added in
+// tick order.
+
+#include <stdint.h>
+#include <vector>
+
+class SmfWriter {
+	public:
+		explicit SmfWriter(int ticksPerQuarter);
+
+		void tempo(uint32_t tick, uint32_t microsPerQuarter);
+		void event(uint32_t tick, const uint8_t* data, int len);	// channel messages only
+		bool save(const char* path);
+		int events() { return count; }
+
+	private:
+		int division;
+		std::vector<uint8_t> track;
+		uint32_t lastTick;
+		int count;
+
+		void delta(uint32_t tick);
+};
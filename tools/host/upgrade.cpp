@@ -0,0 +1,170 @@
+// EEPROM version upgrade check, on the host simulator.
+//
+//   omx_upgrade [DIR]
+//
+// DIR (eeprom/ by default) holds images saved by older firmware, vN.bin, next
+// to what booting this firmware on them must leave, vN_to_vM.bin (written by
+// eeprom/make_images.py). For each pair:
+//  - a boot upgrades vN.bin, and the image has to match vN_to_vM.bin byte
+//    for byte
+//  - the upgrade is run again with the power cut after each EEPROM byte it
+//    programs, then booted once more from what was left, and that has to
+//    match too - so a power pull anywhere in the upgrade resumes and finishes
+//    it
+//  - booting vN_to_vM.bin changes nothing
+// Exit status is 1 if anything differs.
+//
+// Every boot runs in a forked child, so each one starts from the sketch's
+// power-on state. The boots chdir to a temp dir as setup() reads the bank files.
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "host.h"
+#include "sketch_api.h"
+
+namespace {
+	const int eepromSize = 2048;		// E2END + 1
+
+	struct Image {
+		uint8_t data[eepromSize];
+		long writes;		// bytes programmed by the boot
+		bool cut;			// the power went before it finished
+	};
+
+	template<class T, class F>
+	bool inChild(T& out, F body) {
+		int fds[2];
+		if (pipe(fds) != 0) return false;
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(fds[0]);
+			T r;
+			bool ok = body(r);
+			ssize_t n = write(fds[1], &r, sizeof(r));
+			_exit(ok && n == sizeof(r) ? 0 : 1);
+		}
+		close(fds[1]);
+		ssize_t n = read(fds[0], &out, sizeof(T));
+		close(fds[0]);
+		int status = 0;
+		waitpid(pid, &status, 0);
+		return n == sizeof(T) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+
+	bool readImage(const std::string& path, Image& image) {
+		FILE* f = fopen(path.c_str(), "rb");
+		if (!f) return false;
+		bool ok = fread(image.data, 1, sizeof(image.data), f) == sizeof(image.data);
+		fclose(f);
+		return ok;
+	}
+
+	// power on with the EEPROM as image, and with the power going after
+	// cutAfter bytes are programmed (-1 = not)
+	bool boot(const char* dir, const Image& image, long cutAfter, Image& out) {
+		return inChild(out, [&](Image& r) {
+			if (chdir(dir) != 0) return false;
+			host::loadEEPROM(image.data, sizeof(image.data));
+			host::seedRandom(1);
+			host::cutPowerAfter(cutAfter);
+			r.cut = false;
+			try {
+				sketchSetup();
+			} catch (const host::PowerCut&) {
+				r.cut = true;
+			}
+			host::copyEEPROM(r.data, sizeof(r.data));
+			r.writes = host::eepromWrites();
+			return true;
+		});
+	}
+
+	// first differing byte, or -1
+	int difference(const Image& a, const Image& b) {
+		for (int i = 0; i < eepromSize; ++i) {
+			if (a.data[i] != b.data[i]) return i;
+		}
+		return -1;
+	}
+
+	bool check(const char* dir, const std::string& src, const std::string& from, const std::string& to) {
+		Image old, expected, booted;
+		if (!readImage(src + "/" + from, old) || !readImage(src + "/" + to, expected)) {
+			printf("%s: can't read\n", from.c_str());
+			return false;
+		}
+
+		if (!boot(dir, old, -1, booted)) {
+			printf("%s: boot failed\n", from.c_str());
+			return false;
+		}
+		int at = difference(booted, expected);
+		if (at >= 0) {
+			printf("%s: upgraded image differs from %s at %d, %02x not %02x\n", from.c_str(), to.c_str(),
+				at, booted.data[at], expected.data[at]);
+			return false;
+		}
+		long writes = booted.writes;
+
+		int bad = 0;
+		int firstBad = -1;
+		for (long n = 0; n < writes; ++n) {
+			Image cut, resumed;
+			if (!boot(dir, old, n, cut) || !cut.cut || !boot(dir, cut, -1, resumed)
+				|| difference(resumed, expected) >= 0) {
+				if (firstBad < 0) firstBad = n;
+				bad++;
+			}
+		}
+
+		Image again;
+		bool same = boot(dir, expected, -1, again) && again.writes == 0;
+
+		printf("%-12s %ld bytes programmed, %ld power cuts, %d not resumed", from.c_str(), writes, writes, bad);
+		if (bad) printf(" (first after %d)", firstBad);
+		printf(", %s boots %s\n", to.c_str(), same ? "unchanged" : "CHANGED");
+		return bad == 0 && same;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::string src = argc > 1 ? argv[1] : "eeprom";
+	std::vector<std::string> expected;
+	DIR* d = opendir(src.c_str());
+	if (!d) {
+		fprintf(stderr, "can't open %s\n", src.c_str());
+		return 2;
+	}
+	while (dirent* e = readdir(d)) {
+		if (strstr(e->d_name, "_to_")) expected.push_back(e->d_name);
+	}
+	closedir(d);
+	std::sort(expected.begin(), expected.end());
+	if (expected.empty()) {
+		fprintf(stderr, "no vN_to_vM.bin images in %s\n", src.c_str());
+		return 2;
+	}
+
+	char dir[] = "/tmp/omx_upgrade_XXXXXX";
+	if (!mkdtemp(dir)) return 2;
+	if (src[0] != '/') {
+		char cwd[1024];
+		if (!getcwd(cwd, sizeof(cwd))) return 2;
+		src = std::string(cwd) + "/" + src;
+	}
+
+	bool ok = true;
+	for (const std::string& to : expected) {
+		std::string from = to.substr(0, to.find("_to_")) + ".bin";
+		ok = check(dir, src, from, to) && ok;
+	}
+	return ok ? 0 : 1;
+}
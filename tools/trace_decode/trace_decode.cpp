@@ -0,0 +1,138 @@
+// Decoder for OMX-27 timing traces (see trace.h)
+//
+// Build the firmware with TRACE_TIMING 1, then on Linux:
+//   stty -F /dev/ttyACM0 raw && cat /dev/ttyACM0 > capture.bin &
+//   printf t > /dev/ttyACM0        (start streaming, again to stop)
+//
+//   g++ -O2 -o trace_decode trace_decode.cpp
+//   ./trace_decode capture.bin [--json timeline.json]
+//
+// Prints a lateness histogram (sent - due) per event type and per pattern,
+// and optionally writes a Chrome trace / Perfetto JSON timeline where every
+// event starts when it was due and lasts until it was actually sent.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "trace_reader.h"
+
+namespace {
+	const char* eventNames[] = { "?", "step", "note on", "note off", "clock" };
+
+	const char* eventName(int e) {
+		return (e >= TRACE_STEP && e <= TRACE_CLOCK) ? eventNames[e] : eventNames[0];
+	}
+
+	bool readCapture(const char* path, TraceReader& reader) {
+		FILE* f = fopen(path, "rb");
+		if (!f) return false;
+		std::vector<uint8_t> data;
+		uint8_t buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+		fclose(f);
+		reader.parse(data.data(), data.size());
+		return true;
+	}
+
+	void printHistogram(const char* title, std::vector<int32_t> late) {
+		if (late.empty()) return;
+		std::sort(late.begin(), late.end());
+		int64_t total = 0;
+		for (int32_t l : late) total += l;
+		size_t n = late.size();
+
+		printf("\n%s: %zu events, late us min %d avg %lld p50 %d p99 %d max %d\n", title, n,
+			late.front(), (long long)(total / (int64_t)n), late[n / 2], late[n - 1 - n / 100], late.back());
+
+		const int32_t edges[] = { 0, 10, 50, 100, 250, 500, 1000, 5000 };
+		const int numEdges = sizeof(edges) / sizeof(edges[0]);
+		size_t counts[numEdges + 1] = {};
+		for (int32_t l : late) {
+			int b = 0;
+			while (b < numEdges && l >= edges[b]) b++;
+			counts[b]++;
+		}
+		size_t most = *std::max_element(counts, counts + numEdges + 1);
+		for (int b = 0; b <= numEdges; ++b) {
+			char label[32];
+			if (b == 0) snprintf(label, sizeof(label), "early");
+			else if (b == numEdges) snprintf(label, sizeof(label), ">= %d", edges[b - 1]);
+			else snprintf(label, sizeof(label), "%d - %d", edges[b - 1], edges[b]);
+			int bar = most ? (int)(counts[b] * 50 / most) : 0;
+			printf("  %12s us %8zu %s\n", label, counts[b], std::string(bar, '#').c_str());
+		}
+	}
+
+	bool writeTimeline(const char* path, const std::vector<TracedEvent>& events) {
+		FILE* f = fopen(path, "w");
+		if (!f) return false;
+		// pid 1 = sequencer steps by pattern, 2 = notes by channel, 3 = MIDI clock
+		fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		fprintf(f, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"steps\"}},\n");
+		fprintf(f, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":2,\"args\":{\"name\":\"notes\"}},\n");
+		fprintf(f, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":3,\"args\":{\"name\":\"clock\"}}");
+		for (const TracedEvent& e : events) {
+			int pid = e.event == TRACE_STEP ? 1 : e.event == TRACE_CLOCK ? 3 : 2;
+			int tid = e.event == TRACE_STEP ? e.pattern + 1 : e.event == TRACE_CLOCK ? 0 : e.channel;
+			int32_t dur = e.late() > 0 ? e.late() : 0;
+			fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%d,\"pid\":%d,\"tid\":%d,"
+				"\"args\":{\"late_us\":%d,\"note\":%d}}",
+				eventName(e.event), (long long)e.due, dur, pid, tid, e.late(), e.note);
+		}
+		fprintf(f, "\n]}\n");
+		fclose(f);
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* input = nullptr;
+	const char* json = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+			json = argv[++i];
+		} else {
+			input = argv[i];
+		}
+	}
+	if (!input) {
+		fprintf(stderr, "usage: %s capture.bin [--json timeline.json]\n", argv[0]);
+		return 2;
+	}
+
+	TraceReader reader;
+	if (!readCapture(input, reader)) {
+		fprintf(stderr, "can't read %s\n", input);
+		return 1;
+	}
+	const std::vector<TracedEvent>& events = reader.events;
+	printf("%zu events, %ld lost on the device, %ld bad frames\n", events.size(), reader.lost, reader.badFrames);
+
+	for (int type = TRACE_STEP; type <= TRACE_CLOCK; ++type) {
+		std::vector<int32_t> late;
+		for (const TracedEvent& e : events)
+			if (e.event == type) late.push_back(e.late());
+		printHistogram(eventName(type), late);
+	}
+	for (int p = 0; p < 16; ++p) {
+		for (int type = TRACE_STEP; type <= TRACE_NOTE_OFF; ++type) {
+			std::vector<int32_t> late;
+			for (const TracedEvent& e : events)
+				if (e.event == type && e.pattern == p) late.push_back(e.late());
+			char title[32];
+			snprintf(title, sizeof(title), "%s, pattern %d", eventName(type), p + 1);
+			printHistogram(title, late);
+		}
+	}
+
+	if (json && !writeTimeline(json, events)) {
+		fprintf(stderr, "can't write %s\n", json);
+		return 1;
+	}
+	return 0;
+}
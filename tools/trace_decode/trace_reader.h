@@ -0,0 +1,78 @@
+#pragma once
+
+// Parses the binary trace stream (see trace.h) back into events. Shared by
+// trace_decode and the host simulator's benchmark.
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "../../trace.h"
+
+struct TracedEvent {
+	int64_t due;		// micros, unwrapped
+	int64_t sent;
+	uint8_t event;
+	uint8_t pattern;
+	uint8_t note;
+	uint8_t channel;
+	int32_t late() const { return (int32_t)(sent - due); }
+};
+
+class TraceReader {
+	public:
+		std::vector<TracedEvent> events;
+		long lost = 0;			// records the unit dropped before sending them
+		long badFrames = 0;
+
+		// parse a whole capture, anything that isn't a trace frame is skipped
+		void parse(const uint8_t* data, size_t size) {
+			size_t i = 0;
+			while (i + TRACE_FRAME_HEADER <= size) {
+				if (memcmp(data + i, "OMXT", 4) != 0) {
+					i++;
+					continue;
+				}
+				int count = data[i + 5];
+				size_t frameSize = TRACE_FRAME_HEADER + count * TRACE_RECORD_SIZE;
+				if (data[i + 4] != TRACE_FORMAT_VERSION || i + frameSize > size) {
+					badFrames++;
+					i++;
+					continue;
+				}
+				lost += data[i + 6] | (data[i + 7] << 8);
+
+				const uint8_t* r = data + i + TRACE_FRAME_HEADER;
+				for (int k = 0; k < count; ++k, r += TRACE_RECORD_SIZE) {
+					uint32_t due = get32(r);
+					uint32_t sent = get32(r + 4);
+					TracedEvent e;
+					e.sent = unwrap(sent);
+					e.due = e.sent - (int32_t)(sent - due);
+					e.event = r[8];
+					e.pattern = r[9];
+					e.note = r[10];
+					e.channel = r[11];
+					events.push_back(e);
+				}
+				i += frameSize;
+			}
+		}
+
+	private:
+		bool started = false;
+		uint32_t last = 0;
+		int64_t base = 0;
+
+		static uint32_t get32(const uint8_t* p) {
+			return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+
+		// micros() wraps every ~71 minutes
+		int64_t unwrap(uint32_t t) {
+			if (started && t < last && last - t > 0x80000000UL) base += 0x100000000LL;
+			started = true;
+			last = t;
+			return base + t;
+		}
+};
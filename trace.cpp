@@ -0,0 +1,67 @@
+#include "trace.h"
+
+#if TRACE_TIMING
+
+#include <Arduino.h>
+
+namespace {
+	void put32(uint8_t* p, uint32_t v) {
+		p[0] = v;
+		p[1] = v >> 8;
+		p[2] = v >> 16;
+		p[3] = v >> 24;
+	}
+}
+
+TraceRing::TraceRing() {
+	head = 0;
+	tail = 0;
+	lost = 0;
+	streaming = false;
+}
+
+void TraceRing::toggleStreaming() {
+	streaming = !streaming;
+	// start from what happens next, not from whatever is sitting in the ring
+	tail = head;
+	lost = 0;
+}
+
+void TraceRing::stream() {
+	if (!streaming || !Serial) return;
+
+	while (head != tail) {
+		int count = head - tail;
+		if (count > maxFrameRecords) count = maxFrameRecords;
+		int frameSize = TRACE_FRAME_HEADER + count * TRACE_RECORD_SIZE;
+		if (Serial.availableForWrite() < frameSize) return;		// never block the loop
+
+		uint8_t frame[TRACE_FRAME_HEADER + maxFrameRecords * TRACE_RECORD_SIZE];
+		frame[0] = 'O';
+		frame[1] = 'M';
+		frame[2] = 'X';
+		frame[3] = 'T';
+		frame[4] = TRACE_FORMAT_VERSION;
+		frame[5] = count;
+		frame[6] = lost & 0xFF;
+		frame[7] = lost >> 8;
+		lost = 0;
+
+		uint8_t* p = frame + TRACE_FRAME_HEADER;
+		for (int i = 0; i < count; ++i) {
+			const Record& r = ring[tail++ % ringSize];
+			put32(p, r.due);
+			put32(p + 4, r.sent);
+			p[8] = r.event;
+			p[9] = r.pattern;
+			p[10] = r.note;
+			p[11] = r.channel;
+			p += TRACE_RECORD_SIZE;
+		}
+		Serial.write(frame, frameSize);
+	}
+}
+
+TraceRing traceRing;
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+
+// Timing trace: a RAM ring of fixed size records, one per step, note on,
+// note off and MIDI clock, holding when the event was due and when it was
+// actually sent. Send 't' over Serial to start / stop streaming the ring out in
+// binary, tools/trace_decode turns a capture into jitter histograms and a
+// Chrome trace / Perfetto timeline.
+//
+// Build with TRACE_TIMING 1 to turn it on. Left at 0 TRACE_EVENT expands to
+// nothing and the ring is not compiled in.
+//
+// Stream format (little endian), a frame at a time:
+//   'O' 'M' 'X' 'T'  version  record count (1)  lost records (2)
+//   then count records of 12 bytes:
+//   due micros (4)  sent micros (4)  event (1)  pattern (1)  note (1)  channel (1)
+// "lost" counts records overwritten before they could be sent.
+
+#ifndef TRACE_TIMING
+#define TRACE_TIMING 0
+#endif
+
+enum TraceEvent {
+	TRACE_STEP = 1,		// sequencer step, pattern set
+	TRACE_NOTE_ON,		// note and channel set, pattern too unless MIDI mode played it
+	TRACE_NOTE_OFF,
+	TRACE_CLOCK			// MIDI clock out
+};
+
+const uint8_t TRACE_NO_PATTERN = 0xFF;
+const uint8_t TRACE_FORMAT_VERSION = 1;
+const int TRACE_FRAME_HEADER = 8;
+const int TRACE_RECORD_SIZE = 12;
+
+#if TRACE_TIMING
+
+class TraceRing {
+	public:
+		TraceRing();
+
+		void record(uint8_t event, uint32_t due, uint32_t sent, uint8_t pattern, uint8_t note, uint8_t channel) {
+			if (head - tail == ringSize) {
+				tail++;			// full, drop the oldest
+				if (lost < UINT16_MAX) lost++;
+			}
+			Record& r = ring[head % ringSize];
+			r.due = due;
+			r.sent = sent;
+			r.event = event;
+			r.pattern = pattern;
+			r.note = note;
+			r.channel = channel;
+			head++;
+		}
+
+		void toggleStreaming();
+		void stream();			// call from loop(), sends what fits in the USB serial buffer
+
+	private:
+		static const uint32_t ringSize = 256;		// power of two
+		static const int maxFrameRecords = 16;
+
+		struct Record {
+			uint32_t due;
+			uint32_t sent;
+			uint8_t event;
+			uint8_t pattern;
+			uint8_t note;
+			uint8_t channel;
+		};
+		Record ring[ringSize];
+		uint32_t head;
+		uint32_t tail;
+		uint16_t lost;
+		bool streaming;
+};
+
+extern TraceRing traceRing;
+
+#define TRACE_EVENT(event, due, sent, pattern, note, channel)	traceRing.record(event, due, sent, pattern, note, channel)
+
+#else
+
+#define TRACE_EVENT(event, due, sent, pattern, note, channel)
+
+#endif